@@ -4,20 +4,29 @@ precision highp float;
 in vec3 vertexPosition;
 in vec3 vertexNormal;
 in vec2 vertexTexCoord;
+in vec2 vertexTexCoord2; // x: height on the next coarser level
 
 uniform vec2 radius;
+uniform vec3 morphCenter;
+uniform vec2 morphRange; // morph start and end distance for this level
 
 // Uniforms from raylib
 uniform mat4 mvp;
 uniform mat4 matModel;
+uniform mat4 matNormal;
 
 out vec3 fragPosition;
 out vec2 fragTexCoord;
 out vec3 fragNormal;
 
 void main() {
-    fragPosition = vertexPosition;
+    // Blend towards the coarser level by distance so level changes never pop or crack
+    float distanceToCamera = length(vertexPosition.xz - morphCenter.xz);
+    float morph = clamp((distanceToCamera - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+    vec3 position = vec3(vertexPosition.x, mix(vertexPosition.y, vertexTexCoord2.x, morph), vertexPosition.z);
+
+    fragPosition = position;
     fragTexCoord = vertexTexCoord;
-    fragNormal = normalize(mat3(transpose(inverse(matModel))) * vertexNormal);
-    gl_Position = mvp * vec4(vertexPosition, 1.0);
-}
\ No newline at end of file
+    fragNormal = normalize(mat3(matNormal) * vertexNormal);
+    gl_Position = mvp * vec4(position, 1.0);
+}
@@ -7,7 +7,8 @@ in vec3 vertexColor;
 in vec2 vertexTexCoord;
 
 uniform mat4 mvp;
-uniform mat4 matModel;  
+uniform mat4 matModel;
+uniform mat4 matNormal; // transpose(inverse(matModel)), set per draw by raylib
 
 out vec3 fragPosition;
 out vec3 fragNormal;
@@ -17,7 +18,7 @@ out vec4 fragClipPos;
 
 void main() {
     fragPosition = (matModel * vec4(vertexPosition, 1.0)).xyz;
-    fragNormal = normalize(mat3(transpose(inverse(matModel))) * vertexNormal);
+    fragNormal = normalize(mat3(matNormal) * vertexNormal);
     fragTexCoord = vertexTexCoord;
     fragColor = vertexColor;
 
@@ -19,7 +19,7 @@ out float fragSurfaceLevel;
 
 void main() {
     fragPosition = vertexPosition;
-    fragNormal = normalize(mat3(transpose(inverse(matModel))) * vertexNormal);
+    fragNormal = normalize(mat3(matNormal) * vertexNormal);
     fragTexCoord = vertexTexCoord;
     fragTangent = normalize(vec3(matNormal * vec4(1.0, 0.0, 0.0, 0.0)));
     fragBitangent = normalize(vec3(matNormal * vec4(0.0, 0.0, 1.0, 0.0)));
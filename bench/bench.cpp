@@ -0,0 +1,551 @@
+// Headless microbenchmarks for the simulation kernels. Run with --json <path> to write the
+// results for bench/compare.py, and --filter <text> to run only the benchmarks matching it.
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <random>
+#include <vector>
+#include <raymath.h>
+#include "bench.h"
+#include "memory/memory.h"
+#include "world/graphics.h"
+#include "world/render_queue.h"
+#include "world/snapshot.h"
+#include "world/spawner.h"
+#include "world/transforms.h"
+#include "world/world.h"
+#include "world/components/gameplay.h"
+#include "world/components/particle.h"
+#include "world/components/render.h"
+#include "world/terrain/terrain.h"
+
+struct Result {
+    std::string name;
+    double value;
+    std::string unit;
+    bool higher_is_better;
+};
+
+std::vector<Result> results;
+bool failed { false };
+
+auto seconds_since(const Clock::time_point start) -> double {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void record(const std::string &name, const double value, const std::string &unit, const bool higher_is_better) {
+    results.push_back({ name, value, unit, higher_is_better });
+}
+
+void fail(const std::string &message) {
+    std::fprintf(stderr, "FAILED: %s\n", message.c_str());
+    failed = true;
+}
+
+auto write_json(const char *path) -> bool {
+    auto *file { std::fopen(path, "w") };
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::fprintf(file, "{\n  \"seed\": %d,\n  \"results\": [\n", SEED);
+    for (size_t i { 0 }; i < results.size(); ++i) {
+        const auto &result { results[i] };
+        std::fprintf(file, "    { \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", \"better\": \"%s\" }%s\n",
+            result.name.c_str(), result.value, result.unit.c_str(), result.higher_is_better ? "higher" : "lower",
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+void bench_height_queries() {
+    constexpr size_t query_count { 1 << 20 };
+    constexpr int repeats { 10 };
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution dist(-WORLD_CENTER, WORLD_CENTER);
+
+    std::vector<float> xs(query_count);
+    std::vector<float> zs(query_count);
+    std::vector<float> heights(query_count);
+
+    for (size_t i { 0 }; i < query_count; ++i) {
+        xs[i] = dist(rng);
+        zs[i] = dist(rng);
+    }
+
+    auto checksum { 0.0f };
+    auto start { Clock::now() };
+    for (int repeat { 0 }; repeat < repeats; ++repeat) {
+        for (size_t i { 0 }; i < query_count; ++i) {
+            heights[i] = terrain::get_height(xs[i], zs[i]);
+        }
+        checksum += heights[repeat];
+    }
+    const auto scalar { static_cast<double>(query_count * repeats) / seconds_since(start) };
+
+    start = Clock::now();
+    for (int repeat { 0 }; repeat < repeats; ++repeat) {
+        terrain::get_heights(xs.data(), zs.data(), heights.data(), query_count);
+        checksum += heights[repeat];
+    }
+    const auto batched { static_cast<double>(query_count * repeats) / seconds_since(start) };
+
+    std::printf("height_queries scalar:  %8.2f Mq/s\n", scalar / 1e6);
+    std::printf("height_queries batched: %8.2f Mq/s (%.2fx, checksum %f)\n", batched / 1e6, batched / scalar, checksum);
+    record("terrain.get_height", scalar / 1e6, "Mq/s", true);
+    record("terrain.get_heights", batched / 1e6, "Mq/s", true);
+}
+
+// Interpolation to world matrices, Euler angles converted and multiplied per entity against
+// quaternions at the tick boundary and one packed pass over the whole batch
+void bench_render_matrices() {
+    constexpr int repeats { 20 };
+
+    for (const auto count : { size_t { 10000 }, size_t { 100000 } }) {
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(-WORLD_CENTER, WORLD_CENTER);
+        std::uniform_real_distribution angle(0.0f, 360.0f);
+
+        std::vector<Vector3> positions(count);
+        std::vector<Vector3> eulers(count);
+        std::vector<Quaternion> rotations(count);
+        for (size_t i { 0 }; i < count; ++i) {
+            positions[i] = { position(rng), position(rng), position(rng) };
+            eulers[i] = { angle(rng), angle(rng), angle(rng) };
+            rotations[i] = QuaternionFromEuler(eulers[i].x * DEG2RAD, eulers[i].y * DEG2RAD, eulers[i].z * DEG2RAD);
+        }
+
+        std::vector<Matrix> matrices(count);
+        auto checksum { 0.0f };
+        auto start { Clock::now() };
+        for (int repeat { 0 }; repeat < repeats; ++repeat) {
+            for (size_t i { 0 }; i < count; ++i) {
+                const auto &a { eulers[i] };
+                const auto &b { eulers[(i + 1) % count] };
+                const auto rotation { QuaternionSlerp(
+                    QuaternionFromEuler(a.x * DEG2RAD, a.y * DEG2RAD, a.z * DEG2RAD),
+                    QuaternionFromEuler(b.x * DEG2RAD, b.y * DEG2RAD, b.z * DEG2RAD),
+                    0.5f) };
+                matrices[i] = MatrixMultiply(MatrixScale(1.0f, 1.0f, 1.0f),
+                    MatrixMultiply(QuaternionToMatrix(rotation), MatrixTranslate(positions[i].x, positions[i].y, positions[i].z)));
+            }
+            checksum += matrices[repeat].m12;
+        }
+        const auto euler_ms { seconds_since(start) * 1000.0 / repeats };
+
+        transforms::Batch batch;
+        std::vector<transforms::Affine> packed(count);
+        start = Clock::now();
+        for (int repeat { 0 }; repeat < repeats; ++repeat) {
+            batch.clear();
+            for (size_t i { 0 }; i < count; ++i) {
+                batch.push(positions[i], QuaternionSlerp(rotations[i], rotations[(i + 1) % count], 0.5f), 1.0f);
+            }
+            transforms::build_matrices(batch, packed.data());
+            checksum += packed[repeat].m[3];
+        }
+        const auto packed_ms { seconds_since(start) * 1000.0 / repeats };
+
+        std::printf("render_matrices %6zu: euler %7.3f ms, packed %7.3f ms (%.2fx, checksum %f)\n",
+            count, euler_ms, packed_ms, euler_ms / packed_ms, checksum);
+        record("render.build_matrices." + std::to_string(count), packed_ms, "ms");
+    }
+}
+
+// CPU side terrain footprint of this build, from the buffers each side keeps. Before is float
+// heights and meshes holding every attribute array, after is the quantized heightfield and meshes
+// holding only their indices. The cell planes and path grids are the same on both sides.
+void report_terrain_memory() {
+    const auto ground { terrain::ground_mesh_memory() };
+    const auto water { terrain::water_mesh_memory() };
+    const auto planes { terrain::height_planes.capacity() * sizeof(float) };
+    const auto grids { terrain::grid_memory() };
+    const auto float_heights { terrain::elevation.count() * sizeof(float) };
+
+    const auto before { float_heights + planes + grids + ground.indices + ground.attributes + water.indices + water.attributes };
+    const auto after { terrain::elevation.memory() + planes + grids + ground.indices + water.indices };
+
+    const auto kb { [](const size_t bytes) { return static_cast<double>(bytes) / 1024.0; } };
+    std::printf("terrain memory, world %d (%d vertices a side):\n", WORLD_SIZE, DETAILED_SIZE);
+    std::printf("  %-16s %10s %10s\n", "", "before KB", "after KB");
+    std::printf("  %-16s %10.1f %10.1f\n", "heights", kb(float_heights), kb(terrain::elevation.memory()));
+    std::printf("  %-16s %10.1f %10.1f\n", "cell planes", kb(planes), kb(planes));
+    std::printf("  %-16s %10.1f %10.1f\n", "path grids", kb(grids), kb(grids));
+    std::printf("  %-16s %10.1f %10.1f\n", "ground meshes", kb(ground.indices + ground.attributes), kb(ground.indices));
+    std::printf("  %-16s %10.1f %10.1f\n", "water meshes", kb(water.indices + water.attributes), kb(water.indices));
+    std::printf("  %-16s %10.1f %10.1f (%.1fx smaller)\n", "total", kb(before), kb(after),
+        static_cast<double>(before) / static_cast<double>(after));
+
+    record("terrain.memory_before", kb(before), "KB");
+    record("terrain.memory_after", kb(after), "KB");
+}
+
+// Startup population, Poisson disk placement followed by one bulk spawn of 100k prefab instances
+void bench_spawner() {
+    constexpr size_t count { 100000 };
+    flecs::world ecs;
+    const auto prefab { ecs.prefab("Bench").set<Collider>({ .radius = 0.5f }) };
+
+    auto start { Clock::now() };
+    const auto points { spawner::poisson_disk({ .min_distance = 0.1f, .min_height = 0.1f, .max_slope = 35.0f }, SEED, count) };
+    const auto placement_ms { seconds_since(start) * 1000.0 };
+
+    std::vector<WorldTransform> transforms(points.size());
+    for (size_t i { 0 }; i < points.size(); ++i) {
+        transforms[i].pos = points[i];
+    }
+
+    start = Clock::now();
+    spawner::BulkSpawn(ecs, prefab, transforms).spawn();
+    const auto spawn_ms { seconds_since(start) * 1000.0 };
+
+    std::printf("spawner %zu objects: placement %.2f ms, spawn %.2f ms, total %.2f ms\n",
+        points.size(), placement_ms, spawn_ms, placement_ms + spawn_ms);
+    record("spawner.poisson_disk", placement_ms, "ms");
+    record("spawner.bulk_spawn", spawn_ms, "ms");
+}
+
+// Component layouts before models, animation sets and palettes moved to shared registries
+struct LegacyWorldModel {
+    std::map<std::string, ModelAnimation> animations {};
+    Model model {};
+    bool textured { false };
+};
+
+struct LegacyConsumable {
+    std::vector<Color> colors;
+    int particles { 25 };
+};
+
+struct LegacyExplosion {
+    int particles { 25 };
+    float min_speed { 0.05f };
+    float max_speed { 0.03f };
+    float min_lifetime { 0.8f };
+    float max_lifetime { 0.8f };
+    std::vector<Color> colors {};
+};
+
+// Round trip of a populated world, restored into a fresh world holding the same prefab
+void bench_snapshot() {
+    constexpr size_t count { 100000 };
+    const auto populate { [](const flecs::world &ecs) {
+        return ecs.prefab("Bench").set<Collider>({ .radius = 0.5f });
+    }};
+
+    flecs::world source;
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER, WORLD_CENTER);
+
+    std::vector<WorldTransform> transforms(count);
+    std::vector<Bounce> bounces(count);
+    for (size_t i { 0 }; i < count; ++i) {
+        transforms[i].pos = { position(rng), 0.0f, position(rng) };
+        bounces[i] = { .speed = 0.05f, .height = 0.25f, .elapsed = position(rng), .center_y = 1.0f };
+    }
+    spawner::BulkSpawn(source, populate(source), transforms).with(bounces).spawn();
+
+    auto start { Clock::now() };
+    const auto bytes { snapshot::capture(source) };
+    const auto capture_ms { seconds_since(start) * 1000.0 };
+
+    flecs::world target;
+    populate(target);
+
+    start = Clock::now();
+    snapshot::restore_entities(target, bytes);
+    const auto restore_ms { seconds_since(start) * 1000.0 };
+
+    std::printf("snapshot %zu entities: %.1f KB, capture %.2f ms, restore %.2f ms\n",
+        count, static_cast<double>(bytes.size()) / 1024.0, capture_ms, restore_ms);
+    record("snapshot.capture", capture_ms, "ms");
+    record("snapshot.restore", restore_ms, "ms");
+    record("snapshot.size", static_cast<double>(bytes.size()) / 1024.0, "KB");
+}
+
+// Repeated path requests the way move_target issues them, counted once the arena and pool are warm
+void bench_path_allocations() {
+    constexpr int warmup { 64 };
+    constexpr int requests { 1000 };
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER * 0.5f, WORLD_CENTER * 0.5f);
+    MoveTo move_to {};
+
+    const auto request { [&] {
+        memory::begin_tick();
+        move_to.path.clear();
+        terrain::find_path({ position(rng), 0.0f, position(rng) }, { position(rng), 0.0f, position(rng) }, move_to.path);
+    }};
+
+    for (int i { 0 }; i < warmup; ++i) {
+        request();
+    }
+    memory::begin_frame();
+
+    const auto start { Clock::now() };
+    for (int i { 0 }; i < requests; ++i) {
+        request();
+    }
+    const auto elapsed_ms { seconds_since(start) * 1000.0 };
+    memory::begin_frame();
+
+    const auto counters { memory::frame_counters() };
+    std::printf("find_path %d requests: %.2f ms, %zu arena, %zu pool, %zu allocator blocks, %zu heap allocations\n",
+        requests, elapsed_ms, counters.arena_allocations, counters.pool_allocations, counters.allocator_blocks, counters.heap_allocations);
+    record("memory.find_path_allocator_blocks", static_cast<double>(counters.allocator_blocks), "count");
+    record("memory.find_path_heap_allocations", static_cast<double>(counters.heap_allocations), "count");
+}
+
+// A frame of commands emitted system by system, state changes when replayed as emitted and once sorted
+void bench_render_queue() {
+    constexpr int models { 10000 };
+    constexpr int particles { 2000 };
+    constexpr int chunks { 256 };
+    constexpr int patches { 64 };
+    constexpr uint32_t model_shader { 3 };
+    constexpr uint32_t ground_shader { 4 };
+    constexpr uint32_t water_shader { 5 };
+    constexpr int model_kinds { 8 };
+
+    // A replay in sorted order switches shader once per pass, and material once per ground
+    // level, model kind, the particles and the water
+    constexpr size_t max_shader_changes { 3 };
+    constexpr size_t max_material_changes { GROUND_LOD_LEVELS + model_kinds + 2 };
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER, WORLD_CENTER);
+    std::uniform_int_distribution model_id(0, model_kinds - 1);
+    std::uniform_int_distribution level(0, GROUND_LOD_LEVELS - 1);
+
+    render_queue::Queue queue;
+    queue.begin({ 0.0f, 10.0f, 0.0f });
+
+    for (int i { 0 }; i < chunks; ++i) {
+        queue.push_ground(ground_shader, 1, i, level(rng), { position(rng), 0.0f, position(rng) });
+    }
+
+    for (int i { 0 }; i < models; ++i) {
+        const auto id { model_id(rng) };
+        const WorldModel model { .model { id }, .textured = id < 2 };
+        transforms::Affine matrix { 1, 0, 0, position(rng), 0, 1, 0, 0.0f, 0, 0, 1, position(rng) };
+        queue.push_model(model_shader, static_cast<uint32_t>(10 + id), model, matrix, nullptr, static_cast<flecs::entity_t>(i));
+    }
+
+    for (int i { 0 }; i < particles; ++i) {
+        transforms::Affine matrix { 1, 0, 0, position(rng), 0, 1, 0, 1.0f, 0, 0, 1, position(rng) };
+        queue.push_particle(model_shader, matrix, WHITE, 1.0f);
+    }
+
+    for (int i { 0 }; i < patches; ++i) {
+        queue.push_water(water_shader, 2, i, { position(rng), 0.0f, position(rng) });
+    }
+
+    const auto unsorted { queue.stats() };
+    const auto start { Clock::now() };
+    queue.sort();
+    const auto sort_ms { seconds_since(start) * 1000.0 };
+    const auto sorted { queue.stats() };
+
+    std::printf("render_queue %zu commands sorted in %.2f ms\n", sorted.commands, sort_ms);
+    std::printf("  emitted: %zu shader, %zu material, %zu texture changes\n",
+        unsorted.shader_changes, unsorted.material_changes, unsorted.texture_changes);
+    std::printf("  sorted:  %zu shader, %zu material, %zu texture changes, %zu merged draws\n",
+        sorted.shader_changes, sorted.material_changes, sorted.texture_changes, sorted.merged);
+    record("render.queue_sort", sort_ms, "ms");
+    record("render.queue_state_changes", static_cast<double>(sorted.shader_changes + sorted.material_changes + sorted.texture_changes), "count");
+
+    if (sorted.shader_changes > max_shader_changes || sorted.material_changes > max_material_changes) {
+        fail("render_queue: sorted order makes " + std::to_string(sorted.shader_changes) + " shader and " +
+            std::to_string(sorted.material_changes) + " material changes, at most " + std::to_string(max_shader_changes) +
+            " and " + std::to_string(max_material_changes) + " expected");
+    }
+    // The emitted order already groups the shaders by kind, so only the total has to go down
+    if (sorted.shader_changes > unsorted.shader_changes || sorted.material_changes > unsorted.material_changes ||
+        sorted.shader_changes + sorted.material_changes >= unsorted.shader_changes + unsorted.material_changes) {
+        fail("render_queue: sorting did not reduce shader and material changes");
+    }
+}
+
+// The render pipeline over a populated world against the recording backend, no GL context needed.
+// Ground and water meshes only carry vertex counts, models need loaded assets and are left out.
+void bench_render_headless() {
+    constexpr int particles { 20000 };
+    constexpr int casters { 200 };
+    constexpr int chunks_per_side { 8 };
+    constexpr int patches { 64 };
+    constexpr int frames { 100 };
+
+    graphics::RecordingBackend recording;
+    graphics::use_backend(&recording);
+
+    auto world { World::create_world() };
+    world.ecs.set<WorldCamera>({
+        .camera { Camera {
+            .position { 0.0f, 0.0f, 0.0f },
+            .target { 0.0f, 0.0f, 0.0f },
+            .up { 0.0f, 1.0f, 0.0f },
+            .fovy = 45.0f,
+            .projection = CAMERA_PERSPECTIVE,
+        }},
+        .distance = 12.0f,
+    });
+    world.ecs.set<ModelShader>({ .shader { .id = 1 }, .frame { 0, 1, 2 }, .loc_use_texture = 3 });
+    world.ecs.set<GroundShader>({
+        .shader { .id = 2 }, .frame { 0, 1, 2 },
+        .loc_shadow_count = 3, .loc_shadow_positions = 4, .loc_shadow_radii = 5, .loc_shadow_itensities = 6,
+        .loc_morph_center = 7, .loc_morph_range = 8,
+    });
+    world.ecs.set<WaterShader>({ .shader { .id = 3 }, .frame { 0, 1, 2 }, .loc_time = 3 });
+
+    std::vector<MaterialMap> maps(MAX_MATERIAL_MAPS);
+    Material material { .shader {}, .maps = maps.data(), .params {} };
+
+    constexpr int chunk_count { chunks_per_side * chunks_per_side };
+    constexpr auto chunk_size { WORLD_CENTER * 2.0f / chunks_per_side };
+    // Terrain meshes share vertices between triangles and keep their CPU indices like the real ones
+    std::vector<unsigned short> indices(3);
+    std::vector<Mesh> ground_meshes(chunk_count * GROUND_LOD_LEVELS);
+    WorldGround ground { .model { .transform = MatrixIdentity(), .meshCount = static_cast<int>(ground_meshes.size()), .materialCount = 1,
+                                  .meshes = ground_meshes.data(), .materials = &material } };
+    for (int i { 0 }; i < chunk_count; ++i) {
+        const auto x { -WORLD_CENTER + static_cast<float>(i % chunks_per_side) * chunk_size };
+        const auto z { -WORLD_CENTER + static_cast<float>(i / chunks_per_side) * chunk_size };
+        auto &chunk { ground.chunks.emplace_back() };
+        chunk.bounds = { { x, -2.0f, z }, { x + chunk_size, 2.0f, z + chunk_size } };
+        for (int level { 0 }; level < GROUND_LOD_LEVELS; ++level) {
+            chunk.meshes[level] = i * GROUND_LOD_LEVELS + level;
+            auto &mesh { ground_meshes[chunk.meshes[level]] };
+            mesh.vertexCount = 4096 >> (2 * level);
+            mesh.triangleCount = mesh.vertexCount * 2;
+            mesh.indices = indices.data();
+        }
+    }
+    world.ecs.set<WorldGround>(ground);
+
+    std::vector<Mesh> water_meshes(patches);
+    WorldWater water { .model { .transform = MatrixIdentity(), .meshCount = patches, .materialCount = 1,
+                                .meshes = water_meshes.data(), .materials = &material } };
+    for (int i { 0 }; i < patches; ++i) {
+        const auto x { -WORLD_CENTER + static_cast<float>(i % 8) * WORLD_CENTER / 4.0f };
+        const auto z { -WORLD_CENTER + static_cast<float>(i / 8) * WORLD_CENTER / 4.0f };
+        water.patches.push_back({ { x, -1.0f, z }, { x + WORLD_CENTER / 4.0f, 0.0f, z + WORLD_CENTER / 4.0f } });
+        water_meshes[i].vertexCount = 1024;
+        water_meshes[i].triangleCount = 2048;
+        water_meshes[i].indices = indices.data();
+    }
+    world.ecs.set<WorldWater>(water);
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER * 0.25f, WORLD_CENTER * 0.25f);
+    for (int i { 0 }; i < particles; ++i) {
+        world.ecs.entity()
+            .set<Particle>({ .lifetime = 1.0f, .color = WHITE })
+            .set<WorldTransform>({ .pos = { position(rng), 1.0f, position(rng) } });
+    }
+    for (int i { 0 }; i < casters; ++i) {
+        world.ecs.entity()
+            .set<ShadowCaster>({ .radius = 0.5f })
+            .set<WorldTransform>({ .pos = { position(rng), 1.0f, position(rng) } });
+    }
+
+    // Each begin_frame publishes the counters of the frame before it
+    memory::begin_frame();
+    size_t heap_allocations { 0 };
+
+    const auto start { Clock::now() };
+    for (int frame { 0 }; frame < frames; ++frame) {
+        memory::begin_frame();
+        heap_allocations += memory::frame_counters().heap_allocations;
+        world.ecs.run_pipeline(world.pre_render_pipeline, 1.0f);
+        world.ecs.run_pipeline(world.render_pipeline, 1.0f);
+    }
+    const auto frame_ms { seconds_since(start) * 1000.0 / frames };
+    memory::begin_frame();
+    heap_allocations += memory::frame_counters().heap_allocations;
+
+    const auto &counters { recording.counters() };
+    std::printf("render headless %d particles: %.3f ms per frame\n", particles, frame_ms);
+    std::printf("  per frame: %zu draws, %zu vertices, %zu uniform uploads (%zu B), %zu shader and %zu blend changes\n",
+        counters.draw_calls / frames, counters.vertices / frames, counters.uniform_uploads / frames,
+        counters.uniform_bytes / frames, counters.shader_changes / frames, counters.blend_changes / frames);
+    std::printf("  per frame: %zu triangles, %zu draws of shared vertex meshes without indices, %zu heap allocations\n",
+        counters.triangles / frames, counters.broken_draws / frames, heap_allocations / frames);
+    if (counters.broken_draws > 0) {
+        std::printf("  WARNING: meshes without indices would be drawn as a triangle soup\n");
+    }
+    record("render.headless_frame", frame_ms, "ms");
+    record("render.headless_triangles", static_cast<double>(counters.triangles / frames), "count");
+    record("render.headless_broken_draws", static_cast<double>(counters.broken_draws / frames), "count");
+    record("render.headless_draw_calls", static_cast<double>(counters.draw_calls / frames), "count");
+    record("render.headless_uniform_bytes", static_cast<double>(counters.uniform_bytes / frames), "B");
+    record("render.headless_heap_allocations", static_cast<double>(heap_allocations / frames), "count");
+
+    graphics::use_backend(nullptr);
+}
+
+// Bytes per entity, inline in the component column plus what a spawn copies to the heap
+void report_component_memory() {
+    constexpr size_t palette_colors { 6 };
+
+    const auto report { [](const char *name, const size_t before_inline, const size_t before_heap, const size_t after_inline) {
+        constexpr size_t entities { 100000 };
+        std::printf("%-12s before %4zu + %3zu heap B, after %3zu B, %8.2f MB saved per %zu entities\n",
+            name, before_inline, before_heap, after_inline,
+            static_cast<double>((before_inline + before_heap - after_inline) * entities) / (1024.0 * 1024.0), entities);
+    }};
+
+    report("WorldModel", sizeof(LegacyWorldModel), 0, sizeof(WorldModel));
+    report("Consumable", sizeof(LegacyConsumable), palette_colors * sizeof(Color), sizeof(Consumable));
+    report("Explosion", sizeof(LegacyExplosion), palette_colors * sizeof(Color), sizeof(Explosion));
+}
+
+int main(const int argc, char **argv) {
+    const char *json_path { nullptr };
+    const char *filter { "" };
+    for (int i { 1 }; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json_path = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            filter = argv[i + 1];
+        }
+    }
+
+    terrain::generate_elevation(SEED);
+
+    const std::pair<const char*, void(*)()> benchmarks[] {
+        { "height_queries", bench_height_queries },
+        { "ray_queries", bench_ray_queries },
+        { "collision_grid", bench_collision_grid },
+        { "navigation", bench_navigation },
+        { "deform", bench_deform },
+        { "ground_sizes", bench_ground_sizes },
+        { "eat_system", bench_eat_system },
+        { "avoidance", bench_avoidance },
+        { "sim_lod", bench_sim_lod },
+        { "animation", bench_animation },
+        { "render_matrices", bench_render_matrices },
+        { "spawner", bench_spawner },
+        { "snapshot", bench_snapshot },
+        { "path_allocations", bench_path_allocations },
+        { "render_queue", bench_render_queue },
+        { "render_headless", bench_render_headless },
+        { "terrain_memory", report_terrain_memory },
+        { "component_memory", report_component_memory },
+    };
+
+    for (const auto &[name, run] : benchmarks) {
+        if (std::strstr(name, filter) != nullptr) {
+            run();
+        }
+    }
+
+    if (json_path != nullptr && !write_json(json_path)) {
+        std::fprintf(stderr, "could not write %s\n", json_path);
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int SEED { 1234 };
+
+auto seconds_since(Clock::time_point start) -> double;
+
+// Adds a result to the JSON report, lower values are better unless stated otherwise
+void record(const std::string &name, double value, const std::string &unit, bool higher_is_better = false);
+
+// Reports a broken invariant, the run still finishes but exits with a non-zero status
+void fail(const std::string &message);
+
+// Fastest of a few runs in seconds, the least disturbed run is the most repeatable one
+template <typename Fn>
+auto best_of(const int runs, Fn &&fn) -> double {
+    auto best { 0.0 };
+    for (int run { 0 }; run < runs; ++run) {
+        const auto start { Clock::now() };
+        fn();
+        const auto elapsed { seconds_since(start) };
+        best = run == 0 ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+// Terrain, navigation and gameplay kernels, in kernels.cpp
+void bench_ray_queries();
+void bench_collision_grid();
+void bench_navigation();
+void bench_deform();
+void bench_ground_sizes();
+void bench_eat_system();
+void bench_avoidance();
+void bench_sim_lod();
+void bench_animation();
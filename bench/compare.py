@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Compares two bixs_bench --json reports and flags results that got worse beyond a threshold.
+
+    python3 bench/compare.py baseline.json current.json [--threshold 10]
+
+Exits with 1 when any result regressed, so it can gate CI.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as file:
+        return {result["name"]: result for result in json.load(file)["results"]}
+
+
+def change(base, current, higher_is_better):
+    """Relative change in percent, positive when the result got worse"""
+    if base == 0:
+        return 0.0 if current == 0 else float("inf") * (-1 if higher_is_better else 1)
+    delta = (current - base) / abs(base) * 100.0
+    return -delta if higher_is_better else delta
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="regression threshold in percent")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = 0
+
+    print(f"{'benchmark':<44} {'baseline':>12} {'current':>12} {'change':>9}")
+    for name, result in current.items():
+        if name not in baseline:
+            print(f"{name:<44} {'-':>12} {result['value']:>12.4g}      new")
+            continue
+
+        base = baseline[name]["value"]
+        worse = change(base, result["value"], result["better"] == "higher")
+        flag = ""
+        if worse > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+
+        print(f"{name:<44} {base:>12.4g} {result['value']:>12.4g} {worse:>+8.1f}%{flag} {result['unit']}")
+
+    for name in baseline.keys() - current.keys():
+        print(f"{name:<44} {baseline[name]['value']:>12.4g} {'-':>12}  missing")
+
+    if regressions:
+        print(f"\n{regressions} result(s) regressed by more than {args.threshold:g}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
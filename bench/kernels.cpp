@@ -0,0 +1,521 @@
+// Terrain, navigation and gameplay kernels over seeded inputs
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <flecs.h>
+#include <raymath.h>
+#include "bench.h"
+#include "game.h"
+#include "assets/assets.h"
+#include "memory/memory.h"
+#include "world/culling.h"
+#include "world/render_queue.h"
+#include "world/world.h"
+#include "world/components/gameplay.h"
+#include "world/components/interpolation.h"
+#include "world/components/lod.h"
+#include "world/components/render.h"
+#include "world/systems/render.h"
+#include "world/terrain/terrain.h"
+
+namespace {
+    constexpr int RUNS { 5 };
+
+    // Colliders scattered over land, the same layout for every kernel that needs obstacles
+    void populate_colliders(const flecs::world &ecs, const int count) {
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(-WORLD_CENTER * 0.9f, WORLD_CENTER * 0.9f);
+
+        for (int i { 0 }; i < count; ++i) {
+            const Vector3 pos { position(rng), 0.0f, position(rng) };
+            ecs.entity()
+                .set<Collider>({ .radius = 0.5f })
+                .set<WorldTransform>({ .pos = { pos.x, terrain::get_height(pos.x, pos.z), pos.z } });
+        }
+    }
+}
+
+void bench_ray_queries() {
+    constexpr int count { 10000 };
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER * 0.8f, WORLD_CENTER * 0.8f);
+    std::uniform_real_distribution slant(-0.5f, 0.5f);
+
+    std::vector<Vector3> origins(count);
+    std::vector<Vector3> directions(count);
+    std::vector<Vector3> targets(count);
+    for (int i { 0 }; i < count; ++i) {
+        origins[i] = { position(rng), 20.0f, position(rng) };
+        directions[i] = Vector3Normalize({ slant(rng), -1.0f, slant(rng) });
+        targets[i] = { position(rng), 0.0f, position(rng) };
+    }
+
+    auto hits { 0 };
+    const auto ray_seconds { best_of(RUNS, [&] {
+        hits = 0;
+        for (int i { 0 }; i < count; ++i) {
+            hits += terrain::ray_ground_intersect(origins[i], directions[i]).has_value();
+        }
+    }) };
+
+    auto shallow { 0 };
+    const auto shallow_seconds { best_of(RUNS, [&] {
+        shallow = 0;
+        for (int i { 0 }; i < count; ++i) {
+            shallow += terrain::find_closest_shallow_point(targets[i], origins[i]).has_value();
+        }
+    }) };
+
+    const auto ray_ns { ray_seconds * 1e9 / count };
+    const auto shallow_ns { shallow_seconds * 1e9 / count };
+    std::printf("ray_ground_intersect:       %8.1f ns/op (%d of %d hit)\n", ray_ns, hits, count);
+    std::printf("find_closest_shallow_point: %8.1f ns/op (%d of %d found)\n", shallow_ns, shallow, count);
+    record("terrain.ray_ground_intersect", ray_ns, "ns/op");
+    record("terrain.find_closest_shallow_point", shallow_ns, "ns/op");
+}
+
+void bench_collision_grid() {
+    for (const auto count : { 1000, 10000 }) {
+        flecs::world ecs;
+        populate_colliders(ecs, count);
+
+        // Everything changes the first time, the grid is rebuilt as a whole
+        const auto seconds { best_of(RUNS, [&ecs] {
+            memory::begin_tick();
+            terrain::invalidate_collision_grid();
+            terrain::update_collision_entities(ecs);
+        }) };
+
+        // One collider hopping back and forth, only the blocks around the tiles it left and entered are rebuilt
+        const auto mover { ecs.entity()
+            .set<Collider>({ .radius = 0.5f })
+            .set<WorldTransform>({ .pos = { 0.0f, 0.0f, 0.0f } }) };
+        terrain::update_collision_entities(ecs);
+
+        auto step { 0 };
+        const auto moved_seconds { best_of(RUNS, [&] {
+            memory::begin_tick();
+            mover.get_mut<WorldTransform>()->pos.x = (++step % 2) * 4.0f;
+            terrain::update_collision_entities(ecs);
+        }) };
+
+        std::printf("update_collision_entities %5d colliders: %8.3f ms, %8.3f ms with one moved\n", count, seconds * 1000.0, moved_seconds * 1000.0);
+        record("navigation.update_collision_entities." + std::to_string(count), seconds * 1000.0, "ms");
+        record("navigation.update_collision_entities.moved." + std::to_string(count), moved_seconds * 1000.0, "ms");
+    }
+
+    const auto rebuild_seconds { best_of(RUNS, [] {
+        terrain::rebuild_clearance();
+    }) };
+    std::printf("rebuild_clearance:          %8.3f ms\n", rebuild_seconds * 1000.0);
+    record("navigation.rebuild_clearance", rebuild_seconds * 1000.0, "ms");
+}
+
+// Fixed start and goal pairs over a grid with obstacles, find_path includes smoothing
+void bench_navigation() {
+    constexpr int pairs { 64 };
+    constexpr int sight_checks { 100000 };
+
+    flecs::world ecs;
+    populate_colliders(ecs, 2000);
+    terrain::update_collision_entities(ecs);
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER * 0.8f, WORLD_CENTER * 0.8f);
+    std::vector<std::pair<Vector3, Vector3>> requests(pairs);
+    for (auto &[start, goal] : requests) {
+        start = { position(rng), 0.0f, position(rng) };
+        goal = { position(rng), 0.0f, position(rng) };
+    }
+
+    // Solved paths are cached by micropather, so only the first pass over the pairs is timed
+    MoveTo move_to {};
+    size_t waypoints { 0 };
+    const auto path_start { Clock::now() };
+    for (const auto &[start, goal] : requests) {
+        move_to.path.clear();
+        terrain::find_path(start, goal, move_to.path);
+        waypoints += move_to.path.size();
+    }
+    const auto path_ms { seconds_since(path_start) * 1000.0 / pairs };
+
+    // Wide agents get a graph and a cache of their own
+    size_t wide_waypoints { 0 };
+    const auto wide_start { Clock::now() };
+    for (const auto &[start, goal] : requests) {
+        move_to.path.clear();
+        terrain::find_path(start, goal, move_to.path, 0.5f);
+        wide_waypoints += move_to.path.size();
+    }
+    const auto wide_ms { seconds_since(wide_start) * 1000.0 / pairs };
+
+    std::vector<std::pair<Vector3, Vector3>> segments(sight_checks);
+    std::uniform_real_distribution offset(-4.0f, 4.0f);
+    for (auto &[from, to] : segments) {
+        from = { position(rng), 0.0f, position(rng) };
+        to = { from.x + offset(rng), 0.0f, from.z + offset(rng) };
+    }
+
+    auto visible { 0 };
+    const auto sight_seconds { best_of(RUNS, [&] {
+        visible = 0;
+        for (const auto &[from, to] : segments) {
+            visible += terrain::has_line_of_sight(from, to);
+        }
+    }) };
+    const auto sight_ns { sight_seconds * 1e9 / sight_checks };
+
+    auto wide_visible { 0 };
+    const auto wide_sight_seconds { best_of(RUNS, [&] {
+        wide_visible = 0;
+        for (const auto &[from, to] : segments) {
+            wide_visible += terrain::has_line_of_sight(from, to, 0.5f);
+        }
+    }) };
+    const auto wide_sight_ns { wide_sight_seconds * 1e9 / sight_checks };
+
+    std::printf("find_path + smooth_path:    %8.3f ms/path (%zu waypoints over %d paths)\n", path_ms, waypoints, pairs);
+    std::printf("  radius 0.5:               %8.3f ms/path (%zu waypoints over %d paths)\n", wide_ms, wide_waypoints, pairs);
+    std::printf("has_line_of_sight:          %8.1f ns/op (%d of %d visible)\n", sight_ns, visible, sight_checks);
+    std::printf("  radius 0.5:               %8.1f ns/op (%d of %d visible)\n", wide_sight_ns, wide_visible, sight_checks);
+    record("navigation.find_path", path_ms, "ms/path");
+    record("navigation.find_path.radius", wide_ms, "ms/path");
+    record("navigation.has_line_of_sight", sight_ns, "ns/op");
+    record("navigation.has_line_of_sight.radius", wide_sight_ns, "ns/op");
+
+    // Both solvers on the same pairs, micropather starts cold on every pair so its counts aren't
+    // hidden by the cache. The jump tables are built once up front, outside the timing.
+    terrain::set_path_solver(terrain::PathSolver::JumpPoint);
+    move_to.path.clear();
+    terrain::find_path(requests[0].first, requests[0].second, move_to.path);
+
+    for (const auto solver : { terrain::PathSolver::MicroPather, terrain::PathSolver::JumpPoint }) {
+        terrain::set_path_solver(solver);
+        long expanded { 0 };
+        auto solve_ms { 0.0 };
+
+        for (const auto &[start, goal] : requests) {
+            terrain::reset_path_cache();
+            move_to.path.clear();
+            terrain::find_path(start, goal, move_to.path);
+
+            const auto stats { terrain::last_path_stats() };
+            expanded += stats.expanded;
+            solve_ms += stats.solve_ms;
+        }
+
+        const auto name { solver == terrain::PathSolver::JumpPoint ? "jps" : "micropather" };
+        std::printf("solve %-12s          %8.3f ms/path, %6ld nodes expanded/path\n", name, solve_ms / pairs, expanded / pairs);
+        record(std::string("navigation.solve.") + name, solve_ms / pairs, "ms/path");
+        record(std::string("navigation.expanded.") + name, static_cast<double>(expanded) / pairs, "nodes/path");
+    }
+
+    terrain::set_path_solver(terrain::PathSolver::MicroPather);
+}
+
+// Brush strokes over land with colliders in place, the elevation is put back afterwards so later
+// kernels see the generated terrain. Without a GL context only the heights and path tiles update.
+void bench_deform() {
+    constexpr int strokes { 200 };
+
+    auto world { World::create_world() };
+    populate_colliders(world.ecs, 2000);
+    terrain::update_collision_entities(world.ecs);
+
+    const std::vector<uint16_t> saved(terrain::elevation.values(), terrain::elevation.values() + terrain::elevation.count());
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution position(-WORLD_CENTER * 0.8f, WORLD_CENTER * 0.8f);
+    std::vector<Vector3> centers(strokes);
+    for (auto &center : centers) {
+        center = { position(rng), 0.0f, position(rng) };
+    }
+
+    for (const auto radius : { 1.0f, 4.0f }) {
+        auto stroke { 0 };
+        const auto seconds { best_of(RUNS, [&] {
+            for (const auto &center : centers) {
+                terrain::deform(world, center, {
+                    .mode = ++stroke % 2 == 0 ? terrain::BrushMode::Raise : terrain::BrushMode::Lower,
+                    .radius = radius,
+                    .strength = 0.05f,
+                });
+            }
+        }) };
+
+        const auto stroke_us { seconds * 1e6 / strokes };
+        std::printf("deform radius %.0f:            %8.2f us/stroke\n", radius, stroke_us);
+        record("terrain.deform.radius_" + std::to_string(static_cast<int>(radius)), stroke_us, "us/stroke");
+    }
+
+    std::copy(saved.begin(), saved.end(), terrain::elevation.values());
+    terrain::update_height_planes(0, 0, HEIGHT_CELLS, HEIGHT_CELLS);
+    terrain::update_ground_tiles(0, 0, GRID_SIZE, GRID_SIZE);
+}
+
+// Ground cost at 256 and 1024 cells a side. The terrain size is fixed at compile time, so the
+// chunk count is what scales: vertices are written for every chunk and level with the chunk
+// origins wrapping around the real heightfield, and the draw list is picked from a chunk grid
+// of that size. Without a GL context uploads are left out.
+void bench_ground_sizes() {
+    constexpr int frames { 100 };
+    constexpr int real_chunks { (DETAILED_SIZE - 1 + GROUND_CHUNK_SIZE - 1) / GROUND_CHUNK_SIZE };
+    constexpr int chunk_vertices { (GROUND_CHUNK_SIZE + 1) * (GROUND_CHUNK_SIZE + 1) };
+
+    const Camera camera {
+        .position { 0.0f, 10.0f, 12.0f },
+        .target { 0.0f, 0.0f, 0.0f },
+        .up { 0.0f, 1.0f, 0.0f },
+        .fovy = 45.0f,
+        .projection = CAMERA_PERSPECTIVE,
+    };
+    const auto frustum { culling::camera_frustum(camera, 16.0f / 9.0f) };
+
+    std::vector<float> vertices(chunk_vertices * 3);
+    std::vector<float> morphs(chunk_vertices * 2);
+    std::vector<float> normals(chunk_vertices * 3);
+
+    for (const auto cells : { 256, 1024 }) {
+        const auto chunks_per_side { cells / GROUND_CHUNK_SIZE };
+        const auto chunks { chunks_per_side * chunks_per_side };
+
+        const auto generate_seconds { best_of(RUNS, [&] {
+            for (auto chunk { 0 }; chunk < chunks; ++chunk) {
+                const auto x0 { chunk % chunks_per_side % real_chunks * GROUND_CHUNK_SIZE };
+                const auto z0 { chunk / chunks_per_side % real_chunks * GROUND_CHUNK_SIZE };
+
+                for (auto level { 0 }; level < GROUND_LOD_LEVELS; ++level) {
+                    const auto step { 1 << level };
+                    auto index { 0 };
+                    for (auto z { z0 }; z <= z0 + GROUND_CHUNK_SIZE; z += step) {
+                        for (auto x { x0 }; x <= x0 + GROUND_CHUNK_SIZE; x += step, ++index) {
+                            terrain::write_chunk_vertex(x, z, level, &vertices[index * 3], &morphs[index * 2], &normals[index * 3]);
+                        }
+                    }
+                }
+            }
+        }) };
+
+        // Flat chunk boxes centred on the camera target
+        const auto chunk_world { static_cast<float>(GROUND_CHUNK_SIZE) / DETAIL };
+        const auto origin { -chunk_world * static_cast<float>(chunks_per_side) * 0.5f };
+        std::vector<BoundingBox> bounds;
+        for (auto chunk { 0 }; chunk < chunks; ++chunk) {
+            const auto x { origin + static_cast<float>(chunk % chunks_per_side) * chunk_world };
+            const auto z { origin + static_cast<float>(chunk / chunks_per_side) * chunk_world };
+            bounds.push_back({ { x, -2.0f, z }, { x + chunk_world, 2.0f, z + chunk_world } });
+        }
+
+        // The work queue_ground does per frame, culling and a level per chunk, then the sort
+        render_queue::Queue queue;
+        auto drawn { 0 };
+        const auto start { Clock::now() };
+        for (auto frame { 0 }; frame < frames; ++frame) {
+            queue.begin(camera.position);
+            drawn = 0;
+            for (size_t i { 0 }; i < bounds.size(); ++i) {
+                if (!culling::is_box_visible(frustum, bounds[i])) {
+                    continue;
+                }
+
+                const auto center { Vector3Scale(Vector3Add(bounds[i].min, bounds[i].max), 0.5f) };
+                queue.push_ground(1, 1, static_cast<int>(i), terrain::ground_lod(bounds[i], camera.position), center);
+                ++drawn;
+            }
+            queue.sort();
+        }
+        const auto draw_list_us { seconds_since(start) * 1e6 / frames };
+
+        std::printf("ground %4d^2, %4d chunks:   %8.3f ms vertices, %8.2f us draw list (%d drawn)\n", cells, chunks,
+            generate_seconds * 1000.0, draw_list_us, drawn);
+        record("terrain.ground_vertices." + std::to_string(cells), generate_seconds * 1000.0, "ms");
+        record("render.ground_draw_list." + std::to_string(cells), draw_list_us, "us");
+    }
+}
+
+// One consumer scanning every consumable, none in range so the world stays the same between runs
+void bench_eat_system() {
+    for (const auto count : { 100, 1000, 10000 }) {
+        auto world { World::create_world() };
+        world.ecs.entity()
+            .set<Consumer>({ .range = 0.5f })
+            .set<WorldTransform>({ .pos = { 0.0f, 0.0f, 0.0f } })
+            .set<Animation>({ .name { "Idle" } });
+
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(2.0f, WORLD_CENTER);
+        for (int i { 0 }; i < count; ++i) {
+            world.ecs.entity()
+                .set<Consumable>({ .particles = 25 })
+                .set<WorldTransform>({ .pos = { position(rng), 0.0f, position(rng) } });
+        }
+
+        const auto eat { world.ecs.system(world.ecs.lookup("eat")) };
+        const auto seconds { best_of(RUNS, [&eat] {
+            for (int tick { 0 }; tick < 60; ++tick) {
+                eat.run(FIXED_DT);
+            }
+        }) };
+
+        const auto tick_us { seconds * 1e6 / 60.0 };
+        std::printf("eat_system %5d consumables: %8.2f us/tick\n", count, tick_us);
+        record("gameplay.eat_system." + std::to_string(count), tick_us, "us/tick");
+    }
+}
+
+// Crowds walking through each other at a fixed density, only the avoidance step is timed so the
+// crowd stays in place between runs
+void bench_avoidance() {
+    for (const auto count : { 1000, 5000, 10000 }) {
+        auto world { World::create_world() };
+
+        // About two square units per agent, close enough that most of them have neighbours
+        const auto half_extent { std::sqrt(static_cast<float>(count) * 2.0f) * 0.5f };
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(-half_extent, half_extent);
+        std::uniform_real_distribution angle(0.0f, 2.0f * PI);
+
+        for (int i { 0 }; i < count; ++i) {
+            const auto heading { angle(rng) };
+            world.ecs.entity()
+                .set<WorldTransform>({ .pos = { position(rng), 0.0f, position(rng) } })
+                .set<Steering>({
+                    .preferred = { std::sin(heading) * 0.05f, std::cos(heading) * 0.05f },
+                    .velocity = {},
+                    .max_speed = 0.05f,
+                })
+                .set<Agent>({ .radius = 0.4f });
+        }
+
+        const auto avoid { world.ecs.system(world.ecs.lookup("avoid")) };
+        const auto seconds { best_of(RUNS, [&avoid] {
+            for (int tick { 0 }; tick < 60; ++tick) {
+                avoid.run(FIXED_DT);
+            }
+        }) };
+
+        const auto tick_ms { seconds * 1000.0 / 60.0 };
+        std::printf("avoidance %5d agents: %8.3f ms/tick\n", count, tick_ms);
+        record("gameplay.avoidance." + std::to_string(count), tick_ms, "ms/tick");
+    }
+}
+
+// Spinning and bouncing props around the camera target, the fixed pipelines with the default
+// LOD bands against every entity at full rate
+void bench_sim_lod() {
+    constexpr int count { 10000 };
+    constexpr int ticks { 60 };
+
+    for (const auto reduced : { false, true }) {
+        auto world { World::create_world() };
+        world.ecs.set<WorldCamera>({
+            .camera { Camera {
+                .position { 0.0f, 12.0f, -12.0f },
+                .target { 0.0f, 0.0f, 0.0f },
+                .up { 0.0f, 1.0f, 0.0f },
+                .fovy = 45.0f,
+                .projection = CAMERA_PERSPECTIVE,
+            }},
+            .distance = 12.0f,
+        });
+        if (!reduced) {
+            world.ecs.set<SimLodConfig>({ .mid_interval = 1, .far_interval = 1, .hidden_interval = 1 });
+        }
+
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(-24.0f, 24.0f);
+        for (int i { 0 }; i < count; ++i) {
+            const Vector3 pos { position(rng), 0.0f, position(rng) };
+            world.ecs.entity()
+                .set<WorldTransform>({ .pos = pos })
+                .set<Spin>({ .speed = 1.0f })
+                .set<Bounce>({ .speed = 0.05f, .height = 0.2f, .elapsed = 0.0f, .center_y = 0.5f });
+        }
+
+        const auto seconds { best_of(RUNS, [&world] {
+            for (int tick { 0 }; tick < ticks; ++tick) {
+                world.ecs.run_pipeline(world.pre_fixed_pipeline, FIXED_DT);
+                world.ecs.run_pipeline(world.fixed_pipeline, FIXED_DT);
+            }
+        }) };
+
+        const auto *stats { world.ecs.get<SimLodStats>() };
+        const auto tick_us { seconds * 1e6 / ticks };
+        const auto *label { reduced ? "lod" : "full_rate" };
+        std::printf("sim_lod %-9s %5d entities: %8.2f us/tick (%d at full rate, %d due last tick)\n",
+            label, count, tick_us, stats->full_rate, stats->due);
+        record(std::string("gameplay.sim_lod.") + label, tick_us, "us/tick");
+    }
+}
+
+// Animated characters looping their clips around the camera target, the fixed side clock
+// advance and the render side pose sampling timed separately. Needs the clips of bix.glb,
+// so it runs from the repository root.
+void bench_animation() {
+    constexpr int ticks { 60 };
+
+    const auto handle { assets::load_animations(ASSET_PATH("models/bix.glb")) };
+    assets::process_uploads(1000.0);
+    if (const auto *set { assets::get(handle) }; set == nullptr || set->count == 0) {
+        std::printf("animation: models/bix.glb not found, skipped\n");
+        return;
+    }
+
+    for (const auto count : { 1000, 10000 }) {
+        auto world { World::create_world() };
+        world.ecs.set<WorldCamera>({
+            .camera { Camera {
+                .position { 0.0f, 12.0f, -12.0f },
+                .target { 0.0f, 0.0f, 0.0f },
+                .up { 0.0f, 1.0f, 0.0f },
+                .fovy = 45.0f,
+                .projection = CAMERA_PERSPECTIVE,
+            }},
+            .distance = 12.0f,
+        });
+
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution position(-24.0f, 24.0f);
+        for (int i { 0 }; i < count; ++i) {
+            const Vector3 pos { position(rng), 0.0f, position(rng) };
+            world.ecs.entity()
+                .set<WorldModel>({ .animations = handle })
+                .set<SimLod>({})
+                .set<Animation>({ .name { i % 2 == 0 ? "Idle" : "Run" } })
+                .set<InterpolationState>({ .render_pos = pos });
+        }
+
+        const auto advance { world.ecs.system(world.ecs.lookup("advance_animation")) };
+        const auto advance_seconds { best_of(RUNS, [&advance] {
+            for (int tick { 0 }; tick < ticks; ++tick) {
+                advance.run(FIXED_DT);
+            }
+        }) };
+
+        // Every model sampled each frame first, then with the sampling LOD spreading them out.
+        // Without a window the screen is empty, so the LOD run treats every model as offscreen.
+        const auto animate { world.ecs.system(world.ecs.lookup("animate_model")) };
+        const auto animate_us { [&animate](const bool lod) {
+            render_systems::set_animation_lod(lod);
+            const auto seconds { best_of(RUNS, [&animate] {
+                for (int frame { 0 }; frame < ticks; ++frame) {
+                    animate.run(0.5f);
+                }
+            }) };
+            return seconds * 1e6 / ticks;
+        } };
+        const auto every_frame_us { animate_us(false) };
+        const auto lod_us { animate_us(true) };
+
+        const auto advance_us { advance_seconds * 1e6 / ticks };
+        std::printf("animation %5d entities: %8.2f us/tick advance, %8.2f us/frame animate every frame, %8.2f us/frame with LOD (%.1fx)\n",
+            count, advance_us, every_frame_us, lod_us, every_frame_us / lod_us);
+        record("render.advance_animation." + std::to_string(count), advance_us, "us/tick");
+        record("render.animate_model.every_frame." + std::to_string(count), every_frame_us, "us/frame");
+        record("render.animate_model." + std::to_string(count), lod_us, "us/frame");
+    }
+}
@@ -0,0 +1,555 @@
+#include "assets.h"
+#include "pack.h"
+#include "world/uniforms.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace assets {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        struct TexturePayload {
+            Image image {};
+            TextureOptions options {};
+        };
+
+        struct ShaderPayload {
+            std::string fs_path;
+            char *vs_code { nullptr };
+            char *fs_code { nullptr };
+        };
+
+        template <typename T, typename Payload>
+        struct Entry {
+            std::string path;
+            T asset {};
+            Payload payload {};
+            bool ready { false };
+            Clock::time_point requested {};
+            Clock::time_point decoded {};
+            std::vector<std::function<void(const T&)>> callbacks {};
+        };
+
+        // Entries live in a deque so workers can keep pointers to them while new requests are added
+        template <typename T, typename Payload>
+        struct Registry {
+            std::deque<Entry<T, Payload>> entries {};
+            std::map<std::string, int> by_path {};
+        };
+
+        Registry<Model, ModelOptions> models;
+        Registry<AnimationSet, AnimationSet> animations;
+        Registry<Texture2D, TexturePayload> textures;
+        Registry<Shader, ShaderPayload> shaders;
+        std::deque<Palette> palettes;
+
+        std::mutex job_mutex;
+        std::condition_variable job_signal;
+        std::deque<std::function<void()>> jobs;
+        std::vector<std::thread> workers;
+        bool stopping { false };
+
+        std::mutex upload_mutex;
+        std::deque<std::function<void()>> uploads;
+
+        std::atomic<int> outstanding { 0 };
+
+        // Files read once and served to several raylib loaders from memory, see load_animated_model
+        std::mutex file_cache_mutex;
+        std::map<std::string, std::vector<unsigned char>> file_cache;
+
+        // Installed as raylib's file data callback, everything that isn't cached is read from
+        // disk the way LoadFileData does without one
+        auto load_file_data(const char *path, int *size) -> unsigned char* {
+            *size = 0;
+            {
+                std::lock_guard lock { file_cache_mutex };
+                if (const auto it { file_cache.find(path) }; it != file_cache.end()) {
+                    auto *data { static_cast<unsigned char*>(MemAlloc(static_cast<unsigned int>(it->second.size()))) };
+                    std::memcpy(data, it->second.data(), it->second.size());
+                    *size = static_cast<int>(it->second.size());
+                    return data;
+                }
+            }
+
+            auto *file { std::fopen(path, "rb") };
+            if (file == nullptr) {
+                TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to open file", path);
+                return nullptr;
+            }
+
+            std::fseek(file, 0, SEEK_END);
+            const auto length { std::ftell(file) };
+            std::fseek(file, 0, SEEK_SET);
+
+            unsigned char *data { nullptr };
+            if (length > 0) {
+                data = static_cast<unsigned char*>(MemAlloc(static_cast<unsigned int>(length)));
+                *size = static_cast<int>(std::fread(data, 1, static_cast<size_t>(length), file));
+            }
+
+            std::fclose(file);
+            return data;
+        }
+
+        void apply_model_options(Entry<Model, ModelOptions> &entry) {
+            if (!entry.payload.mipmaps) {
+                return;
+            }
+
+            for (int i { 0 }; i < entry.asset.materialCount; i++) {
+                if (auto &texture { entry.asset.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture }; texture.id > 0) {
+                    GenTextureMipmaps(&texture);
+                    SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+                }
+            }
+        }
+
+        auto elapsed_ms(const Clock::time_point from, const Clock::time_point to) -> double {
+            return std::chrono::duration<double, std::milli>(to - from).count();
+        }
+
+        void worker_loop() {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock lock { job_mutex };
+                    job_signal.wait(lock, [] { return stopping || !jobs.empty(); });
+
+                    if (stopping && jobs.empty()) {
+                        return;
+                    }
+
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+
+                job();
+            }
+        }
+
+        // Runs on a worker, or inline when no workers have been started
+        void queue_job(std::function<void()> job) {
+            if (workers.empty()) {
+                job();
+                return;
+            }
+
+            {
+                std::lock_guard lock { job_mutex };
+                jobs.push_back(std::move(job));
+            }
+            job_signal.notify_one();
+        }
+
+        void queue_upload(std::function<void()> upload) {
+            std::lock_guard lock { upload_mutex };
+            uploads.push_back(std::move(upload));
+        }
+
+        template <typename T, typename Payload>
+        auto request(Registry<T, Payload> &registry, const std::string &path, bool &created) -> Entry<T, Payload>* {
+            if (const auto it { registry.by_path.find(path) }; it != registry.by_path.end()) {
+                created = false;
+                return &registry.entries[it->second];
+            }
+
+            registry.by_path[path] = static_cast<int>(registry.entries.size());
+            auto &entry { registry.entries.emplace_back() };
+            entry.path = path;
+            entry.requested = Clock::now();
+
+            ++outstanding;
+            created = true;
+            return &entry;
+        }
+
+        template <typename T, typename Payload>
+        auto handle_of(const Registry<T, Payload> &registry, const Entry<T, Payload> *entry) -> Handle<T> {
+            return { registry.by_path.at(entry->path) };
+        }
+
+        template <typename T, typename Payload>
+        void resolve(Entry<T, Payload> &entry) {
+            const auto now { Clock::now() };
+            entry.ready = true;
+            --outstanding;
+
+            TraceLog(LOG_INFO, "ASSETS: [%s] decoded in %.2f ms, uploaded in %.2f ms, ready after %.2f ms",
+                entry.path.c_str(),
+                elapsed_ms(entry.requested, entry.decoded),
+                elapsed_ms(entry.decoded, now),
+                elapsed_ms(entry.requested, now));
+
+            const auto callbacks { std::move(entry.callbacks) };
+            entry.callbacks.clear();
+
+            for (const auto &callback : callbacks) {
+                callback(entry.asset);
+            }
+        }
+
+        template <typename T, typename Payload>
+        auto find(Registry<T, Payload> &registry, const Handle<T> handle) -> Entry<T, Payload>* {
+            if (handle.id < 0 || handle.id >= static_cast<int>(registry.entries.size())) {
+                return nullptr;
+            }
+
+            return &registry.entries[handle.id];
+        }
+
+        template <typename T, typename Payload>
+        auto get_ready(Registry<T, Payload> &registry, const Handle<T> handle) -> const T* {
+            const auto *entry { find(registry, handle) };
+            return entry != nullptr && entry->ready ? &entry->asset : nullptr;
+        }
+
+        template <typename T, typename Payload>
+        void add_callback(Registry<T, Payload> &registry, const Handle<T> handle, std::function<void(const T&)> callback) {
+            auto *entry { find(registry, handle) };
+            if (entry == nullptr) {
+                return;
+            }
+
+            if (entry->ready) {
+                callback(entry->asset);
+            } else {
+                entry->callbacks.push_back(std::move(callback));
+            }
+        }
+    }
+
+    void start(const int worker_count) {
+        stopping = false;
+
+#ifndef PLATFORM_ANDROID
+        SetLoadFileDataCallback(load_file_data);
+#endif
+
+        for (int i { 0 }; i < worker_count; ++i) {
+            workers.emplace_back(worker_loop);
+        }
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard lock { job_mutex };
+            stopping = true;
+        }
+        job_signal.notify_all();
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        for (auto &entry : models.entries) {
+            if (entry.ready) UnloadModel(entry.asset);
+        }
+
+        for (auto &entry : animations.entries) {
+            if (entry.ready) UnloadModelAnimations(entry.asset.animations, entry.asset.count);
+        }
+
+        for (auto &entry : textures.entries) {
+            if (entry.ready) UnloadTexture(entry.asset);
+            if (entry.payload.image.data != nullptr) UnloadImage(entry.payload.image);
+        }
+
+        for (auto &entry : shaders.entries) {
+            if (entry.ready) {
+                uniforms::forget(entry.asset);
+                UnloadShader(entry.asset);
+            }
+            if (entry.payload.vs_code != nullptr) UnloadFileText(entry.payload.vs_code);
+            if (entry.payload.fs_code != nullptr) UnloadFileText(entry.payload.fs_code);
+        }
+
+#ifndef PLATFORM_ANDROID
+        SetLoadFileDataCallback(nullptr);
+#endif
+        file_cache.clear();
+
+        models = {};
+        animations = {};
+        textures = {};
+        shaders = {};
+        palettes.clear();
+        uploads.clear();
+        outstanding = 0;
+    }
+
+    auto load_model(const std::string &path, const ModelOptions options) -> Handle<Model> {
+        auto created { false };
+        auto *entry { request(models, path, created) };
+
+        if (created) {
+            entry->payload = options;
+            entry->decoded = entry->requested;
+
+            // Baked models come with their mip chains and are uploaded straight from the pack
+            if (const auto *baked { pack::find(path, pack::EntryType::Model) }) {
+                queue_upload([entry, baked] {
+                    entry->asset = pack::load_model(*baked);
+
+                    if (entry->payload.mipmaps) {
+                        for (int i { 0 }; i < entry->asset.materialCount; i++) {
+                            if (const auto &texture { entry->asset.materials[i].maps[MATERIAL_MAP_DIFFUSE].texture }; texture.mipmaps > 1) {
+                                SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+                            }
+                        }
+                    }
+
+                    resolve(*entry);
+                });
+
+                return handle_of(models, entry);
+            }
+
+            // raylib uploads meshes and embedded textures while parsing glTF, so models
+            // are loaded entirely on the render thread within the upload budget
+            queue_upload([entry] {
+                entry->asset = LoadModel(entry->path.c_str());
+                apply_model_options(*entry);
+                resolve(*entry);
+            });
+        }
+
+        return handle_of(models, entry);
+    }
+
+    auto load_animations(const std::string &path) -> Handle<AnimationSet> {
+        auto created { false };
+        auto *entry { request(animations, path, created) };
+
+        if (created) {
+            const auto *baked { pack::find(path, pack::EntryType::Animations) };
+
+            queue_job([entry, baked] {
+                entry->payload.animations = baked != nullptr
+                    ? pack::load_animations(*baked, &entry->payload.count)
+                    : LoadModelAnimations(entry->path.c_str(), &entry->payload.count);
+                entry->decoded = Clock::now();
+
+                queue_upload([entry] {
+                    entry->asset = entry->payload;
+                    resolve(*entry);
+                });
+            });
+        }
+
+        return handle_of(animations, entry);
+    }
+
+    auto load_animated_model(const std::string &path, const ModelOptions options) -> AnimatedModel {
+        const auto baked { pack::find(path, pack::EntryType::Model) != nullptr && pack::find(path, pack::EntryType::Animations) != nullptr };
+        const auto requested { models.by_path.count(path) > 0 || animations.by_path.count(path) > 0 };
+
+        // Baked assets never touch the glTF, and on Android raylib reads APK assets itself
+#ifdef PLATFORM_ANDROID
+        constexpr auto shares_file { false };
+#else
+        const auto shares_file { !baked && !requested };
+#endif
+        if (!shares_file) {
+            return { load_model(path, options), load_animations(path) };
+        }
+
+        auto created { false };
+        auto *model { request(models, path, created) };
+        auto *clips { request(animations, path, created) };
+        model->payload = options;
+
+        // The worker reads the file into the cache and parses the clips from it, the model is
+        // built from the same bytes on the render thread and the last one out drops them
+        queue_job([model, clips] {
+            int size { 0 };
+            auto *data { LoadFileData(model->path.c_str(), &size) };
+            {
+                std::lock_guard lock { file_cache_mutex };
+                file_cache[model->path].assign(data, data + size);
+            }
+            UnloadFileData(data);
+
+            clips->payload.animations = LoadModelAnimations(clips->path.c_str(), &clips->payload.count);
+            clips->decoded = Clock::now();
+            model->decoded = clips->decoded;
+
+            queue_upload([model, clips] {
+                clips->asset = clips->payload;
+                resolve(*clips);
+
+                model->asset = LoadModel(model->path.c_str());
+                {
+                    std::lock_guard lock { file_cache_mutex };
+                    file_cache.erase(model->path);
+                }
+                apply_model_options(*model);
+                resolve(*model);
+            });
+        });
+
+        return { handle_of(models, model), handle_of(animations, clips) };
+    }
+
+    auto load_texture(const std::string &path, const TextureOptions options) -> Handle<Texture2D> {
+        auto created { false };
+        auto *entry { request(textures, path, created) };
+
+        if (created) {
+            entry->payload.options = options;
+
+            if (const auto *baked { pack::find(path, pack::EntryType::Texture) }) {
+                entry->decoded = entry->requested;
+
+                queue_upload([entry, baked] {
+                    entry->asset = pack::load_texture(*baked);
+                    SetTextureFilter(entry->asset, entry->payload.options.filter);
+                    SetTextureWrap(entry->asset, entry->payload.options.wrap);
+                    resolve(*entry);
+                });
+
+                return handle_of(textures, entry);
+            }
+
+            // Decode and build the mip chain on the CPU, the render thread only uploads
+            queue_job([entry] {
+                entry->payload.image = LoadImage(entry->path.c_str());
+                if (entry->payload.options.mipmaps) {
+                    ImageMipmaps(&entry->payload.image);
+                }
+                entry->decoded = Clock::now();
+
+                queue_upload([entry] {
+                    entry->asset = LoadTextureFromImage(entry->payload.image);
+                    SetTextureFilter(entry->asset, entry->payload.options.filter);
+                    SetTextureWrap(entry->asset, entry->payload.options.wrap);
+
+                    UnloadImage(entry->payload.image);
+                    entry->payload.image = {};
+                    resolve(*entry);
+                });
+            });
+        }
+
+        return handle_of(textures, entry);
+    }
+
+    auto load_shader(const std::string &vs_path, const std::string &fs_path) -> Handle<Shader> {
+        auto created { false };
+        auto *entry { request(shaders, vs_path + ";" + fs_path, created) };
+
+        if (created) {
+            entry->payload.fs_path = fs_path;
+
+            queue_job([entry, vs_path] {
+                entry->payload.vs_code = LoadFileText(vs_path.c_str());
+                entry->payload.fs_code = LoadFileText(entry->payload.fs_path.c_str());
+                entry->decoded = Clock::now();
+
+                queue_upload([entry] {
+                    entry->asset = LoadShaderFromMemory(entry->payload.vs_code, entry->payload.fs_code);
+
+                    UnloadFileText(entry->payload.vs_code);
+                    UnloadFileText(entry->payload.fs_code);
+                    entry->payload.vs_code = nullptr;
+                    entry->payload.fs_code = nullptr;
+                    resolve(*entry);
+                });
+            });
+        }
+
+        return handle_of(shaders, entry);
+    }
+
+    auto add_palette(Palette colors) -> Handle<Palette> {
+        palettes.push_back(std::move(colors));
+        return { static_cast<int>(palettes.size()) - 1 };
+    }
+
+    auto get(const Handle<Model> handle) -> const Model* {
+        return get_ready(models, handle);
+    }
+
+    auto get(const Handle<AnimationSet> handle) -> const AnimationSet* {
+        return get_ready(animations, handle);
+    }
+
+    auto get(const Handle<Texture2D> handle) -> const Texture2D* {
+        return get_ready(textures, handle);
+    }
+
+    auto get(const Handle<Shader> handle) -> const Shader* {
+        return get_ready(shaders, handle);
+    }
+
+    auto get(const Handle<Palette> handle) -> const Palette* {
+        if (handle.id < 0 || handle.id >= static_cast<int>(palettes.size())) {
+            return nullptr;
+        }
+
+        return &palettes[handle.id];
+    }
+
+    auto find_animation(const AnimationSet &set, const std::string &name) -> int {
+        for (int i { 0 }; i < set.count; ++i) {
+            if (std::strcmp(set.animations[i].name, name.c_str()) == 0) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void on_ready(const Handle<Model> handle, std::function<void(const Model&)> callback) {
+        add_callback(models, handle, std::move(callback));
+    }
+
+    void on_ready(const Handle<AnimationSet> handle, std::function<void(const AnimationSet&)> callback) {
+        add_callback(animations, handle, std::move(callback));
+    }
+
+    void on_ready(const Handle<Texture2D> handle, std::function<void(const Texture2D&)> callback) {
+        add_callback(textures, handle, std::move(callback));
+    }
+
+    void on_ready(const Handle<Shader> handle, std::function<void(const Shader&)> callback) {
+        add_callback(shaders, handle, std::move(callback));
+    }
+
+    void process_uploads(const double budget_ms) {
+        const auto start { Clock::now() };
+
+        while (true) {
+            std::function<void()> upload;
+            {
+                std::lock_guard lock { upload_mutex };
+                if (uploads.empty()) {
+                    return;
+                }
+
+                upload = std::move(uploads.front());
+                uploads.pop_front();
+            }
+
+            upload();
+
+            if (elapsed_ms(start, Clock::now()) >= budget_ms) {
+                return;
+            }
+        }
+    }
+
+    auto pending() -> int {
+        return outstanding;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <functional>
+#include <raylib.h>
+#include <string>
+#include <vector>
+
+namespace assets {
+    // Lightweight reference to an asset that may still be loading
+    template <typename T>
+    struct Handle {
+        int id { -1 };
+
+        [[nodiscard]] auto valid() const -> bool { return id >= 0; }
+    };
+
+    struct AnimationSet {
+        ModelAnimation *animations { nullptr };
+        int count { 0 };
+    };
+
+    // Colors shared by every entity of a kind, registered once and referenced by handle
+    using Palette = std::vector<Color>;
+
+    struct TextureOptions {
+        bool mipmaps { false };
+        int filter { TEXTURE_FILTER_BILINEAR };
+        int wrap { TEXTURE_WRAP_REPEAT };
+    };
+
+    struct ModelOptions {
+        bool mipmaps { false };
+    };
+
+    struct AnimatedModel {
+        Handle<Model> model;
+        Handle<AnimationSet> animations;
+    };
+
+    void start(int worker_count = 2);
+    void shutdown();
+
+    // Requests are deduplicated by path, decoding runs on worker threads
+    auto load_model(const std::string &path, ModelOptions options = {}) -> Handle<Model>;
+    auto load_animations(const std::string &path) -> Handle<AnimationSet>;
+    // Mesh and clips of one glTF file, read from disk once for both
+    auto load_animated_model(const std::string &path, ModelOptions options = {}) -> AnimatedModel;
+    auto load_texture(const std::string &path, TextureOptions options = {}) -> Handle<Texture2D>;
+    auto load_shader(const std::string &vs_path, const std::string &fs_path) -> Handle<Shader>;
+    auto add_palette(Palette colors) -> Handle<Palette>;
+
+    // Returns nullptr until the asset has been uploaded
+    auto get(Handle<Model> handle) -> const Model*;
+    auto get(Handle<AnimationSet> handle) -> const AnimationSet*;
+    auto get(Handle<Texture2D> handle) -> const Texture2D*;
+    auto get(Handle<Shader> handle) -> const Shader*;
+    auto get(Handle<Palette> handle) -> const Palette*;
+
+    // Index of the named clip in the set, -1 when it doesn't exist
+    auto find_animation(const AnimationSet &set, const std::string &name) -> int;
+
+    // Callbacks run on the render thread once the asset is ready, immediately if it already is
+    void on_ready(Handle<Model> handle, std::function<void(const Model&)> callback);
+    void on_ready(Handle<AnimationSet> handle, std::function<void(const AnimationSet&)> callback);
+    void on_ready(Handle<Texture2D> handle, std::function<void(const Texture2D&)> callback);
+    void on_ready(Handle<Shader> handle, std::function<void(const Shader&)> callback);
+
+    // Performs pending GPU uploads on the render thread, limited by a per frame time budget
+    void process_uploads(double budget_ms = 4.0);
+    auto pending() -> int;
+}
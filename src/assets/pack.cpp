@@ -0,0 +1,268 @@
+#include "pack.h"
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <raymath.h>
+
+#ifndef PLATFORM_ANDROID
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace assets::pack {
+    namespace {
+        const uint8_t *data { nullptr };
+        uint64_t data_size { 0 };
+        std::string prefix;
+        std::map<std::pair<std::string, EntryType>, int> entries;
+
+        template <typename T>
+        auto at(const uint64_t offset) -> const T* {
+            return reinterpret_cast<const T*>(data + offset);
+        }
+
+        // Copies a mapped block into memory owned by raylib, so Unload* can free it
+        template <typename T>
+        auto copy(const uint64_t offset, const size_t count) -> T* {
+            if (offset == 0 || count == 0) {
+                return nullptr;
+            }
+
+            auto *result { static_cast<T*>(MemAlloc(static_cast<unsigned int>(count * sizeof(T)))) };
+            std::memcpy(result, data + offset, count * sizeof(T));
+            return result;
+        }
+
+        template <typename T>
+        auto view(const uint64_t offset) -> T* {
+            return offset == 0 ? nullptr : const_cast<T*>(at<T>(offset));
+        }
+
+        auto texture_from(const TextureData &texture) -> Texture2D {
+            const Image image {
+                .data = const_cast<uint8_t*>(data + texture.data_offset),
+                .width = texture.width,
+                .height = texture.height,
+                .mipmaps = texture.mipmaps,
+                .format = texture.format,
+            };
+
+            return LoadTextureFromImage(image);
+        }
+    }
+
+    auto mount(const std::string &path) -> bool {
+        const auto start { std::chrono::steady_clock::now() };
+        unmount();
+
+#ifdef PLATFORM_ANDROID
+        // APK assets can't be mapped through a file descriptor, read the pack in one go instead
+        int size { 0 };
+        auto *buffer { LoadFileData(path.c_str(), &size) };
+        if (buffer == nullptr) {
+            return false;
+        }
+
+        if (size < static_cast<int>(sizeof(Header))) {
+            UnloadFileData(buffer);
+            return false;
+        }
+
+        data = buffer;
+        data_size = static_cast<uint64_t>(size);
+#else
+        const auto fd { open(path.c_str(), O_RDONLY) };
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Header))) {
+            close(fd);
+            return false;
+        }
+
+        auto *mapped { mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+        close(fd);
+
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+
+        data = static_cast<const uint8_t*>(mapped);
+        data_size = static_cast<uint64_t>(info.st_size);
+#endif
+
+        const auto *header { at<Header>(0) };
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+            header->entries_offset % ALIGNMENT != 0 || header->entries_offset > data_size ||
+            header->entry_count > (data_size - header->entries_offset) / sizeof(Entry)) {
+            TraceLog(LOG_WARNING, "PACK: [%s] Invalid or outdated asset pack", path.c_str());
+            unmount();
+            return false;
+        }
+
+        // Every entry has to name its asset and point inside the pack before anything is read through it
+        const auto *table { at<Entry>(header->entries_offset) };
+        for (uint32_t i { 0 }; i < header->entry_count; ++i) {
+            const auto &entry { table[i] };
+            if (std::memchr(entry.path, '\0', sizeof(entry.path)) == nullptr || entry.offset % ALIGNMENT != 0 ||
+                entry.offset > data_size || entry.size > data_size - entry.offset) {
+                TraceLog(LOG_WARNING, "PACK: [%s] Entry %u is corrupt", path.c_str(), i);
+                unmount();
+                return false;
+            }
+
+            entries[{ entry.path, entry.type }] = static_cast<int>(i);
+        }
+
+        const auto separator { path.find_last_of('/') };
+        prefix = separator == std::string::npos ? "" : path.substr(0, separator + 1);
+
+        TraceLog(LOG_INFO, "PACK: [%s] Mounted %u entries (%.2f MB) in %.2f ms", path.c_str(), header->entry_count,
+            static_cast<double>(data_size) / (1024.0 * 1024.0),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        return true;
+    }
+
+    void unmount() {
+        if (data == nullptr) {
+            return;
+        }
+
+#ifdef PLATFORM_ANDROID
+        UnloadFileData(const_cast<uint8_t*>(data));
+#else
+        munmap(const_cast<uint8_t*>(data), static_cast<size_t>(data_size));
+#endif
+
+        data = nullptr;
+        data_size = 0;
+        prefix.clear();
+        entries.clear();
+    }
+
+    auto find(const std::string &path, const EntryType type) -> const Entry* {
+        if (data == nullptr || path.compare(0, prefix.size(), prefix) != 0) {
+            return nullptr;
+        }
+
+        const auto it { entries.find({ path.substr(prefix.size()), type }) };
+        if (it == entries.end()) {
+            return nullptr;
+        }
+
+        return &at<Entry>(at<Header>(0)->entries_offset)[it->second];
+    }
+
+    auto load_texture(const Entry &entry) -> Texture2D {
+        return texture_from(*at<TextureData>(entry.offset));
+    }
+
+    auto load_model(const Entry &entry) -> Model {
+        const auto &source { *at<ModelData>(entry.offset) };
+        const auto *table { at<Entry>(at<Header>(0)->entries_offset) };
+
+        Model model {};
+        model.transform = MatrixIdentity();
+        model.meshCount = source.mesh_count;
+        model.materialCount = source.material_count;
+        model.boneCount = source.bone_count;
+        model.meshes = static_cast<Mesh*>(MemAlloc(source.mesh_count * sizeof(Mesh)));
+        model.materials = static_cast<Material*>(MemAlloc(source.material_count * sizeof(Material)));
+        model.meshMaterial = copy<int>(source.mesh_material_offset, source.mesh_count);
+        model.bones = copy<BoneInfo>(source.bones_offset, source.bone_count);
+        model.bindPose = copy<Transform>(source.bind_pose_offset, source.bone_count);
+
+        const auto *meshes { at<MeshData>(source.meshes_offset) };
+        for (int i { 0 }; i < source.mesh_count; ++i) {
+            const auto &mesh_data { meshes[i] };
+            const auto vertex_count { static_cast<size_t>(mesh_data.vertex_count) };
+            auto &mesh { model.meshes[i] };
+
+            mesh.vertexCount = mesh_data.vertex_count;
+            mesh.triangleCount = mesh_data.triangle_count;
+
+            if (mesh_data.bone_ids != 0) {
+                // Skinned meshes are animated on the CPU, so raylib needs owned copies
+                mesh.vertices = copy<float>(mesh_data.vertices, vertex_count * 3);
+                mesh.texcoords = copy<float>(mesh_data.texcoords, vertex_count * 2);
+                mesh.normals = copy<float>(mesh_data.normals, vertex_count * 3);
+                mesh.colors = copy<unsigned char>(mesh_data.colors, vertex_count * 4);
+                mesh.indices = copy<unsigned short>(mesh_data.indices, static_cast<size_t>(mesh_data.triangle_count) * 3);
+                mesh.boneIds = copy<unsigned char>(mesh_data.bone_ids, vertex_count * 4);
+                mesh.boneWeights = copy<float>(mesh_data.bone_weights, vertex_count * 4);
+                mesh.animVertices = copy<float>(mesh_data.vertices, vertex_count * 3);
+                mesh.animNormals = copy<float>(mesh_data.normals, vertex_count * 3);
+
+                mesh.boneCount = source.bone_count;
+                mesh.boneMatrices = static_cast<Matrix*>(MemAlloc(source.bone_count * sizeof(Matrix)));
+                for (int bone { 0 }; bone < source.bone_count; ++bone) {
+                    mesh.boneMatrices[bone] = MatrixIdentity();
+                }
+
+                UploadMesh(&mesh, false);
+            } else {
+                // Static meshes upload straight from the mapped pack and keep no CPU copy of their
+                // vertices. DrawMesh only takes the indexed path while the indices are set, so those
+                // are copied, UnloadModel frees them.
+                mesh.vertices = view<float>(mesh_data.vertices);
+                mesh.texcoords = view<float>(mesh_data.texcoords);
+                mesh.normals = view<float>(mesh_data.normals);
+                mesh.colors = view<unsigned char>(mesh_data.colors);
+                mesh.indices = copy<unsigned short>(mesh_data.indices, static_cast<size_t>(mesh_data.triangle_count) * 3);
+
+                UploadMesh(&mesh, false);
+
+                mesh.vertices = nullptr;
+                mesh.texcoords = nullptr;
+                mesh.normals = nullptr;
+                mesh.colors = nullptr;
+            }
+        }
+
+        const auto *materials { at<MaterialData>(source.materials_offset) };
+        for (int i { 0 }; i < source.material_count; ++i) {
+            auto &material { model.materials[i] };
+            material = LoadMaterialDefault();
+            material.maps[MATERIAL_MAP_DIFFUSE].color = {
+                materials[i].color[0], materials[i].color[1], materials[i].color[2], materials[i].color[3]
+            };
+
+            if (materials[i].texture >= 0) {
+                material.maps[MATERIAL_MAP_DIFFUSE].texture = load_texture(table[materials[i].texture]);
+            }
+        }
+
+        return model;
+    }
+
+    auto load_animations(const Entry &entry, int *count) -> ModelAnimation* {
+        const auto &source { *at<AnimationsData>(entry.offset) };
+        const auto *clips { at<ClipData>(source.clips_offset) };
+
+        auto *animations { static_cast<ModelAnimation*>(MemAlloc(source.clip_count * sizeof(ModelAnimation))) };
+        for (int i { 0 }; i < source.clip_count; ++i) {
+            const auto &clip { clips[i] };
+            auto &animation { animations[i] };
+
+            std::memcpy(animation.name, clip.name, sizeof(animation.name));
+            animation.boneCount = clip.bone_count;
+            animation.frameCount = clip.frame_count;
+            animation.bones = copy<BoneInfo>(clip.bones_offset, clip.bone_count);
+            animation.framePoses = static_cast<Transform**>(MemAlloc(clip.frame_count * sizeof(Transform*)));
+
+            for (int frame { 0 }; frame < clip.frame_count; ++frame) {
+                const auto offset { clip.poses_offset + static_cast<uint64_t>(frame) * clip.bone_count * sizeof(Transform) };
+                animation.framePoses[frame] = copy<Transform>(offset, clip.bone_count);
+            }
+        }
+
+        *count = source.clip_count;
+        return animations;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <raylib.h>
+#include <string>
+
+// Baked asset pack, see tools/bake.cpp. All offsets are absolute from the start of the
+// pack and every block is 16 byte aligned so the runtime can use the mapped memory as is.
+namespace assets::pack {
+    constexpr char MAGIC[4] { 'B', 'X', 'P', 'K' };
+    constexpr uint32_t VERSION { 1 };
+    constexpr uint64_t ALIGNMENT { 16 };
+
+    enum class EntryType : uint32_t {
+        Texture = 0,
+        Model = 1,
+        Animations = 2,
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t reserved;
+        uint64_t entries_offset;
+    };
+
+    struct Entry {
+        char path[96];
+        EntryType type;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // Pixel data holds the full mip chain in raylib's layout
+    struct TextureData {
+        int32_t width;
+        int32_t height;
+        int32_t mipmaps;
+        int32_t format;
+        uint64_t data_offset;
+        uint64_t data_size;
+    };
+
+    // Array offsets are 0 when the attribute is absent
+    struct MeshData {
+        int32_t vertex_count;
+        int32_t triangle_count;
+        uint64_t vertices;
+        uint64_t texcoords;
+        uint64_t normals;
+        uint64_t colors;
+        uint64_t indices;
+        uint64_t bone_ids;
+        uint64_t bone_weights;
+    };
+
+    struct MaterialData {
+        uint8_t color[4];
+        int32_t texture; // Entry index of the diffuse texture, -1 for none
+    };
+
+    struct ModelData {
+        int32_t mesh_count;
+        int32_t material_count;
+        int32_t bone_count;
+        int32_t reserved;
+        uint64_t meshes_offset;
+        uint64_t materials_offset;
+        uint64_t mesh_material_offset;
+        uint64_t bones_offset;
+        uint64_t bind_pose_offset;
+    };
+
+    struct ClipData {
+        char name[32];
+        int32_t bone_count;
+        int32_t frame_count;
+        uint64_t bones_offset;
+        uint64_t poses_offset; // frame_count * bone_count transforms, frame major
+    };
+
+    struct AnimationsData {
+        int32_t clip_count;
+        int32_t reserved;
+        uint64_t clips_offset;
+    };
+
+    // Maps the pack into memory, paths are looked up relative to the directory of the pack
+    auto mount(const std::string &path) -> bool;
+    void unmount();
+
+    auto find(const std::string &path, EntryType type) -> const Entry*;
+
+    // Builders only copy or upload mapped data, nothing is parsed
+    auto load_texture(const Entry &entry) -> Texture2D;
+    auto load_model(const Entry &entry) -> Model;
+    auto load_animations(const Entry &entry, int *count) -> ModelAnimation*;
+}
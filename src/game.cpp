@@ -1,13 +1,56 @@
+#include <chrono>
 #include <flecs.h>
 #include <raylib.h>
+#include "assets/assets.h"
+#include "assets/pack.h"
+#include "memory/memory.h"
 #include "world/components/gameplay.h"
+#include "world/components/interpolation.h"
 #include "world/components/render.h"
+#include "world/components/streaming.h"
 #include "world/world.h"
+#include "world/quality.h"
+#include "world/snapshot.h"
+#include "world/spawner.h"
+#include "world/systems/streaming.h"
+#include "world/transforms.h"
 #include "game.h"
 #include "rlgl.h"
 #include "util.h"
 #include "world/terrain/terrain.h"
 
+constexpr auto SNAPSHOT_PATH { "snapshot.bin" };
+constexpr Color SKY_COLOR { 0, 128, 179, 1 };
+
+// Height change per second at the center of the terrain brush
+constexpr float BRUSH_RATE { 1.5f };
+
+namespace {
+    // Frame rate and what the quality governor last decided, toggled with F3
+    void draw_stats() {
+        const auto stats { quality::stats() };
+        const auto reason { stats.last.reason == quality::Reason::Overloaded ? "over budget"
+            : stats.last.reason == quality::Reason::Headroom ? "headroom" : "forced" };
+
+        DrawFPS(10, 10);
+        DrawText(TextFormat("quality %s, frame %.1f / %.1f ms, work %.1f ms, tick %.2f ms",
+            stats.name, stats.frame_ms, stats.target_ms, stats.work_ms, stats.tick_ms), 10, 34, 20, WHITE);
+
+        if (stats.changes > 0) {
+            DrawText(TextFormat("%d changes, last %s -> %s (%s at %.1f ms)", stats.changes, quality::tier(stats.last.from).name,
+                quality::tier(stats.last.to).name, reason, stats.last.frame_ms), 10, 58, 20, WHITE);
+        }
+
+        const auto path { terrain::last_path_stats() };
+        DrawText(TextFormat("path %s, %d nodes expanded in %.3f ms", path.solver == terrain::PathSolver::JumpPoint ? "jps+" : "micropather",
+            path.expanded, path.solve_ms), 10, 82, 20, WHITE);
+
+        const auto memory { memory::frame_counters() };
+        DrawText(TextFormat("memory %zu arena allocations (%zu KB), %zu allocator blocks, %zu heap allocations%s",
+            memory.arena_allocations, memory.arena_bytes / 1024, memory.allocator_blocks, memory.heap_allocations,
+            memory::COUNTS_HEAP ? "" : " (not counted)"), 10, 106, 20, WHITE);
+    }
+}
 
 void init_game() {
     auto world { World::create_world() };
@@ -24,210 +67,299 @@ void init_game() {
         .distance = 3.0f
     });
 
-    // Setup ground shader;
-    const auto ground_shader{ LoadShader(ASSET_PATH("shaders/ground.vs"), ASSET_PATH("shaders/ground.fs")) };
-    world.ecs.set<GroundShader>({
-        .shader { ground_shader },
-        .loc_light_dir { GetShaderLocation(ground_shader, "lightDir") },
-        .loc_light_color { GetShaderLocation(ground_shader, "lightColor") },
-        .loc_view_pos { GetShaderLocation(ground_shader, "viewPos") },
-        .loc_shadow_count { GetShaderLocation(ground_shader, "shadowCount") },
-        .loc_shadow_positions { GetShaderLocation(ground_shader, "shadowPositions") },
-        .loc_shadow_radii { GetShaderLocation(ground_shader, "shadowRadii") },
-        .loc_shadow_itensities { GetShaderLocation(ground_shader, "shadowIntensities") }
+    assets::start();
+    assets::pack::mount(ASSET_PATH("assets.pack"));
+
+    // Setup ground shader
+    assets::on_ready(assets::load_shader(ASSET_PATH("shaders/ground.vs"), ASSET_PATH("shaders/ground.fs")), [&world](const Shader &ground_shader) {
+        world.ecs.set<GroundShader>({
+            .shader { ground_shader },
+            .frame { uniforms::frame_locations(ground_shader) },
+            .loc_shadow_count { GetShaderLocation(ground_shader, "shadowCount") },
+            .loc_shadow_positions { GetShaderLocation(ground_shader, "shadowPositions") },
+            .loc_shadow_radii { GetShaderLocation(ground_shader, "shadowRadii") },
+            .loc_shadow_itensities { GetShaderLocation(ground_shader, "shadowIntensities") },
+            .loc_morph_center { GetShaderLocation(ground_shader, "morphCenter") },
+            .loc_morph_range { GetShaderLocation(ground_shader, "morphRange") }
+        });
+        world.ecs.get_mut<WorldGround>()->model.materials[0].shader = ground_shader;
     });
 
     // Setup water shader
-    const auto water_shader { LoadShader(ASSET_PATH("shaders/water.vs"), ASSET_PATH("shaders/water.fs")) };
-    world.ecs.set<WaterShader>({
-        .shader{water_shader},
-        .loc_light_dir { GetShaderLocation(water_shader, "lightDir") },
-        .loc_light_color { GetShaderLocation(water_shader, "lightColor") },
-        .loc_view_pos { GetShaderLocation(water_shader, "viewPos") },
-        .loc_time { GetShaderLocation(water_shader, "time") }
+    assets::on_ready(assets::load_shader(ASSET_PATH("shaders/water.vs"), ASSET_PATH("shaders/water.fs")), [&world](const Shader &water_shader) {
+        world.ecs.set<WaterShader>({
+            .shader{water_shader},
+            .frame { uniforms::frame_locations(water_shader) },
+            .loc_time { GetShaderLocation(water_shader, "time") }
+        });
+        world.ecs.get_mut<WorldWater>()->model.materials[0].shader = water_shader;
     });
 
     // Setup model shader
-    const auto model_shader { LoadShader(ASSET_PATH("shaders/model.vs"), ASSET_PATH("shaders/model.fs")) };
-    world.ecs.set<ModelShader>({
-        .shader { model_shader },
-        .loc_light_dir { GetShaderLocation(model_shader, "lightDir") },
-        .loc_light_color { GetShaderLocation(model_shader, "lightColor") },
-        .loc_view_pos { GetShaderLocation(model_shader, "viewPos") },
-        .loc_use_texture { GetShaderLocation(model_shader, "useTexture") },
+    assets::on_ready(assets::load_shader(ASSET_PATH("shaders/model.vs"), ASSET_PATH("shaders/model.fs")), [&world](const Shader &model_shader) {
+        world.ecs.set<ModelShader>({
+            .shader { model_shader },
+            .frame { uniforms::frame_locations(model_shader) },
+            .loc_use_texture { GetShaderLocation(model_shader, "useTexture") },
+        });
     });
 
+    // A saved session is resumed on launch, its terrain has to be in place before the ground is built
+    const auto resume { snapshot::load(SNAPSHOT_PATH) };
+    if (!snapshot::restore_terrain(resume)) {
+        terrain::generate_elevation(util::GetRandomInt(0, 10000));
+    }
+
     terrain::generate_ground(world);
     terrain::generate_water(world);
 
-    // Create character model
-    int bix_anim_count{0};
+    // Create character model once both the mesh and its animations are loaded
+    const auto bix_assets { assets::load_animated_model(ASSET_PATH("models/bix.glb")) };
+    const auto bix_model { bix_assets.model };
+    const auto bix_animations { bix_assets.animations };
 
-    const auto bix_model{LoadModel(ASSET_PATH("models/bix.glb"))};
-    const auto *bix_animations{LoadModelAnimations(ASSET_PATH("models/bix.glb"), &bix_anim_count) };
-    std::map<std::string, ModelAnimation> animationMap;
+    assets::on_ready(bix_model, [&world, bix_model, bix_animations](const Model&) {
+        assets::on_ready(bix_animations, [&world, bix_model, bix_animations](const assets::AnimationSet&) {
+            const auto bix { world.ecs.entity("Bix") };
+            bix.set<WorldModel>({
+                .model { bix_model },
+                .animations { bix_animations },
+                .textured { true }
+            });
 
-    for (int i { 0 }; i < bix_anim_count; i++) {
-        animationMap[bix_animations[i].name] = bix_animations[i];
-    }
+            // A resumed session already restored everything but the model
+            if (bix.has<WorldTransform>()) {
+                return;
+            }
 
-    world.ecs.entity("Bix")
-        .add<CameraFollow>()
-        .set<WorldModel>({
-            .animations { animationMap },
-            .model { bix_model },
-            .textured { true }
-        })
-        .set<Animation>({
-            .name { "Idle" },
-        })
-        .set<WorldTransform>({
-            .pos = { 0.0f,  terrain::get_height(0.0f, 0.0f), 0.0f },
-        })
-        .set<Consumer>({ .range = 0.5f })
-        .set<ShadowCaster>({ .radius = 0.5F })
-        .set<MoveTo>({
-            .speed { 0.05f }
+            bix.add<CameraFollow>()
+                .set<Animation>({
+                    .name { "Idle" },
+                })
+                .set<WorldTransform>({
+                    .pos = { 0.0f,  terrain::get_height(0.0f, 0.0f), 0.0f },
+                })
+                .set<Consumer>({ .range = 0.5f })
+                .set<ShadowCaster>({ .radius = 0.5F })
+                .set<MoveTo>({
+                    .speed { 0.05f }
+                })
+                .set<Agent>({ .radius = 0.4f });
         });
+    });
+
+    const auto seed { static_cast<uint32_t>(util::GetRandomInt(0, INT32_MAX)) };
 
     const auto tree_models = std::vector{
-        LoadModel(ASSET_PATH("models/tree-1.glb")),
-        LoadModel(ASSET_PATH("models/tree-2.glb")),
+        assets::load_model(ASSET_PATH("models/tree-1.glb"), { .mipmaps = true }),
+        assets::load_model(ASSET_PATH("models/tree-2.glb"), { .mipmaps = true }),
     };
 
-    // Configure mipmapping and filtering for all materials in all models
-    for (const auto& tree_model : tree_models) {
-        for (int i = 0; i < tree_model.materialCount; i++) {
-            if (const auto& material = tree_model.materials[i]; material.maps[MATERIAL_MAP_DIFFUSE].texture.id > 0) {
-                auto& texture = material.maps[MATERIAL_MAP_DIFFUSE].texture;
-                GenTextureMipmaps(&texture);
-                SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
-            }
-        }
-    }
-
-    for (int i { 0 }; i < 20; ++i) {
-        const auto size = util::GetRandomFloat(0.9f, 1.3f);
-        auto pos = Vector3 { util::GetRandomFloat(-WORLD_SIZE, WORLD_SIZE), 0.0f, util::GetRandomFloat(-WORLD_SIZE, WORLD_SIZE) };
-        pos.y = terrain::get_height(pos.x, pos.z);
-
-        if (pos.y < 0.5f) {
-            --i;
-            continue;
-        }
-
-        const auto tree_type = util::GetRandomInt(0, static_cast<int>(tree_models.size() - 1));
-        const auto model = tree_models[tree_type];
-        world.ecs.entity()
-            .set<WorldModel>({ .model { model }, .textured = true })
-            .set<ShadowCaster>({ .radius = 1.0f * size })
-            .set<Collider>({ .radius = 0.5f })
-            .set<WorldTransform>({
-                .pos { pos },
-                .rot { 0.0f, util::GetRandomFloat(0.0f, 360.0f), 0.0f },
-                .scale { size }
-            });
-    }
+    // Instances only own what varies between them, the rest is copied from their prefab
+    const auto tree_prefabs = std::vector{
+        world.ecs.prefab("Tree1").set<WorldModel>({ .model { tree_models[0] }, .textured = true }).set<Collider>({ .radius = 0.5f }),
+        world.ecs.prefab("Tree2").set<WorldModel>({ .model { tree_models[1] }, .textured = true }).set<Collider>({ .radius = 0.5f }),
+    };
 
-    const auto banana_model { LoadModel(ASSET_PATH("models/banana.glb")) };
-    const auto banana_colors = std::vector<Color>{
+    const auto banana_model { assets::load_model(ASSET_PATH("models/banana.glb")) };
+    const auto banana_colors = assets::add_palette({
         {255, 255, 0, 255},    // Electric banana yellow
         {255, 165, 0, 255},    // Blazing orange-gold
         {255, 240, 0, 255},    // Neon creamy yellow
         {200, 140, 0, 255},    // Intense golden brown
         {50, 205, 50, 255},    // Vivid lime green
         {139, 69, 19, 255},    // Rich saddle brown
-    };
+    });
 
-    const auto apple_model { LoadModel(ASSET_PATH("models/apple.glb")) };
-    const auto apple_colors = std::vector<Color>{
+    const auto apple_model { assets::load_model(ASSET_PATH("models/apple.glb")) };
+    const auto apple_colors = assets::add_palette({
         {255, 0, 0, 255},      // Pure crimson red
         {255, 69, 0, 255},     // Orange-red flame
         {178, 34, 34, 255},    // Fire brick red
         {255, 140, 0, 255},    // Dark orange burst
         {255, 215, 0, 255},    // Gold highlight
         {160, 82, 45, 255}     // Saddle brown stem
-    };
+    });
 
-    const auto cheese_model { LoadModel(ASSET_PATH("models/cheese.glb")) };
-    const auto cheese_colors = std::vector<Color>{
+    const auto cheese_model { assets::load_model(ASSET_PATH("models/cheese.glb")) };
+    const auto cheese_colors = assets::add_palette({
         {255, 215, 0, 255},    // Pure gold
         {255, 255, 0, 255},    // Electric yellow
         {255, 140, 0, 255},    // Dark orange
         {218, 165, 32, 255},   // Goldenrod
         {184, 134, 11, 255},   // Dark goldenrod
         {139, 69, 19, 255},    // Saddle brown depths
-    };
+    });
 
-    const auto egg_model { LoadModel(ASSET_PATH("models/egg.glb")) };
-    const auto egg_colors = std::vector<Color>{
+    const auto egg_model { assets::load_model(ASSET_PATH("models/egg.glb")) };
+    const auto egg_colors = assets::add_palette({
         {139, 69, 19, 255},    // Rich saddle brown shell
         {160, 82, 45, 255},    // Saddle brown shadows
         {210, 180, 140, 255},  // Warm tan shell
         {255, 255, 0, 255},    // Electric yolk yellow
         {255, 215, 0, 255},    // Gold yolk highlights
         {101, 67, 33, 255},    // Dark olive brown cracks
-    };
+    });
 
-    const auto ice_cream_model { LoadModel(ASSET_PATH("models/ice-cream.glb")) };
-    const auto ice_cream_colors = std::vector<Color>{
+    const auto ice_cream_model { assets::load_model(ASSET_PATH("models/ice-cream.glb")) };
+    const auto ice_cream_colors = assets::add_palette({
         {138, 43, 226, 255},   // Purple (top scoop)
         {220, 20, 60, 255},    // Crimson red (middle scoop)
         {255, 140, 0, 255},    // Dark orange (cone)
         {160, 82, 45, 255},    // Saddle brown (cone shadow)
         {75, 0, 130, 255},     // Indigo (purple variation)
         {178, 34, 34, 255},    // Fire brick red (red variation)
+    });
+
+    const auto consumable_prefab { [&world](const char *name, const assets::Handle<Model> model, const assets::Handle<assets::Palette> palette) {
+        return world.ecs.prefab(name)
+            .set<WorldModel>({ .model { model } })
+            .set<Spin>({ .speed { 1.0f } })
+            .set<ShadowCaster>({ .radius = 0.1f })
+            .set<Consumable>({
+                .palette = palette,
+                .particles = 25,
+            });
+    }};
+
+    const auto consumable_prefabs = std::vector{
+        consumable_prefab("Banana", banana_model, banana_colors),
+        consumable_prefab("Apple", apple_model, apple_colors),
+        consumable_prefab("Cheese", cheese_model, cheese_colors),
+        consumable_prefab("Egg", egg_model, egg_colors),
+        consumable_prefab("IceCream", ice_cream_model, ice_cream_colors),
     };
 
-    // Arrays for easy indexing
-    const auto models = std::vector{ banana_model, apple_model, cheese_model, egg_model, ice_cream_model };
-    const auto color_sets = std::vector{ banana_colors, apple_colors, cheese_colors, egg_colors, ice_cream_colors};
+    // Prefabs have to exist before a saved session's instances are restored
+    if (!snapshot::restore_entities(world.ecs, resume)) {
+        std::vector<std::vector<WorldTransform>> tree_transforms(tree_prefabs.size());
+        std::vector<std::vector<ShadowCaster>> tree_shadows(tree_prefabs.size());
 
-    for (int i { 0 }; i < 100; ++i) {
-        const auto consumable_type = util::GetRandomInt(0, static_cast<int>(models.size()) - 1);
-        const auto pos = Vector3 { util::GetRandomFloat(-WORLD_SIZE, WORLD_SIZE), 0.0f, util::GetRandomFloat(-WORLD_SIZE, WORLD_SIZE) };
+        for (const auto &pos : spawner::poisson_disk({ .min_distance = 3.0f, .min_height = 0.5f, .max_slope = 35.0f }, seed, 20)) {
+            const auto size = util::GetRandomFloat(0.9f, 1.3f);
+            const auto tree_type = util::GetRandomInt(0, static_cast<int>(tree_prefabs.size() - 1));
+            tree_transforms[tree_type].push_back({
+                .pos { pos },
+                .rot { transforms::from_yaw(util::GetRandomFloat(0.0f, 360.0f)) },
+                .scale { size }
+            });
+            tree_shadows[tree_type].push_back({ .radius = 1.0f * size });
+        }
 
-        if (terrain::get_height(pos.x, pos.z) < 0.1f) {
-            --i;
-            continue;
+        for (size_t tree_type { 0 }; tree_type < tree_prefabs.size(); ++tree_type) {
+            spawner::BulkSpawn(world.ecs, tree_prefabs[tree_type], tree_transforms[tree_type])
+                .with(tree_shadows[tree_type])
+                .with<Static>()
+                .with<Streamed>()
+                .spawn();
         }
 
-        world.ecs.entity()
-            .set<WorldModel>({ .model { models[consumable_type] } })
-            .set<Spin>({ .speed { 1.0f } })
-            .set<Bounce>({
+        std::vector<std::vector<WorldTransform>> consumable_transforms(consumable_prefabs.size());
+        std::vector<std::vector<Bounce>> consumable_bounces(consumable_prefabs.size());
+
+        for (const auto &pos : spawner::poisson_disk({ .min_distance = 1.0f, .min_height = 0.1f }, seed + 1, 100)) {
+            const auto consumable_type = util::GetRandomInt(0, static_cast<int>(consumable_prefabs.size()) - 1);
+            consumable_transforms[consumable_type].push_back({
+                .pos { pos },
+                .rot { transforms::from_yaw(util::GetRandomFloat(0.0f, 360.0f)) }
+            });
+            consumable_bounces[consumable_type].push_back({
                 .speed { 0.05f },
                 .height { 0.25f },
                 .elapsed { util::GetRandomFloat(-1.0f, 1.0f) },
                 .center_y { 1.0f },
-            })
-            .set<ShadowCaster>({ .radius = 0.1f })
-            .set<WorldTransform>({
-                .pos { pos },
-                .rot { 0.0f, util::GetRandomFloat(0.0f, 360.0f), 0.0f }
-            })
-            .set<Consumable>({
-                .colors = color_sets[consumable_type],
-                .particles = 25,
             });
+        }
+
+        for (size_t consumable_type { 0 }; consumable_type < consumable_prefabs.size(); ++consumable_type) {
+            spawner::BulkSpawn(world.ecs, consumable_prefabs[consumable_type], consumable_transforms[consumable_type])
+                .with(consumable_bounces[consumable_type])
+                .with<Streamed>()
+                .spawn();
+        }
     }
 
+#ifdef SIM_THREAD
+    world.start_simulation_thread();
+#endif
+
+    auto show_stats { false };
+    auto flatten_height { 0.0f };
     while (!WindowShouldClose()) {
+        // Ready callbacks set singletons and spawn entities, so they have to run between ticks
+        if (assets::pending() > 0) {
+            world.exclusive([] { assets::process_uploads(); });
+        }
+
+        const auto frame_start { std::chrono::steady_clock::now() };
         BeginDrawing();
-        ClearBackground({ 0, 128, 179, 1 });
+        ClearBackground(SKY_COLOR);
 
         if (IsKeyPressed(KEY_F)) {
             ToggleFullscreen();
         }
 
+        if (IsKeyPressed(KEY_F3)) {
+            show_stats = !show_stats;
+        }
+
+        // Switches between the path solvers, paths already walked keep going
+        if (IsKeyPressed(KEY_F6)) {
+            world.exclusive([] {
+                const auto jump_point { terrain::get_path_solver() != terrain::PathSolver::JumpPoint };
+                terrain::set_path_solver(jump_point ? terrain::PathSolver::JumpPoint : terrain::PathSolver::MicroPather);
+                TraceLog(LOG_INFO, "PATH: solving with %s", jump_point ? "jps+" : "micropather");
+            });
+        }
+
+        if (IsKeyPressed(KEY_F5)) {
+            world.exclusive([&world] {
+                streaming_systems::wake_all(world.ecs);
+                snapshot::save(world.ecs, SNAPSHOT_PATH);
+            });
+        }
+
+        // Dragging with the right button raises the ground, with shift it lowers and with control
+        // it flattens to the height where the drag started
+        if (IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) {
+            const auto started { IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) };
+            const terrain::Brush brush {
+                .mode = IsKeyDown(KEY_LEFT_SHIFT) ? terrain::BrushMode::Lower
+                    : IsKeyDown(KEY_LEFT_CONTROL) ? terrain::BrushMode::Flatten : terrain::BrushMode::Raise,
+                .strength = BRUSH_RATE * GetFrameTime(),
+            };
+
+            world.exclusive([&world, &flatten_height, started, brush] {
+                const auto *cam { world.ecs.get<WorldCamera>() };
+                if (cam == nullptr) {
+                    return;
+                }
+
+                const auto ray { GetMouseRay(GetMousePosition(), cam->camera) };
+                if (const auto hit { terrain::ray_ground_intersect(ray.position, ray.direction) }) {
+                    flatten_height = started ? hit->y : flatten_height;
+                    auto applied { brush };
+                    applied.height = flatten_height;
+                    terrain::deform(world, *hit, applied);
+                }
+            });
+        }
+
+        quality::begin_scene(SKY_COLOR);
         world.update();
+        quality::end_scene();
+
+        if (show_stats) {
+            draw_stats();
+        }
+
+        // Time spent before presenting, the frame time also includes waiting on vsync
+        quality::record_frame(GetFrameTime(), std::chrono::duration<float>(std::chrono::steady_clock::now() - frame_start).count());
         EndDrawing();
     }
 
-    UnloadModel(bix_model);
-    UnloadModel(banana_model);
-    UnloadModel(apple_model);
-    UnloadShader(model_shader);
-    UnloadShader(ground_shader);
+    world.stop_simulation_thread();
+    assets::shutdown();
+    assets::pack::unmount();
     CloseWindow();
 }
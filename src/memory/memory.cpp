@@ -0,0 +1,175 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace memory {
+    namespace {
+        constexpr size_t FRAME_ARENA_SIZE { 256 * 1024 };
+        constexpr size_t TICK_ARENA_SIZE { 256 * 1024 };
+
+        // Ticks run on the simulation thread in threaded mode, so the running totals are shared
+        std::atomic<size_t> arena_allocations { 0 };
+        std::atomic<size_t> arena_bytes { 0 };
+        std::atomic<size_t> pool_allocations { 0 };
+        std::atomic<size_t> allocator_blocks { 0 };
+        std::atomic<size_t> heap_allocations { 0 };
+
+        std::mutex last_mutex;
+        Counters last {};
+
+        auto size_class(const size_t bytes) -> size_t {
+            auto shift { Pool::MIN_SHIFT };
+            while ((size_t { 1 } << shift) < bytes) {
+                ++shift;
+            }
+            return shift;
+        }
+    }
+
+    Arena::Arena(const size_t block_size) : block_size(block_size) {}
+
+    auto Arena::allocate(const size_t bytes, const size_t alignment) -> void* {
+        while (current < blocks.size()) {
+            auto &block { blocks[current] };
+            const auto base { reinterpret_cast<uintptr_t>(block.data.get()) };
+            const auto aligned { (base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1) };
+
+            if (aligned + bytes <= base + block.size) {
+                offset = aligned + bytes - base;
+                arena_allocations.fetch_add(1, std::memory_order_relaxed);
+                arena_bytes.fetch_add(bytes, std::memory_order_relaxed);
+                return reinterpret_cast<void*>(aligned);
+            }
+
+            ++current;
+            offset = 0;
+        }
+
+        const auto size { std::max(block_size, bytes + alignment) };
+        blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+        allocator_blocks.fetch_add(1, std::memory_order_relaxed);
+        return allocate(bytes, alignment);
+    }
+
+    void Arena::reset() {
+        // A frame that spilled into more blocks gets a single block that fits all of it next time
+        if (blocks.size() > 1) {
+            size_t total { 0 };
+            for (const auto &block : blocks) {
+                total += block.size;
+            }
+
+            blocks.clear();
+            blocks.push_back({ std::make_unique<std::byte[]>(total), total });
+            block_size = std::max(block_size, total);
+            allocator_blocks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        current = 0;
+        offset = 0;
+    }
+
+    Pool::~Pool() {
+        for (auto shift { MIN_SHIFT }; shift <= MAX_SHIFT; ++shift) {
+            while (auto *block { free[shift - MIN_SHIFT] }) {
+                free[shift - MIN_SHIFT] = block->next;
+                ::operator delete(block);
+            }
+        }
+    }
+
+    auto Pool::allocate(const size_t bytes) -> void* {
+        const auto shift { size_class(bytes) };
+        if (shift > MAX_SHIFT) {
+            allocator_blocks.fetch_add(1, std::memory_order_relaxed);
+            return ::operator new(bytes);
+        }
+
+        {
+            std::lock_guard lock { mutex };
+            if (auto *block { free[shift - MIN_SHIFT] }) {
+                free[shift - MIN_SHIFT] = block->next;
+                pool_allocations.fetch_add(1, std::memory_order_relaxed);
+                return block;
+            }
+        }
+
+        allocator_blocks.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size_t { 1 } << shift);
+    }
+
+    void Pool::deallocate(void *block, const size_t bytes) {
+        const auto shift { size_class(bytes) };
+        if (shift > MAX_SHIFT) {
+            ::operator delete(block);
+            return;
+        }
+
+        std::lock_guard lock { mutex };
+        auto *free_block { static_cast<FreeBlock*>(block) };
+        free_block->next = free[shift - MIN_SHIFT];
+        free[shift - MIN_SHIFT] = free_block;
+    }
+
+    auto frame_arena() -> Arena& {
+        static Arena arena { FRAME_ARENA_SIZE };
+        return arena;
+    }
+
+    auto tick_arena() -> Arena& {
+        static Arena arena { TICK_ARENA_SIZE };
+        return arena;
+    }
+
+    auto path_pool() -> Pool& {
+        static Pool pool;
+        return pool;
+    }
+
+    void begin_frame() {
+        frame_arena().reset();
+
+        const Counters frame {
+            .arena_allocations = arena_allocations.exchange(0),
+            .arena_bytes = arena_bytes.exchange(0),
+            .pool_allocations = pool_allocations.exchange(0),
+            .allocator_blocks = allocator_blocks.exchange(0),
+            .heap_allocations = heap_allocations.exchange(0),
+        };
+
+        std::lock_guard lock { last_mutex };
+        last = frame;
+    }
+
+    void begin_tick() {
+        tick_arena().reset();
+    }
+
+    auto frame_counters() -> Counters {
+        std::lock_guard lock { last_mutex };
+        return last;
+    }
+}
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+// Array and nothrow forms end up here, aligned allocations are left uncounted
+void* operator new(const size_t bytes) {
+    memory::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *block { std::malloc(bytes > 0 ? bytes : 1) }) {
+        return block;
+    }
+    throw std::bad_alloc {};
+}
+
+void operator delete(void *block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    std::free(block);
+}
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace memory {
+    struct Counters {
+        size_t arena_allocations {}; // Served from an arena without touching the heap
+        size_t arena_bytes {};
+        size_t pool_allocations {};  // Served from a pool free list
+        size_t allocator_blocks {};  // New arena blocks and pool blocks taken from the heap
+        size_t heap_allocations {};  // Every global operator new, zero unless COUNTS_HEAP
+    };
+
+    // Global operator new and delete are replaced to count heap traffic, see CMakeLists.txt
+#ifdef COUNT_HEAP_ALLOCATIONS
+    constexpr bool COUNTS_HEAP { true };
+#else
+    constexpr bool COUNTS_HEAP { false };
+#endif
+
+    // Bump allocator for buffers that live for one frame or tick. Blocks are kept across resets
+    // and merged into one, so once the high-water mark is reached nothing touches the heap.
+    class Arena {
+        public:
+            explicit Arena(size_t block_size);
+
+            auto allocate(size_t bytes, size_t alignment) -> void*;
+            void reset();
+
+        private:
+            struct Block {
+                std::unique_ptr<std::byte[]> data;
+                size_t size;
+            };
+
+            size_t block_size;
+            std::vector<Block> blocks;
+            size_t current { 0 };
+            size_t offset { 0 };
+    };
+
+    // Size classed free lists for long lived buffers that are replaced often, like paths
+    class Pool {
+        public:
+            static constexpr size_t MIN_SHIFT { 6 };
+            static constexpr size_t MAX_SHIFT { 16 };
+
+            ~Pool();
+
+            auto allocate(size_t bytes) -> void*;
+            void deallocate(void *block, size_t bytes);
+
+        private:
+            struct FreeBlock {
+                FreeBlock *next;
+            };
+
+            std::mutex mutex;
+            FreeBlock *free[MAX_SHIFT - MIN_SHIFT + 1] {};
+    };
+
+    // Render side buffers, reset by begin_frame
+    auto frame_arena() -> Arena&;
+
+    // Simulation side buffers, reset by begin_tick
+    auto tick_arena() -> Arena&;
+
+    auto path_pool() -> Pool&;
+
+    void begin_frame();
+    void begin_tick();
+
+    // Totals of the last complete frame, ticks count towards the frame they ran in
+    auto frame_counters() -> Counters;
+
+    template <typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+
+        Arena *arena;
+
+        ArenaAllocator(Arena &arena) : arena(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+        auto allocate(const size_t count) -> T* {
+            return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // Memory goes back with the next reset
+        void deallocate(T*, size_t) {}
+
+        template <typename U>
+        auto operator==(const ArenaAllocator<U> &other) const -> bool { return arena == other.arena; }
+
+        template <typename U>
+        auto operator!=(const ArenaAllocator<U> &other) const -> bool { return arena != other.arena; }
+    };
+
+    template <typename T>
+    struct PoolAllocator {
+        using value_type = T;
+
+        PoolAllocator() = default;
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U>&) {}
+
+        auto allocate(const size_t count) -> T* {
+            return static_cast<T*>(path_pool().allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T *block, const size_t count) {
+            path_pool().deallocate(block, count * sizeof(T));
+        }
+
+        template <typename U>
+        auto operator==(const PoolAllocator<U>&) const -> bool { return true; }
+
+        template <typename U>
+        auto operator!=(const PoolAllocator<U>&) const -> bool { return false; }
+    };
+
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    template <typename T>
+    using PoolVector = std::vector<T, PoolAllocator<T>>;
+}
@@ -0,0 +1,416 @@
+#include "avoidance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <raymath.h>
+
+namespace avoidance {
+    namespace {
+        constexpr float EPSILON { 1e-5f };
+        constexpr int MAX_NEIGHBORS { 16 };
+        constexpr int MAX_GRID_SIZE { 1024 };
+
+        // Below this many agents the threads cost more than they save
+        constexpr size_t PARALLEL_MIN { 1024 };
+        constexpr size_t CHUNK { 256 };
+
+        // Permitted velocities lie on the left of the directed line
+        struct Line {
+            Vector2 point;
+            Vector2 direction;
+        };
+
+        struct Neighbor {
+            float distance_sq;
+            uint32_t index;
+        };
+
+        auto det(const Vector2 a, const Vector2 b) -> float {
+            return a.x * b.y - a.y * b.x;
+        }
+
+        auto length_sq(const Vector2 v) -> float {
+            return v.x * v.x + v.y * v.y;
+        }
+
+        // Optimum on line n within the speed circle that satisfies lines 0..n-1
+        auto linear_program1(const Line *lines, const int n, const float radius, const Vector2 optimum, const bool direction_opt, Vector2 &result) -> bool {
+            const auto &line { lines[n] };
+            const auto dot { Vector2DotProduct(line.point, line.direction) };
+            const auto discriminant { dot * dot + radius * radius - length_sq(line.point) };
+
+            if (discriminant < 0.0f) {
+                return false;
+            }
+
+            const auto root { std::sqrt(discriminant) };
+            auto t_left { -dot - root };
+            auto t_right { -dot + root };
+
+            for (int i { 0 }; i < n; ++i) {
+                const auto denominator { det(line.direction, lines[i].direction) };
+                const auto numerator { det(lines[i].direction, Vector2Subtract(line.point, lines[i].point)) };
+
+                // Parallel lines, either everything or nothing on this one is permitted
+                if (std::fabs(denominator) <= EPSILON) {
+                    if (numerator < 0.0f) {
+                        return false;
+                    }
+                    continue;
+                }
+
+                const auto t { numerator / denominator };
+                if (denominator >= 0.0f) {
+                    t_right = std::min(t_right, t);
+                } else {
+                    t_left = std::max(t_left, t);
+                }
+
+                if (t_left > t_right) {
+                    return false;
+                }
+            }
+
+            auto t { Vector2DotProduct(line.direction, Vector2Subtract(optimum, line.point)) };
+            if (direction_opt) {
+                t = t > 0.0f ? t_right : t_left;
+            } else {
+                t = std::clamp(t, t_left, t_right);
+            }
+
+            result = Vector2Add(line.point, Vector2Scale(line.direction, t));
+            return true;
+        }
+
+        // Closest velocity to optimum satisfying all lines, returns the first line it failed on
+        auto linear_program2(const Line *lines, const int count, const float radius, const Vector2 optimum, const bool direction_opt, Vector2 &result) -> int {
+            if (direction_opt) {
+                result = Vector2Scale(optimum, radius);
+            } else if (length_sq(optimum) > radius * radius) {
+                result = Vector2Scale(Vector2Normalize(optimum), radius);
+            } else {
+                result = optimum;
+            }
+
+            for (int i { 0 }; i < count; ++i) {
+                if (det(lines[i].direction, Vector2Subtract(lines[i].point, result)) > 0.0f) {
+                    const auto previous { result };
+                    if (!linear_program1(lines, i, radius, optimum, direction_opt, result)) {
+                        result = previous;
+                        return i;
+                    }
+                }
+            }
+
+            return count;
+        }
+
+        // Infeasible crowding, picks the velocity that violates the remaining lines the least
+        void linear_program3(const Line *lines, const int count, const int begin, const float radius, Vector2 &result) {
+            Line projected[MAX_NEIGHBORS];
+            auto distance { 0.0f };
+
+            for (auto i { begin }; i < count; ++i) {
+                if (det(lines[i].direction, Vector2Subtract(lines[i].point, result)) <= distance) {
+                    continue;
+                }
+
+                auto projected_count { 0 };
+                for (int j { 0 }; j < i; ++j) {
+                    Line line {};
+                    const auto determinant { det(lines[i].direction, lines[j].direction) };
+
+                    if (std::fabs(determinant) <= EPSILON) {
+                        if (Vector2DotProduct(lines[i].direction, lines[j].direction) > 0.0f) {
+                            continue;
+                        }
+                        line.point = Vector2Scale(Vector2Add(lines[i].point, lines[j].point), 0.5f);
+                    } else {
+                        const auto t { det(lines[j].direction, Vector2Subtract(lines[i].point, lines[j].point)) / determinant };
+                        line.point = Vector2Add(lines[i].point, Vector2Scale(lines[i].direction, t));
+                    }
+
+                    line.direction = Vector2Normalize(Vector2Subtract(lines[j].direction, lines[i].direction));
+                    projected[projected_count++] = line;
+                }
+
+                const auto previous { result };
+                const Vector2 inward { -lines[i].direction.y, lines[i].direction.x };
+                if (linear_program2(projected, projected_count, radius, inward, true, result) < projected_count) {
+                    result = previous;
+                }
+
+                distance = det(lines[i].direction, Vector2Subtract(lines[i].point, result));
+            }
+        }
+
+        // Half plane of velocities that avoid a collision with other within the time horizon,
+        // assuming other takes the same share of the effort
+        auto orca_line(const Agents &agents, const size_t self, const size_t other, const float inv_horizon) -> Line {
+            const auto relative_pos { Vector2Subtract(agents.positions[other], agents.positions[self]) };
+            const auto relative_vel { Vector2Subtract(agents.velocities[self], agents.velocities[other]) };
+            const auto distance_sq { length_sq(relative_pos) };
+            const auto combined_radius { agents.radii[self] + agents.radii[other] };
+            const auto combined_radius_sq { combined_radius * combined_radius };
+
+            Line line {};
+            Vector2 u {};
+
+            if (distance_sq > combined_radius_sq) {
+                const auto w { Vector2Subtract(relative_vel, Vector2Scale(relative_pos, inv_horizon)) };
+                const auto w_length_sq { length_sq(w) };
+                const auto dot { Vector2DotProduct(w, relative_pos) };
+
+                if (dot < 0.0f && dot * dot > combined_radius_sq * w_length_sq) {
+                    // Closest to the cut-off circle
+                    const auto w_length { std::sqrt(w_length_sq) };
+                    const auto unit_w { Vector2Scale(w, 1.0f / w_length) };
+                    line.direction = { unit_w.y, -unit_w.x };
+                    u = Vector2Scale(unit_w, combined_radius * inv_horizon - w_length);
+                } else {
+                    // Closest to one of the legs of the cone
+                    const auto leg { std::sqrt(distance_sq - combined_radius_sq) };
+                    if (det(relative_pos, w) > 0.0f) {
+                        line.direction = Vector2Scale({
+                            relative_pos.x * leg - relative_pos.y * combined_radius,
+                            relative_pos.x * combined_radius + relative_pos.y * leg,
+                        }, 1.0f / distance_sq);
+                    } else {
+                        line.direction = Vector2Scale({
+                            relative_pos.x * leg + relative_pos.y * combined_radius,
+                            -relative_pos.x * combined_radius + relative_pos.y * leg,
+                        }, -1.0f / distance_sq);
+                    }
+
+                    const auto projection { Vector2DotProduct(relative_vel, line.direction) };
+                    u = Vector2Subtract(Vector2Scale(line.direction, projection), relative_vel);
+                }
+            } else {
+                // Already overlapping, push apart within a single tick
+                const auto w { Vector2Subtract(relative_vel, relative_pos) };
+                const auto w_length { std::sqrt(length_sq(w)) };
+                const auto unit_w { w_length > EPSILON ? Vector2Scale(w, 1.0f / w_length) : Vector2 { 1.0f, 0.0f } };
+                line.direction = { unit_w.y, -unit_w.x };
+                u = Vector2Scale(unit_w, combined_radius - w_length);
+            }
+
+            line.point = Vector2Add(agents.velocities[self], Vector2Scale(u, 0.5f));
+            return line;
+        }
+
+        // Closest agents within range, kept sorted by distance
+        auto gather_neighbors(const Agents &agents, const Grid &grid, const size_t self, const Params &params, Neighbor *neighbors) -> int {
+            const auto position { agents.positions[self] };
+            const auto max_neighbors { std::clamp(params.max_neighbors, 0, MAX_NEIGHBORS) };
+            auto range_sq { params.neighbor_distance * params.neighbor_distance };
+            auto count { 0 };
+
+            grid.query(position, params.neighbor_distance, [&](const uint32_t other) {
+                if (other == self) {
+                    return;
+                }
+
+                const auto distance_sq { length_sq(Vector2Subtract(agents.positions[other], position)) };
+                if (distance_sq >= range_sq) {
+                    return;
+                }
+
+                if (count < max_neighbors) {
+                    ++count;
+                }
+
+                auto i { count - 1 };
+                while (i > 0 && neighbors[i - 1].distance_sq > distance_sq) {
+                    neighbors[i] = neighbors[i - 1];
+                    --i;
+                }
+                neighbors[i] = { distance_sq, other };
+
+                // Once full, only closer agents can still get in
+                if (count == max_neighbors) {
+                    range_sq = neighbors[count - 1].distance_sq;
+                }
+            });
+
+            return count;
+        }
+
+        auto solve_agent(const Agents &agents, const Grid &grid, const size_t self, const Params &params, size_t &checked) -> Vector2 {
+            Neighbor neighbors[MAX_NEIGHBORS];
+            Line lines[MAX_NEIGHBORS];
+
+            const auto count { gather_neighbors(agents, grid, self, params, neighbors) };
+            const auto inv_horizon { 1.0f / params.time_horizon };
+            for (int i { 0 }; i < count; ++i) {
+                lines[i] = orca_line(agents, self, neighbors[i].index, inv_horizon);
+            }
+            checked += count;
+
+            Vector2 result {};
+            const auto max_speed { agents.max_speeds[self] };
+            const auto failed { linear_program2(lines, count, max_speed, agents.preferred[self], false, result) };
+            if (failed < count) {
+                linear_program3(lines, count, failed, max_speed, result);
+            }
+
+            return result;
+        }
+    }
+
+    void Agents::clear() {
+        positions.clear();
+        velocities.clear();
+        preferred.clear();
+        radii.clear();
+        max_speeds.clear();
+    }
+
+    void Agents::push(const Vector2 position, const Vector2 velocity, const Vector2 preferred_velocity, const float radius, const float max_speed) {
+        positions.push_back(position);
+        velocities.push_back(velocity);
+        preferred.push_back(preferred_velocity);
+        radii.push_back(radius);
+        max_speeds.push_back(max_speed);
+    }
+
+    void Grid::build(const std::vector<Vector2> &positions, const float cell_size) {
+        Vector2 min { 0.0f, 0.0f };
+        Vector2 max { 0.0f, 0.0f };
+        if (!positions.empty()) {
+            min = max = positions.front();
+            for (const auto &p : positions) {
+                min = { std::min(min.x, p.x), std::min(min.y, p.y) };
+                max = { std::max(max.x, p.x), std::max(max.y, p.y) };
+            }
+        }
+
+        // Agents spread far apart get coarser cells rather than a huge, mostly empty grid
+        const auto extent { std::max(max.x - min.x, max.y - min.y) };
+        const auto size { std::max(cell_size, extent / static_cast<float>(MAX_GRID_SIZE - 1)) };
+
+        origin = min;
+        inv_cell_size = 1.0f / size;
+        width = static_cast<int>((max.x - min.x) * inv_cell_size) + 1;
+        height = static_cast<int>((max.y - min.y) * inv_cell_size) + 1;
+
+        // Counting sort of the agents by cell, starts[cell]..starts[cell + 1] index into indices
+        starts.assign(static_cast<size_t>(width) * height + 1, 0);
+        for (const auto &p : positions) {
+            ++starts[static_cast<size_t>(cell_z(p.y) * width + cell_x(p.x)) + 1];
+        }
+        for (size_t i { 1 }; i < starts.size(); ++i) {
+            starts[i] += starts[i - 1];
+        }
+
+        indices.resize(positions.size());
+        fill.assign(starts.begin(), starts.end() - 1);
+        for (size_t i { 0 }; i < positions.size(); ++i) {
+            const auto cell { static_cast<size_t>(cell_z(positions[i].y) * width + cell_x(positions[i].x)) };
+            indices[fill[cell]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    auto Grid::cell_x(const float x) const -> int {
+        return std::clamp(static_cast<int>((x - origin.x) * inv_cell_size), 0, width - 1);
+    }
+
+    auto Grid::cell_z(const float z) const -> int {
+        return std::clamp(static_cast<int>((z - origin.y) * inv_cell_size), 0, height - 1);
+    }
+
+    Solver::~Solver() {
+        {
+            std::lock_guard lock { mutex };
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void Solver::solve_chunks() {
+        const auto count { current_agents->size() };
+        size_t local { 0 };
+
+        for (auto chunk { next_chunk++ }; chunk < chunks; chunk = next_chunk++) {
+            const auto end { std::min(count, (chunk + 1) * CHUNK) };
+            for (auto i { chunk * CHUNK }; i < end; ++i) {
+                (*current_velocities)[i] = solve_agent(*current_agents, grid, i, *current_params, local);
+            }
+        }
+
+        total += local;
+    }
+
+    // Every worker takes part in every round, the solving thread waits for all of them
+    void Solver::worker_loop() {
+        uint64_t seen { 0 };
+
+        while (true) {
+            {
+                std::unique_lock lock { mutex };
+                wake.wait(lock, [&] { return stopping || round != seen; });
+
+                if (stopping) {
+                    return;
+                }
+                seen = round;
+            }
+
+            solve_chunks();
+
+            {
+                std::lock_guard lock { mutex };
+                --busy;
+            }
+            done.notify_one();
+        }
+    }
+
+    void Solver::solve(const Agents &agents, const Params &params, std::vector<Vector2> &velocities) {
+        const auto count { agents.size() };
+        velocities.resize(count);
+        grid.build(agents.positions, params.neighbor_distance);
+
+        if (count < PARALLEL_MIN) {
+            checked = 0;
+            for (size_t i { 0 }; i < count; ++i) {
+                velocities[i] = solve_agent(agents, grid, i, params, checked);
+            }
+            return;
+        }
+
+        // The solving thread works too, so one worker less than there are cores
+        if (workers.empty()) {
+            const auto worker_count { std::max(1u, std::thread::hardware_concurrency()) - 1 };
+            for (unsigned int i { 0 }; i < worker_count; ++i) {
+                workers.emplace_back([this] { worker_loop(); });
+            }
+        }
+
+        current_agents = &agents;
+        current_params = &params;
+        current_velocities = &velocities;
+        chunks = (count + CHUNK - 1) / CHUNK;
+        next_chunk = 0;
+        total = 0;
+
+        {
+            std::lock_guard lock { mutex };
+            busy = workers.size();
+            ++round;
+        }
+        wake.notify_all();
+
+        solve_chunks();
+
+        {
+            std::unique_lock lock { mutex };
+            done.wait(lock, [&] { return busy == 0; });
+        }
+
+        checked = total;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <raylib.h>
+#include <thread>
+#include <vector>
+
+namespace avoidance {
+    // Velocities are in world units per fixed tick, the time horizon in ticks
+    struct Params {
+        float neighbor_distance { 3.0f };
+        float time_horizon { 30.0f };
+        int max_neighbors { 10 };
+    };
+
+    // Agents of one tick on the ground plane (x, z), velocity is the one picked last tick
+    struct Agents {
+        std::vector<Vector2> positions {};
+        std::vector<Vector2> velocities {};
+        std::vector<Vector2> preferred {};
+        std::vector<float> radii {};
+        std::vector<float> max_speeds {};
+
+        void clear();
+        void push(Vector2 position, Vector2 velocity, Vector2 preferred_velocity, float radius, float max_speed);
+        auto size() const -> size_t { return positions.size(); }
+    };
+
+    // Uniform grid over the bounding box of the agents, rebuilt every tick with a counting sort
+    class Grid {
+        public:
+            void build(const std::vector<Vector2> &positions, float cell_size);
+
+            // Calls fn with the index of every agent in the cells overlapping the square around center
+            template <typename Fn>
+            void query(const Vector2 center, const float range, Fn &&fn) const {
+                const auto x0 { cell_x(center.x - range) };
+                const auto x1 { cell_x(center.x + range) };
+                const auto z0 { cell_z(center.y - range) };
+                const auto z1 { cell_z(center.y + range) };
+
+                for (auto z { z0 }; z <= z1; ++z) {
+                    for (auto x { x0 }; x <= x1; ++x) {
+                        const auto cell { static_cast<size_t>(z * width + x) };
+                        for (auto i { starts[cell] }; i < starts[cell + 1]; ++i) {
+                            fn(indices[i]);
+                        }
+                    }
+                }
+            }
+
+        private:
+            auto cell_x(float x) const -> int;
+            auto cell_z(float z) const -> int;
+
+            Vector2 origin {};
+            float inv_cell_size { 1.0f };
+            int width { 0 };
+            int height { 0 };
+            std::vector<uint32_t> starts {};
+            std::vector<uint32_t> indices {};
+            std::vector<uint32_t> fill {};
+    };
+
+    // Optimal reciprocal collision avoidance, every agent takes half the responsibility for
+    // avoiding each neighbour. Agents only read the tick's snapshot and write their own
+    // velocity, so large crowds are split over worker threads. The workers are started by the
+    // first large solve and sleep between ticks until the solver is destroyed.
+    class Solver {
+        public:
+            Solver() = default;
+            Solver(const Solver&) = delete;
+            auto operator=(const Solver&) -> Solver& = delete;
+            ~Solver();
+
+            void solve(const Agents &agents, const Params &params, std::vector<Vector2> &velocities);
+
+            auto neighbors_checked() const -> size_t { return checked; }
+
+        private:
+            void worker_loop();
+            void solve_chunks();
+
+            Grid grid;
+            size_t checked { 0 };
+
+            std::vector<std::thread> workers {};
+            std::mutex mutex {};
+            std::condition_variable wake {};
+            std::condition_variable done {};
+            uint64_t round { 0 };
+            size_t busy { 0 };
+            bool stopping { false };
+
+            // The solve in progress, set before a round starts
+            const Agents *current_agents { nullptr };
+            const Params *current_params { nullptr };
+            std::vector<Vector2> *current_velocities { nullptr };
+            size_t chunks { 0 };
+            std::atomic<size_t> next_chunk { 0 };
+            std::atomic<size_t> total { 0 };
+    };
+}
@@ -1,13 +1,27 @@
 #pragma once
 #include <raylib.h>
 #include <vector>
+#include "assets/assets.h"
+#include "memory/memory.h"
 
 struct MoveTo {
-    std::vector<Vector3> path {};
+    memory::PoolVector<Vector3> path {};
     size_t waypoint = 0;
     float speed {};
 };
 
+// Ground plane velocity in units per tick, path following fills in preferred and avoidance picks velocity
+struct Steering {
+    Vector2 preferred {};
+    Vector2 velocity {};
+    float max_speed {};
+};
+
+// Steers around other agents instead of walking through them
+struct Agent {
+    float radius { 0.4f };
+};
+
 struct Spin {
     float speed {};
 };
@@ -19,12 +33,18 @@ struct Bounce {
     float center_y {};
 };
 
+// Mouse state sampled on the render side each frame, the simulation never polls input itself
+struct PointerInput {
+    bool down { false };
+    Ray ray {};
+};
+
 struct Consumer {
     float range {};
 };
 
 struct Consumable {
-    std::vector<Color> colors;
+    assets::Handle<assets::Palette> palette {};
     int particles { 25 };
 };
 
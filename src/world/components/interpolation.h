@@ -1,11 +1,25 @@
 #pragma once
 #include <raylib.h>
+#include <vector>
+#include "world/transforms.h"
+
+// Entities that never move after being placed, their render state is only updated when
+// WorldTransform is set and the fixed and pre render interpolation skip them entirely
+struct Static {};
 
 struct InterpolationState {
     Vector3 prev_pos { 0.0f, 0.0f, 0.0f };
     Vector3 render_pos { 0.0f, 0.0f, 0.0f };
-    Vector3 prev_rot { 0.0f, 0.0f, 0.0f };
-    Quaternion render_rot { 0.0f, 0.0f, 0.0f, 0.0f };
+    Quaternion prev_rot { 0.0f, 0.0f, 0.0f, 1.0f };
+    Quaternion render_rot { 0.0f, 0.0f, 0.0f, 1.0f };
     float render_scale { 1.0f };
     float prev_scale { 1.0f };
-};
\ No newline at end of file
+    int render_index { -1 };
+    bool settled { false };
+};
+
+// World matrices of every interpolated entity for this frame, indexed by InterpolationState::render_index
+struct RenderTransforms {
+    transforms::Batch batch {};
+    std::vector<transforms::Affine> matrices {};
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+// Update schedule of an entity whose fixed systems can run at a reduced rate. Systems only
+// update it on due ticks, catching up on all the ticks it skipped since the last one.
+struct SimLod {
+    uint8_t interval { 1 };  // Ticks between updates
+    uint8_t countdown { 1 }; // Ticks until the next update
+    uint8_t pending { 0 };   // Ticks passed since the last update
+    uint8_t steps { 1 };     // Ticks to apply on a due tick
+    bool due { true };
+};
+
+// Entities within near of the camera target and on screen update every tick, further ones
+// every mid_interval or far_interval ticks, and off screen ones every hidden_interval ticks
+struct SimLodConfig {
+    float near { 12.0f };
+    float far { 20.0f };
+    uint8_t mid_interval { 2 };
+    uint8_t far_interval { 4 };
+    uint8_t hidden_interval { 8 };
+    float view_aspect { 2.0f }; // Wider than any common window, so nothing visible counts as off screen
+};
+
+struct SimLodStats {
+    int entities {};
+    int due {};
+    int full_rate {};
+};
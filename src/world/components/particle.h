@@ -1,6 +1,6 @@
 #pragma once
 #include <raylib.h>
-#include <vector>
+#include "assets/assets.h"
 
 struct Explosion {
     int particles { 25 };
@@ -8,7 +8,7 @@ struct Explosion {
     float max_speed { 0.03f };
     float min_lifetime { 0.8f };
     float max_lifetime { 0.8f };
-    std::vector<Color> colors {};
+    assets::Handle<assets::Palette> palette {};
 };
 
 struct Particle {
@@ -1,8 +1,11 @@
 #pragma once
-#include <map>
 #include <optional>
 #include <raylib.h>
 #include <string>
+#include <vector>
+#include "assets/assets.h"
+#include "world/terrain/terrain.h"
+#include "world/uniforms.h"
 
 struct WorldCamera {
     Camera camera {};
@@ -11,30 +14,77 @@ struct WorldCamera {
 
 struct CameraFollow {};
 
+// Models and animation sets are shared between entities through the asset registry
 struct WorldModel {
-    std::map<std::string, ModelAnimation> animations {};
-    Model model {};
+    assets::Handle<Model> model {};
+    assets::Handle<assets::AnimationSet> animations {};
     bool textured { false };
 };
 
+struct GroundChunk {
+    BoundingBox bounds {};
+    int meshes[GROUND_LOD_LEVELS] {};
+};
+
 struct WorldGround {
     Model model {};
+    std::vector<GroundChunk> chunks {};
+    int vertices_updated {}; // Re-uploaded by the last terrain edit
 };
 
 struct WorldWater {
     Model model {};
-    float time {};
+    std::vector<BoundingBox> patches {};
 };
 
+// Wave clock and draw counts of the terrain. Owned by the thread that draws it, the singletons
+// above are only read while drawing since the simulation thread may be using them.
+struct TerrainDraw {
+    float water_time {};
+    int chunks_drawn {};
+    int vertices_drawn {};
+    int patches_drawn {};
+    int triangles_drawn {};
+};
+
+constexpr int ANIMATION_UNRESOLVED { -2 };
+
 struct Animation {
     std::string name;
     std::optional<std::string> run_once { std::nullopt };
     float frame_time { 0.0f };
+    float prev_frame_time { 0.0f };
+    // Index of the playing clip in the model's set, -1 when it has none. Looked up by
+    // advance_animation after play or play_once, so clip changes have to go through those.
+    int clip { ANIMATION_UNRESOLVED };
+};
+
+inline void play(Animation &animation, const char *name) {
+    if (animation.name != name) {
+        animation.name = name;
+        animation.clip = ANIMATION_UNRESOLVED;
+    }
+}
+
+// Plays a clip once from the start, then goes back to the looping one
+inline void play_once(Animation &animation, const char *name) {
+    animation.run_once = name;
+    animation.frame_time = 0.0f;
+    animation.clip = ANIMATION_UNRESOLVED;
+}
+
+// Blended bone pose sampled on the render side, between two keyframes
+struct AnimationPose {
+    std::vector<Transform> bones {};
+    int clip { -1 };
+    int frames_since_sample { 0 };
+    bool sampled { false };
+    bool dirty { false };
 };
 
 struct WorldTransform {
     Vector3 pos { 0.0f, 0.0f, 0.0f };
-    Vector3 rot { 0.0f, 0.0f, 0.0f };
+    Quaternion rot { 0.0f, 0.0f, 0.0f, 1.0f };
     float scale { 1.0f };
 };
 
@@ -45,28 +95,24 @@ struct PrevWorldTransform {
 
 struct ModelShader {
     Shader shader;
-    int loc_light_dir;
-    int loc_light_color;
-    int loc_view_pos;
+    uniforms::FrameLocations frame;
     int loc_use_texture;
 };
 
 struct GroundShader {
     Shader shader;
-    int loc_light_dir;
-    int loc_light_color;
-    int loc_view_pos;
+    uniforms::FrameLocations frame;
     int loc_shadow_count;
     int loc_shadow_positions;
     int loc_shadow_radii;
     int loc_shadow_itensities;
+    int loc_morph_center;
+    int loc_morph_range;
 };
 
 struct WaterShader {
     Shader shader;
-    int loc_light_dir;
-    int loc_light_color;
-    int loc_view_pos;
+    uniforms::FrameLocations frame;
     int loc_time;
 };
 
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+// Entities that are bucketed by terrain chunk and made dormant when their chunk leaves the streaming radius
+struct Streamed {};
+
+// Chunks are restored once they come within radius of the camera target, and made dormant
+// again beyond radius + hysteresis so a camera on a chunk border doesn't thrash
+struct StreamingConfig {
+    float radius { 24.0f };
+    float hysteresis { 4.0f };
+};
+
+struct StreamingStats {
+    int active_entities {};
+    int dormant_entities {};
+    int dormant_chunks {};
+    int restoring_chunks {};
+    size_t dormant_bytes {};
+
+    // Chunks moved by the last update and the time it took
+    int chunks_restored {};
+    int chunks_made_dormant {};
+    float restore_ms {};
+    float dormant_ms {};
+};
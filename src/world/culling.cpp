@@ -0,0 +1,61 @@
+#include "culling.h"
+#include <cmath>
+#include <raymath.h>
+#include "rlgl.h"
+
+namespace culling {
+    auto camera_frustum(const Camera &camera, const float aspect) -> Frustum {
+        const auto view { MatrixLookAt(camera.position, camera.target, camera.up) };
+        const auto projection { MatrixPerspective(camera.fovy * DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR) };
+        return frustum_from_matrix(MatrixMultiply(view, projection));
+    }
+
+    // Gribb/Hartmann plane extraction, raylib matrices are column major
+    auto frustum_from_matrix(const Matrix &m) -> Frustum {
+        const Vector4 row0 { m.m0, m.m4, m.m8, m.m12 };
+        const Vector4 row1 { m.m1, m.m5, m.m9, m.m13 };
+        const Vector4 row2 { m.m2, m.m6, m.m10, m.m14 };
+        const Vector4 row3 { m.m3, m.m7, m.m11, m.m15 };
+
+        Frustum frustum {{
+            Vector4Add(row3, row0),
+            Vector4Subtract(row3, row0),
+            Vector4Add(row3, row1),
+            Vector4Subtract(row3, row1),
+            Vector4Add(row3, row2),
+            Vector4Subtract(row3, row2),
+        }};
+
+        for (auto &plane : frustum.planes) {
+            const auto length { std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z) };
+            plane = Vector4Scale(plane, 1.0f / length);
+        }
+
+        return frustum;
+    }
+
+    auto is_box_visible(const Frustum &frustum, const BoundingBox &box) -> bool {
+        for (const auto &plane : frustum.planes) {
+            // Corner furthest along the plane normal
+            const auto x { plane.x >= 0.0f ? box.max.x : box.min.x };
+            const auto y { plane.y >= 0.0f ? box.max.y : box.min.y };
+            const auto z { plane.z >= 0.0f ? box.max.z : box.min.z };
+
+            if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    auto is_sphere_visible(const Frustum &frustum, const Vector3 &center, const float radius) -> bool {
+        for (const auto &plane : frustum.planes) {
+            if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <raylib.h>
+
+namespace culling {
+    // Planes as (normal, distance), pointing into the frustum
+    struct Frustum {
+        Vector4 planes[6];
+    };
+
+    // Frustum BeginMode3D would set up for a perspective camera, without touching rlgl
+    auto camera_frustum(const Camera &camera, float aspect) -> Frustum;
+    auto frustum_from_matrix(const Matrix &view_projection) -> Frustum;
+
+    auto is_box_visible(const Frustum &frustum, const BoundingBox &box) -> bool;
+    auto is_sphere_visible(const Frustum &frustum, const Vector3 &center, float radius) -> bool;
+}
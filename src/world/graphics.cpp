@@ -0,0 +1,159 @@
+#include "graphics.h"
+#include <raymath.h>
+#include "rlgl.h"
+
+namespace graphics {
+    namespace {
+        RaylibBackend raylib_backend;
+        Backend *active { &raylib_backend };
+
+        // Vertices raylib emits for DrawCube
+        constexpr size_t CUBE_VERTICES { 36 };
+    }
+
+    void RaylibBackend::begin_3d(const Camera &camera) {
+        BeginMode3D(camera);
+    }
+
+    void RaylibBackend::end_3d() {
+        EndMode3D();
+    }
+
+    void RaylibBackend::begin_shader(const Shader &shader) {
+        BeginShaderMode(shader);
+    }
+
+    void RaylibBackend::end_shader() {
+        EndShaderMode();
+    }
+
+    void RaylibBackend::begin_blend(const int mode) {
+        BeginBlendMode(mode);
+    }
+
+    void RaylibBackend::end_blend() {
+        EndBlendMode();
+    }
+
+    void RaylibBackend::set_uniform(const Shader &shader, const int location, const void *value, const int type, const int count) {
+        SetShaderValueV(shader, location, value, type, count);
+    }
+
+    void RaylibBackend::draw_mesh(const Mesh &mesh, const Material &material, const Matrix &transform) {
+        DrawMesh(mesh, material, transform);
+    }
+
+    void RaylibBackend::draw_model(const Model &model, const Matrix &transform) {
+        auto instance { model };
+        instance.transform = transform;
+        DrawModel(instance, {}, 1.0f, WHITE);
+    }
+
+    void RaylibBackend::draw_cube(const Matrix &transform, const Color color) {
+        rlPushMatrix();
+        rlMultMatrixf(MatrixToFloat(transform));
+        DrawCube({0, 0, 0}, 1.0f, 1.0f, 1.0f, color);
+        rlPopMatrix();
+    }
+
+    void RaylibBackend::skin(const Model &model, const ModelAnimation &animation) {
+        UpdateModelAnimation(model, animation, 0);
+    }
+
+    auto RaylibBackend::aspect() const -> float {
+        return static_cast<float>(GetScreenWidth()) / static_cast<float>(GetScreenHeight());
+    }
+
+    RecordingBackend::RecordingBackend(const float aspect) : target_aspect(aspect) {}
+
+    void RecordingBackend::begin_3d(const Camera&) {}
+
+    void RecordingBackend::end_3d() {}
+
+    void RecordingBackend::begin_shader(const Shader &next) {
+        if (next.id != shader) {
+            counted.shader_changes++;
+            shader = next.id;
+        }
+    }
+
+    // Back to the default shader, which raylib binds as a shader of its own
+    void RecordingBackend::end_shader() {
+        if (shader != 0) {
+            counted.shader_changes++;
+            shader = 0;
+        }
+    }
+
+    void RecordingBackend::begin_blend(const int mode) {
+        if (mode != blend) {
+            counted.blend_changes++;
+            blend = mode;
+        }
+    }
+
+    void RecordingBackend::end_blend() {
+        begin_blend(BLEND_ALPHA);
+    }
+
+    void RecordingBackend::set_uniform(const Shader&, const int, const void*, const int type, const int count) {
+        counted.uniform_uploads++;
+        counted.uniform_bytes += uniform_size(type) * static_cast<size_t>(count);
+    }
+
+    // DrawMesh picks the indexed path by the CPU index pointer, without it the vertices are drawn in order
+    void RecordingBackend::draw_mesh(const Mesh &mesh, const Material&, const Matrix&) {
+        counted.draw_calls++;
+        counted.vertices += static_cast<size_t>(mesh.vertexCount);
+
+        if (mesh.indices != nullptr) {
+            counted.triangles += static_cast<size_t>(mesh.triangleCount);
+        } else {
+            counted.triangles += static_cast<size_t>(mesh.vertexCount / 3);
+            counted.broken_draws += mesh.triangleCount * 3 != mesh.vertexCount ? 1 : 0;
+        }
+    }
+
+    void RecordingBackend::draw_model(const Model &model, const Matrix &transform) {
+        for (int i { 0 }; i < model.meshCount; ++i) {
+            draw_mesh(model.meshes[i], model.materials[model.meshMaterial[i]], transform);
+        }
+    }
+
+    void RecordingBackend::draw_cube(const Matrix&, const Color) {
+        counted.draw_calls++;
+        counted.vertices += CUBE_VERTICES;
+    }
+
+    void RecordingBackend::skin(const Model &model, const ModelAnimation&) {
+        counted.skinned_meshes += static_cast<size_t>(model.meshCount);
+    }
+
+    auto RecordingBackend::aspect() const -> float {
+        return target_aspect;
+    }
+
+    auto uniform_size(const int type) -> size_t {
+        switch (type) {
+            case SHADER_UNIFORM_VEC2:
+            case SHADER_UNIFORM_IVEC2:
+                return 8;
+            case SHADER_UNIFORM_VEC3:
+            case SHADER_UNIFORM_IVEC3:
+                return 12;
+            case SHADER_UNIFORM_VEC4:
+            case SHADER_UNIFORM_IVEC4:
+                return 16;
+            default:
+                return 4;
+        }
+    }
+
+    auto backend() -> Backend& {
+        return *active;
+    }
+
+    void use_backend(Backend *backend) {
+        active = backend != nullptr ? backend : &raylib_backend;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <raylib.h>
+
+namespace graphics {
+    // The raylib calls the render path makes, so it can run without a GL context
+    class Backend {
+        public:
+            virtual ~Backend() = default;
+
+            virtual void begin_3d(const Camera &camera) = 0;
+            virtual void end_3d() = 0;
+            virtual void begin_shader(const Shader &shader) = 0;
+            virtual void end_shader() = 0;
+            virtual void begin_blend(int mode) = 0;
+            virtual void end_blend() = 0;
+
+            virtual void set_uniform(const Shader &shader, int location, const void *value, int type, int count) = 0;
+
+            virtual void draw_mesh(const Mesh &mesh, const Material &material, const Matrix &transform) = 0;
+            virtual void draw_model(const Model &model, const Matrix &transform) = 0;
+            virtual void draw_cube(const Matrix &transform, Color color) = 0;
+
+            // Skins the meshes of a model with the first frame of an animation
+            virtual void skin(const Model &model, const ModelAnimation &animation) = 0;
+
+            // Aspect ratio of the render target, used for culling
+            virtual auto aspect() const -> float = 0;
+    };
+
+    class RaylibBackend final : public Backend {
+        public:
+            void begin_3d(const Camera &camera) override;
+            void end_3d() override;
+            void begin_shader(const Shader &shader) override;
+            void end_shader() override;
+            void begin_blend(int mode) override;
+            void end_blend() override;
+            void set_uniform(const Shader &shader, int location, const void *value, int type, int count) override;
+            void draw_mesh(const Mesh &mesh, const Material &material, const Matrix &transform) override;
+            void draw_model(const Model &model, const Matrix &transform) override;
+            void draw_cube(const Matrix &transform, Color color) override;
+            void skin(const Model &model, const ModelAnimation &animation) override;
+            auto aspect() const -> float override;
+    };
+
+    struct Counters {
+        size_t draw_calls {};
+        size_t vertices {};
+        size_t triangles {};
+        size_t broken_draws {}; // Shared vertex meshes without indices, raylib would draw them as a triangle soup
+        size_t uniform_uploads {};
+        size_t uniform_bytes {};
+        size_t shader_changes {};
+        size_t blend_changes {};
+        size_t skinned_meshes {};
+    };
+
+    // Counts what would reach the GPU and draws nothing. Skinning is counted but not done,
+    // it would upload the skinned vertices.
+    class RecordingBackend final : public Backend {
+        public:
+            explicit RecordingBackend(float aspect = 16.0f / 9.0f);
+
+            void begin_3d(const Camera &camera) override;
+            void end_3d() override;
+            void begin_shader(const Shader &shader) override;
+            void end_shader() override;
+            void begin_blend(int mode) override;
+            void end_blend() override;
+            void set_uniform(const Shader &shader, int location, const void *value, int type, int count) override;
+            void draw_mesh(const Mesh &mesh, const Material &material, const Matrix &transform) override;
+            void draw_model(const Model &model, const Matrix &transform) override;
+            void draw_cube(const Matrix &transform, Color color) override;
+            void skin(const Model &model, const ModelAnimation &animation) override;
+            auto aspect() const -> float override;
+
+            auto counters() const -> const Counters& { return counted; }
+            void reset() { counted = {}; }
+
+        private:
+            float target_aspect;
+            unsigned int shader { 0 };
+            int blend { BLEND_ALPHA };
+            Counters counted {};
+    };
+
+    // Bytes of one element of a raylib uniform type
+    auto uniform_size(int type) -> size_t;
+
+    auto backend() -> Backend&;
+
+    // Routes the render path to another backend, nullptr goes back to raylib
+    void use_backend(Backend *backend);
+}
@@ -0,0 +1,215 @@
+#include "quality.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include "world/world.h"
+
+namespace quality {
+    namespace {
+        constexpr Tier TIERS[] {
+            { "high",   1.00f, 64, 25, 1, 1e6f,  0 },
+            { "medium", 0.85f, 32, 16, 1, 48.0f, 0 },
+            { "low",    0.70f, 16, 10, 2, 32.0f, 1 },
+            { "lowest", 0.50f,  8,  6, 4, 20.0f, 1 },
+        };
+        constexpr int TIER_COUNT { static_cast<int>(std::size(TIERS)) };
+
+        constexpr int WINDOW { 60 };
+
+        // Stepping down reacts within a second, stepping up needs a long calm stretch so a
+        // tier that only just fits isn't left and re-entered over and over
+        constexpr float DOWN_AFTER { 1.0f };
+        constexpr float UP_AFTER { 6.0f };
+        constexpr float OVER_BUDGET { 1.15f };
+        constexpr float WORK_HEADROOM { 0.6f };
+        constexpr float TICK_OVER_BUDGET { 0.75f };
+        constexpr float TICK_HEADROOM { 0.4f };
+
+        struct Window {
+            float samples[WINDOW] {};
+            int count { 0 };
+            int next { 0 };
+
+            void push(const float value) {
+                samples[next] = value;
+                next = (next + 1) % WINDOW;
+                count = std::min(count + 1, WINDOW);
+            }
+
+            auto average() const -> float {
+                auto total { 0.0f };
+                for (int i { 0 }; i < count; ++i) {
+                    total += samples[i];
+                }
+                return count > 0 ? total / static_cast<float>(count) : 0.0f;
+            }
+
+            auto full() const -> bool { return count == WINDOW; }
+        };
+
+        std::atomic<int> active { 0 };
+        int forced { -1 };
+
+        // Ticks may run on the simulation thread, they are summed up until the next frame
+        std::atomic<uint64_t> tick_ns { 0 };
+        std::atomic<uint32_t> ticks { 0 };
+
+        Window frames;
+        Window work;
+        Window tick_times;
+        float overloaded_for { 0.0f };
+        float headroom_for { 0.0f };
+        float target_ms { 0.0f };
+
+        std::mutex stats_mutex;
+        Stats last { .tier = 0, .name = TIERS[0].name };
+
+        RenderTexture2D target {};
+        bool scene_offscreen { false };
+
+        void change_tier(const int to, const Reason reason) {
+            const auto from { active.load() };
+            active = to;
+
+            frames = {};
+            work = {};
+            tick_times = {};
+            overloaded_for = 0.0f;
+            headroom_for = 0.0f;
+
+            std::lock_guard lock { stats_mutex };
+            last.changes++;
+            last.last = {
+                .reason = reason,
+                .from = from,
+                .to = to,
+                .frame_ms = last.frame_ms,
+                .work_ms = last.work_ms,
+                .tick_ms = last.tick_ms,
+            };
+
+            TraceLog(LOG_INFO, "QUALITY: %s -> %s, %s (frame %.1f ms, work %.1f ms, tick %.2f ms)", TIERS[from].name, TIERS[to].name,
+                reason == Reason::Overloaded ? "over budget" : reason == Reason::Headroom ? "headroom" : "forced",
+                last.frame_ms, last.work_ms, last.tick_ms);
+        }
+    }
+
+    auto tier_count() -> int {
+        return TIER_COUNT;
+    }
+
+    auto tier(const int index) -> const Tier& {
+        return TIERS[std::clamp(index, 0, TIER_COUNT - 1)];
+    }
+
+    auto current() -> const Tier& {
+        return TIERS[active.load(std::memory_order_relaxed)];
+    }
+
+    void force_tier(const int index) {
+        forced = index < 0 ? -1 : std::min(index, TIER_COUNT - 1);
+        if (forced >= 0 && forced != active) {
+            change_tier(forced, Reason::None);
+        }
+    }
+
+    void begin_scene(const Color clear) {
+        const auto scale { current().render_scale };
+        if (scale >= 1.0f) {
+            if (target.id != 0) {
+                UnloadRenderTexture(target);
+                target = {};
+            }
+            return;
+        }
+
+        const auto width { std::max(1, static_cast<int>(static_cast<float>(GetScreenWidth()) * scale)) };
+        const auto height { std::max(1, static_cast<int>(static_cast<float>(GetScreenHeight()) * scale)) };
+        if (target.id == 0 || target.texture.width != width || target.texture.height != height) {
+            if (target.id != 0) {
+                UnloadRenderTexture(target);
+            }
+            target = LoadRenderTexture(width, height);
+            SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+        }
+
+        BeginTextureMode(target);
+        ClearBackground(clear);
+        scene_offscreen = true;
+    }
+
+    void end_scene() {
+        if (!scene_offscreen) {
+            return;
+        }
+
+        EndTextureMode();
+        scene_offscreen = false;
+
+        // Render textures are stored bottom up
+        const auto width { static_cast<float>(target.texture.width) };
+        const auto height { static_cast<float>(target.texture.height) };
+        DrawTexturePro(target.texture, { 0.0f, 0.0f, width, -height },
+            { 0.0f, 0.0f, static_cast<float>(GetScreenWidth()), static_cast<float>(GetScreenHeight()) }, { 0.0f, 0.0f }, 0.0f, WHITE);
+    }
+
+    void record_frame(const float frame_seconds, const float work_seconds) {
+        if (target_ms == 0.0f) {
+            const auto refresh { GetMonitorRefreshRate(GetCurrentMonitor()) };
+            target_ms = 1000.0f / static_cast<float>(refresh > 0 ? refresh : 60);
+        }
+
+        frames.push(frame_seconds * 1000.0f);
+        work.push(work_seconds * 1000.0f);
+        if (const auto count { ticks.exchange(0) }; count > 0) {
+            tick_times.push(static_cast<float>(tick_ns.exchange(0)) / 1e6f / static_cast<float>(count));
+        }
+
+        const auto frame_ms { frames.average() };
+        const auto work_ms { work.average() };
+        const auto tick_ms { tick_times.average() };
+        const auto tick_budget_ms { FIXED_DT * 1000.0f };
+
+        {
+            std::lock_guard lock { stats_mutex };
+            last.tier = active;
+            last.name = current().name;
+            last.target_ms = target_ms;
+            last.frame_ms = frame_ms;
+            last.work_ms = work_ms;
+            last.tick_ms = tick_ms;
+        }
+
+        // Decisions wait for a full window after start up or the last change
+        if (forced >= 0 || !frames.full()) {
+            return;
+        }
+
+        // With vsync a frame never finishes early, so headroom is judged by the CPU time of a frame
+        const auto overloaded { frame_ms > target_ms * OVER_BUDGET || tick_ms > tick_budget_ms * TICK_OVER_BUDGET };
+        const auto headroom { frame_ms <= target_ms * 1.05f && work_ms < target_ms * WORK_HEADROOM && tick_ms < tick_budget_ms * TICK_HEADROOM };
+
+        overloaded_for = overloaded ? overloaded_for + frame_seconds : 0.0f;
+        headroom_for = headroom ? headroom_for + frame_seconds : 0.0f;
+
+        const auto index { active.load() };
+        if (overloaded_for >= DOWN_AFTER && index + 1 < TIER_COUNT) {
+            change_tier(index + 1, Reason::Overloaded);
+        } else if (headroom_for >= UP_AFTER && index > 0) {
+            change_tier(index - 1, Reason::Headroom);
+        }
+    }
+
+    void record_tick(const float seconds) {
+        tick_ns.fetch_add(static_cast<uint64_t>(seconds * 1e9f), std::memory_order_relaxed);
+        ticks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto stats() -> Stats {
+        std::lock_guard lock { stats_mutex };
+        return last;
+    }
+}
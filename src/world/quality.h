@@ -0,0 +1,63 @@
+#pragma once
+#include <raylib.h>
+
+namespace quality {
+    // Settings that trade image quality for frame time, from most to least detailed
+    struct Tier {
+        const char *name;
+        float render_scale;     // Size of the offscreen scene target relative to the window
+        int shadow_budget;      // Casters sent to the ground shader
+        int particle_budget;    // Particles per explosion
+        int animation_interval; // Multiplier on the pose sampling interval
+        float water_range;      // Water patches further from the camera target are skipped
+        int ground_lod_bias;    // Ground chunks use this many coarser levels
+    };
+
+    enum class Reason {
+        None,
+        Overloaded, // Frames or ticks ran over budget for a while
+        Headroom,   // Frames and ticks stayed well within budget for a while
+    };
+
+    struct Decision {
+        Reason reason { Reason::None };
+        int from {};
+        int to {};
+        float frame_ms {};
+        float work_ms {};
+        float tick_ms {};
+    };
+
+    struct Stats {
+        int tier {};
+        const char *name {};
+        float target_ms {};
+        float frame_ms {};   // Rolling average between presents, includes waiting on vsync
+        float work_ms {};    // Rolling average of the CPU time spent building a frame
+        float tick_ms {};    // Rolling average of a fixed tick
+        int changes {};
+        Decision last {};
+    };
+
+    auto tier_count() -> int;
+    auto tier(int index) -> const Tier&;
+
+    // Tier in effect, safe to read from the simulation thread
+    auto current() -> const Tier&;
+
+    // Pins the governor to a tier, or lets it pick again with a negative index
+    void force_tier(int index);
+
+    // Renders the scene into a scaled offscreen target when the tier asks for it, end_scene
+    // draws it upscaled to the window. Between BeginDrawing and EndDrawing.
+    void begin_scene(Color clear);
+    void end_scene();
+
+    // Feeds the governor, once per frame with the time between presents and the CPU time of the frame
+    void record_frame(float frame_seconds, float work_seconds);
+
+    // Once per fixed tick, from whichever thread runs it
+    void record_tick(float seconds);
+
+    auto stats() -> Stats;
+}
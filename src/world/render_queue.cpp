@@ -0,0 +1,152 @@
+#include "render_queue.h"
+#include <algorithm>
+#include <raymath.h>
+
+namespace render_queue {
+    namespace {
+        constexpr int DEPTH_BITS { 24 };
+        constexpr int TEXTURE_BITS { 12 };
+        constexpr int MATERIAL_BITS { 16 };
+        constexpr int SHADER_BITS { 10 };
+
+        constexpr int TEXTURE_SHIFT { DEPTH_BITS };
+        constexpr int MATERIAL_SHIFT { TEXTURE_SHIFT + TEXTURE_BITS };
+        constexpr int SHADER_SHIFT { MATERIAL_SHIFT + MATERIAL_BITS };
+        constexpr int PASS_SHIFT { SHADER_SHIFT + SHADER_BITS };
+
+        constexpr float MAX_DEPTH { 512.0f };
+
+        // Particles share the model shader and sort after every model
+        constexpr uint32_t PARTICLE_MATERIAL { (1u << MATERIAL_BITS) - 1 };
+
+        constexpr auto mask(const int bits) -> uint64_t {
+            return (uint64_t { 1 } << bits) - 1;
+        }
+
+        // Affine rows are the top three rows of a raylib matrix, translation in the last column
+        auto translation(const transforms::Affine &matrix) -> Vector3 {
+            return { matrix.m[3], matrix.m[7], matrix.m[11] };
+        }
+
+        // Everything but depth
+        constexpr auto state_of(const uint64_t key) -> uint64_t {
+            return key >> DEPTH_BITS;
+        }
+    }
+
+    auto make_key(const Pass pass, const uint32_t shader, const uint32_t material, const uint32_t texture, const float depth) -> uint64_t {
+        const auto scaled { static_cast<double>(std::clamp(depth / MAX_DEPTH, 0.0f, 1.0f)) * static_cast<double>(mask(DEPTH_BITS)) };
+        auto quantized { std::min(static_cast<uint64_t>(scaled), mask(DEPTH_BITS)) };
+        if (pass == Pass::Transparent) {
+            quantized = mask(DEPTH_BITS) - quantized;
+        }
+
+        return static_cast<uint64_t>(pass) << PASS_SHIFT |
+               (shader & mask(SHADER_BITS)) << SHADER_SHIFT |
+               (material & mask(MATERIAL_BITS)) << MATERIAL_SHIFT |
+               (texture & mask(TEXTURE_BITS)) << TEXTURE_SHIFT |
+               quantized;
+    }
+
+    auto key_pass(const uint64_t key) -> Pass {
+        return static_cast<Pass>(key >> PASS_SHIFT);
+    }
+
+    auto key_shader(const uint64_t key) -> uint32_t {
+        return static_cast<uint32_t>(key >> SHADER_SHIFT & mask(SHADER_BITS));
+    }
+
+    auto key_material(const uint64_t key) -> uint32_t {
+        return static_cast<uint32_t>(key >> MATERIAL_SHIFT & mask(MATERIAL_BITS));
+    }
+
+    auto key_texture(const uint64_t key) -> uint32_t {
+        return static_cast<uint32_t>(key >> TEXTURE_SHIFT & mask(TEXTURE_BITS));
+    }
+
+    void Queue::begin(const Vector3 &position) {
+        view_pos = position;
+        queued.clear();
+        models.clear();
+        particles.clear();
+        meshes.clear();
+    }
+
+    auto Queue::depth(const Vector3 &position) const -> float {
+        return Vector3Distance(view_pos, position);
+    }
+
+    // Chunks are grouped by level so the morph range only changes between levels
+    void Queue::push_ground(const uint32_t shader, const uint32_t texture, const int chunk, const int level, const Vector3 &center) {
+        queued.push_back({
+            .key = make_key(Pass::Ground, shader, static_cast<uint32_t>(level), texture, depth(center)),
+            .index = static_cast<uint32_t>(meshes.size()),
+            .kind = Kind::GroundChunk,
+        });
+        meshes.push_back({ .mesh = chunk, .level = level });
+    }
+
+    // Instances of a model are grouped, textured and untextured ones apart since useTexture changes between them
+    void Queue::push_model(const uint32_t shader, const uint32_t texture, const WorldModel &model, const transforms::Affine &matrix,
+                           AnimationPose *pose, const flecs::entity_t entity) {
+        const auto material { static_cast<uint32_t>(model.model.id) << 1 | static_cast<uint32_t>(model.textured) };
+        queued.push_back({
+            .key = make_key(Pass::Opaque, shader, std::min(material, PARTICLE_MATERIAL - 1), texture, depth(translation(matrix))),
+            .index = static_cast<uint32_t>(models.size()),
+            .kind = Kind::Model,
+        });
+        models.push_back({ .model = model, .matrix = matrix, .pose = pose, .entity = entity });
+    }
+
+    void Queue::push_particle(const uint32_t shader, const transforms::Affine &matrix, const Color color, const float lifetime) {
+        queued.push_back({
+            .key = make_key(Pass::Opaque, shader, PARTICLE_MATERIAL, 0, depth(translation(matrix))),
+            .index = static_cast<uint32_t>(particles.size()),
+            .kind = Kind::Particle,
+        });
+        particles.push_back({ .matrix = matrix, .color = color, .lifetime = lifetime });
+    }
+
+    void Queue::push_water(const uint32_t shader, const uint32_t texture, const int patch, const Vector3 &center) {
+        queued.push_back({
+            .key = make_key(Pass::Transparent, shader, 0, texture, depth(center)),
+            .index = static_cast<uint32_t>(meshes.size()),
+            .kind = Kind::WaterPatch,
+        });
+        meshes.push_back({ .mesh = patch, .level = 0 });
+    }
+
+    void Queue::sort() {
+        std::sort(queued.begin(), queued.end(), [](const Command &a, const Command &b) {
+            return a.key < b.key;
+        });
+    }
+
+    auto Queue::stats() const -> Stats {
+        Stats stats { .commands = queued.size() };
+
+        for (size_t i { 0 }; i < queued.size(); ++i) {
+            const auto key { queued[i].key };
+            if (i == 0) {
+                stats.pass_changes = 1;
+                stats.shader_changes = 1;
+                stats.material_changes = 1;
+                stats.texture_changes = 1;
+                continue;
+            }
+
+            const auto previous { queued[i - 1].key };
+            if (state_of(key) == state_of(previous)) {
+                stats.merged++;
+                continue;
+            }
+
+            stats.pass_changes += key_pass(key) != key_pass(previous);
+            stats.shader_changes += key_shader(key) != key_shader(previous);
+            stats.material_changes += key_material(key) != key_material(previous);
+            stats.texture_changes += key_texture(key) != key_texture(previous);
+        }
+
+        return stats;
+    }
+}
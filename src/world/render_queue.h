@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <flecs.h>
+#include <raylib.h>
+#include <vector>
+#include "world/transforms.h"
+#include "world/components/render.h"
+
+namespace render_queue {
+    // Passes replay in this order, the ground goes first so faded models blend over it
+    enum class Pass : uint8_t {
+        Ground,
+        Opaque,
+        Transparent,
+    };
+
+    enum class Kind : uint8_t {
+        GroundChunk,
+        Model,
+        Particle,
+        WaterPatch,
+    };
+
+    // From the top: pass (2 bits), shader (10), material (16), texture (12) and depth (24).
+    // Opaque depth sorts front to back, transparent depth back to front.
+    auto make_key(Pass pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) -> uint64_t;
+    auto key_pass(uint64_t key) -> Pass;
+    auto key_shader(uint64_t key) -> uint32_t;
+    auto key_material(uint64_t key) -> uint32_t;
+    auto key_texture(uint64_t key) -> uint32_t;
+
+    struct Command {
+        uint64_t key;
+        uint32_t index; // Into the draw list of its kind
+        Kind kind;
+    };
+
+    struct ModelDraw {
+        WorldModel model;
+        transforms::Affine matrix;
+        AnimationPose *pose;
+        flecs::entity_t entity;
+    };
+
+    struct ParticleDraw {
+        transforms::Affine matrix;
+        Color color;
+        float lifetime;
+    };
+
+    // Ground chunk at a level of detail, or a water patch
+    struct MeshDraw {
+        int mesh;
+        int level;
+    };
+
+    // State changes a replay of the current order makes, counted from the keys alone
+    struct Stats {
+        size_t commands {};
+        size_t pass_changes {};
+        size_t shader_changes {};
+        size_t material_changes {};
+        size_t texture_changes {};
+        size_t merged {}; // Draws that needed no state change at all
+    };
+
+    // Draw commands of one frame. Lists keep their capacity between frames.
+    class Queue {
+        public:
+            void begin(const Vector3 &view_pos);
+
+            void push_ground(uint32_t shader, uint32_t texture, int chunk, int level, const Vector3 &center);
+            void push_model(uint32_t shader, uint32_t texture, const WorldModel &model, const transforms::Affine &matrix,
+                            AnimationPose *pose, flecs::entity_t entity);
+            void push_particle(uint32_t shader, const transforms::Affine &matrix, Color color, float lifetime);
+            void push_water(uint32_t shader, uint32_t texture, int patch, const Vector3 &center);
+
+            void sort();
+            auto stats() const -> Stats;
+
+            auto commands() const -> const std::vector<Command>& { return queued; }
+            auto model(const Command &command) const -> const ModelDraw& { return models[command.index]; }
+            auto particle(const Command &command) const -> const ParticleDraw& { return particles[command.index]; }
+            auto mesh(const Command &command) const -> const MeshDraw& { return meshes[command.index]; }
+
+        private:
+            auto depth(const Vector3 &position) const -> float;
+
+            Vector3 view_pos {};
+            std::vector<Command> queued {};
+            std::vector<ModelDraw> models {};
+            std::vector<ParticleDraw> particles {};
+            std::vector<MeshDraw> meshes {};
+    };
+}
@@ -0,0 +1,140 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include "assets/assets.h"
+#include "memory/memory.h"
+#include "world/quality.h"
+#include "world/world.h"
+#include "world/systems/render.h"
+
+using Clock = std::chrono::steady_clock;
+
+Simulation::Simulation(World &world)
+    : world(world),
+      renderable(world.ecs.query<const WorldTransform, const InterpolationState, const WorldModel*, const Animation*, const ShadowCaster*, const Particle*>()) {
+    if (const auto *cam { world.ecs.get<WorldCamera>() }) {
+        view.camera = cam->camera;
+        view.distance = cam->distance;
+        posted.camera = cam->camera;
+    }
+
+    borrow_resources();
+    thread = std::thread([this] { run(); });
+    TraceLog(LOG_INFO, "SIMULATION: fixed pipelines moved to a simulation thread");
+}
+
+Simulation::~Simulation() {
+    running = false;
+    thread.join();
+}
+
+void Simulation::render() {
+    frames.acquire();
+    const auto &frame { frames.front() };
+
+    // Frames carry the transforms before and after their tick, so the render side trails by one tick like in serial mode
+    const auto since { std::chrono::duration<float>(Clock::now() - frame.published).count() };
+    const auto alpha { std::clamp(since / FIXED_DT, 0.0f, 1.0f) };
+    render_systems::render_frame(view, frame, alpha, std::min(GetFrameTime(), MAX_FRAME_TIME));
+
+    std::lock_guard lock { view_mutex };
+    posted = {
+        .camera = view.camera,
+        .pointer = {
+            .down = IsMouseButtonDown(MOUSE_LEFT_BUTTON),
+            .ray = GetMouseRay(GetMousePosition(), view.camera),
+        },
+    };
+}
+
+void Simulation::exclusive(const std::function<void()> &fn) {
+    std::lock_guard lock { ecs_mutex };
+    fn();
+    borrow_resources();
+}
+
+void Simulation::borrow_resources() {
+    view.model_shader = world.ecs.get<ModelShader>();
+    view.ground_shader = world.ecs.get<GroundShader>();
+    view.water_shader = world.ecs.get<WaterShader>();
+    view.ground = world.ecs.get<WorldGround>();
+    view.water = world.ecs.get<WorldWater>();
+}
+
+void Simulation::run() {
+    const auto step { std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(FIXED_DT)) };
+    const auto max_behind { std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(MAX_FRAME_TIME)) };
+    auto next { Clock::now() };
+
+    while (running) {
+        {
+            std::lock_guard lock { ecs_mutex };
+
+            ViewState view_state;
+            {
+                std::lock_guard view_lock { view_mutex };
+                view_state = posted;
+            }
+
+            if (auto *cam { world.ecs.get_mut<WorldCamera>() }) {
+                cam->camera = view_state.camera;
+            }
+            world.ecs.set<PointerInput>(view_state.pointer);
+
+            const auto tick_start { Clock::now() };
+            memory::begin_tick();
+            world.ecs.run_pipeline(world.pre_fixed_pipeline, FIXED_DT);
+            world.ecs.run_pipeline(world.fixed_pipeline, FIXED_DT);
+            quality::record_tick(std::chrono::duration<float>(Clock::now() - tick_start).count());
+            publish();
+        }
+
+        // Ticks missed during a long one are dropped rather than run back to back, like MAX_FRAME_TIME in serial mode
+        next += step;
+        if (const auto now { Clock::now() }; now - next > max_behind) {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Simulation::publish() {
+    auto &frame { frames.back() };
+    frame.tick = ++tick;
+    frame.entities.clear();
+
+    renderable.each([&frame](const flecs::entity entity, const WorldTransform &transform, const InterpolationState &state,
+                             const WorldModel *model, const Animation *animation, const ShadowCaster *caster, const Particle *particle) {
+        if (model == nullptr && caster == nullptr && particle == nullptr) {
+            return;
+        }
+
+        auto &out { frame.entities.emplace_back() };
+        out.id = entity.id();
+        out.prev = { .pos = state.prev_pos, .rot = state.prev_rot, .scale = state.prev_scale };
+        out.current = transform;
+        out.follow = entity.has<CameraFollow>();
+        out.shadow_radius = caster != nullptr ? caster->radius : 0.0f;
+
+        if (model != nullptr) {
+            out.model = *model;
+
+            const auto *animations { animation != nullptr ? assets::get(model->animations) : nullptr };
+            if (animations != nullptr) {
+                out.clip = animation->clip;
+                out.prev_frame_time = animation->prev_frame_time;
+                out.frame_time = animation->frame_time;
+                out.run_once = animation->run_once.has_value();
+            }
+        }
+
+        if (particle != nullptr) {
+            out.particle = true;
+            out.color = particle->color;
+            out.lifetime = particle->lifetime;
+        }
+    });
+
+    frame.published = Clock::now();
+    frames.publish();
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <flecs.h>
+#include <functional>
+#include <mutex>
+#include <raylib.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "world/components/gameplay.h"
+#include "world/components/interpolation.h"
+#include "world/components/particle.h"
+#include "world/components/render.h"
+#include "world/render_queue.h"
+#include "world/transforms.h"
+
+class World;
+
+// Render data of one entity at the end of a fixed tick, together with the transform it had before the tick
+struct FrameEntity {
+    flecs::entity_t id { 0 };
+    WorldTransform prev {};
+    WorldTransform current {};
+    WorldModel model {};
+    int clip { -1 };
+    float prev_frame_time { 0.0f };
+    float frame_time { 0.0f };
+    bool run_once { false };
+    bool follow { false };
+    bool particle { false };
+    Color color { WHITE };
+    float lifetime { 0.0f };
+    float shadow_radius { 0.0f }; // No shadow when zero
+};
+
+// Everything the render side reads from the simulation, published once per fixed tick
+struct SimFrame {
+    uint64_t tick { 0 };
+    std::chrono::steady_clock::time_point published {};
+    std::vector<FrameEntity> entities {};
+};
+
+// Single writer, single reader. The writer always owns a free slot and the reader keeps the
+// newest complete one, so neither side waits for the other.
+template <typename T>
+class TripleBuffer {
+    public:
+        auto back() -> T& { return slots[back_index]; }
+        auto front() const -> const T& { return slots[front_index]; }
+
+        void publish() {
+            back_index = ready.exchange(back_index | FRESH) & INDEX;
+        }
+
+        // Swaps in the newest slot if one was published since the last call
+        auto acquire() -> bool {
+            if ((ready.load() & FRESH) == 0) {
+                return false;
+            }
+
+            front_index = ready.exchange(front_index) & INDEX;
+            return true;
+        }
+
+    private:
+        static constexpr unsigned INDEX { 3 };
+        static constexpr unsigned FRESH { 4 };
+
+        T slots[3] {};
+        unsigned back_index { 0 };
+        std::atomic<unsigned> ready { 1 };
+        unsigned front_index { 2 };
+};
+
+// What the render thread last showed, picked up by the simulation at the start of each tick
+struct ViewState {
+    Camera camera {};
+    PointerInput pointer {};
+};
+
+struct FramePose {
+    AnimationPose pose {};
+    uint64_t tick { 0 };
+};
+
+// Render thread state. Resources are borrowed from ECS singletons, which are only replaced
+// inside Simulation::exclusive so their storage doesn't move while a tick runs.
+struct FrameView {
+    Camera camera {};
+    float distance {};
+    const ModelShader *model_shader { nullptr };
+    const GroundShader *ground_shader { nullptr };
+    const WaterShader *water_shader { nullptr };
+    const WorldGround *ground { nullptr };
+    const WorldWater *water { nullptr };
+    TerrainDraw terrain {};
+    transforms::Batch batch {};
+    std::vector<transforms::Affine> matrices {};
+    std::unordered_map<flecs::entity_t, FramePose> poses {};
+    render_queue::Queue queue {};
+};
+
+// Runs the fixed pipelines on a thread of their own and publishes a SimFrame after every tick
+class Simulation {
+    public:
+        explicit Simulation(World &world);
+        ~Simulation();
+
+        Simulation(const Simulation&) = delete;
+        auto operator=(const Simulation&) -> Simulation& = delete;
+
+        // Render thread, draws the newest frame interpolated by the time passed since it was published
+        void render();
+
+        // Runs fn between two ticks, for main thread code that has to touch the ECS
+        void exclusive(const std::function<void()> &fn);
+
+    private:
+        void run();
+        void publish();
+        void borrow_resources();
+
+        World &world;
+        flecs::query<const WorldTransform, const InterpolationState, const WorldModel*, const Animation*, const ShadowCaster*, const Particle*> renderable;
+        TripleBuffer<SimFrame> frames;
+        FrameView view;
+        std::mutex ecs_mutex;
+        std::mutex view_mutex;
+        ViewState posted {};
+        uint64_t tick { 0 };
+        std::atomic<bool> running { true };
+        std::thread thread;
+};
@@ -0,0 +1,553 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <raylib.h>
+#include <string_view>
+#include <type_traits>
+#include "world/components/gameplay.h"
+#include "world/components/interpolation.h"
+#include "world/components/particle.h"
+#include "world/components/render.h"
+#include "world/components/streaming.h"
+#include "world/systems/interpolation.h"
+#include "world/terrain/terrain.h"
+
+namespace snapshot {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        class Writer {
+            public:
+                std::vector<uint8_t> bytes;
+
+                void write(const void *data, const size_t size) {
+                    const auto *begin { static_cast<const uint8_t*>(data) };
+                    bytes.insert(bytes.end(), begin, begin + size);
+                }
+
+                template <typename T>
+                void value(const T &value) {
+                    write(&value, sizeof(T));
+                }
+
+                void string(const std::string_view string) {
+                    value(static_cast<uint32_t>(string.size()));
+                    write(string.data(), string.size());
+                }
+
+                void align() {
+                    bytes.resize((bytes.size() + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+                }
+        };
+
+        // Reads in place, a short buffer clears ok and every later read returns zeroes
+        class Reader {
+            public:
+                bool ok { true };
+
+                Reader(const uint8_t *data, const size_t size) : data(data), size(size) {}
+
+                auto view(const size_t count) -> const uint8_t* {
+                    if (!ok || count > size - pos) {
+                        ok = false;
+                        return nullptr;
+                    }
+
+                    const auto *at { data + pos };
+                    pos += count;
+                    return at;
+                }
+
+                template <typename T>
+                auto value() -> T {
+                    T value {};
+                    if (const auto *at { view(sizeof(T)) }) {
+                        std::memcpy(&value, at, sizeof(T));
+                    }
+                    return value;
+                }
+
+                auto string() -> std::string {
+                    const auto length { value<uint32_t>() };
+                    const auto *at { view(length) };
+                    return at ? std::string(reinterpret_cast<const char*>(at), length) : std::string {};
+                }
+
+                auto remaining() const -> size_t {
+                    return ok ? size - pos : 0;
+                }
+
+                // Counts read from the data are checked against this before anything is allocated for them
+                auto fits(const size_t count, const size_t min_bytes) -> bool {
+                    if (count > remaining() / min_bytes) {
+                        ok = false;
+                    }
+                    return ok;
+                }
+
+                // Offsets are relative to the section payload, which starts aligned
+                void align() {
+                    pos = std::min(size, static_cast<size_t>((pos + ALIGNMENT - 1) & ~(ALIGNMENT - 1)));
+                }
+
+            private:
+                const uint8_t *data;
+                size_t size;
+                size_t pos { 0 };
+        };
+
+        // Column ready to be handed to the ECS, owner keeps deserialized values alive
+        struct Column {
+            std::shared_ptr<void> owner {};
+            const void *data { nullptr };
+        };
+
+        // Components with an owned copy in an archetype are written, inherited values come back through the prefab.
+        // Trivially copyable components are written as raw columns, the rest element by element.
+        struct Component {
+            const char *name;
+            ecs_id_t id;
+            size_t size;
+            void (*write)(Writer &out, const void *column, size_t count);
+            Column (*read)(Reader &in, size_t count);
+        };
+
+        void write_value(Writer &out, const MoveTo &move_to) {
+            out.value(static_cast<uint32_t>(move_to.path.size()));
+            out.write(move_to.path.data(), move_to.path.size() * sizeof(Vector3));
+            out.value(static_cast<uint64_t>(move_to.waypoint));
+            out.value(move_to.speed);
+        }
+
+        void read_value(Reader &in, MoveTo &move_to) {
+            const auto length { in.value<uint32_t>() };
+            if (const auto *path { in.view(length * sizeof(Vector3)) }) {
+                move_to.path.resize(length);
+                std::memcpy(move_to.path.data(), path, length * sizeof(Vector3));
+            }
+            move_to.waypoint = static_cast<size_t>(in.value<uint64_t>());
+            move_to.speed = in.value<float>();
+        }
+
+        void write_value(Writer &out, const Animation &animation) {
+            out.string(animation.name);
+            out.value(static_cast<uint8_t>(animation.run_once.has_value()));
+            out.string(animation.run_once.value_or(""));
+            out.value(animation.frame_time);
+            out.value(animation.prev_frame_time);
+        }
+
+        void read_value(Reader &in, Animation &animation) {
+            animation.name = in.string();
+            const auto has_run_once { in.value<uint8_t>() != 0 };
+            auto run_once { in.string() };
+            animation.run_once = has_run_once ? std::optional { std::move(run_once) } : std::nullopt;
+            animation.frame_time = in.value<float>();
+            animation.prev_frame_time = in.value<float>();
+        }
+
+        template <typename T>
+        auto raw(const flecs::world &ecs, const char *name) -> Component {
+            static_assert(std::is_trivially_copyable_v<T>, "raw components are written as bytes");
+            return { name, ecs.id<T>().raw_id(), std::is_empty_v<T> ? 0 : sizeof(T), nullptr, nullptr };
+        }
+
+        template <typename T>
+        auto serialized(const flecs::world &ecs, const char *name) -> Component {
+            return {
+                name,
+                ecs.id<T>().raw_id(),
+                sizeof(T),
+                [](Writer &out, const void *column, const size_t count) {
+                    for (size_t i { 0 }; i < count; ++i) {
+                        write_value(out, static_cast<const T*>(column)[i]);
+                    }
+                },
+                [](Reader &in, const size_t count) -> Column {
+                    // Every value takes at least a byte
+                    if (!in.fits(count, 1)) {
+                        return {};
+                    }
+
+                    auto values { std::make_shared<std::vector<T>>(count) };
+                    for (auto &value : *values) {
+                        read_value(in, value);
+                    }
+                    return { values, values->data() };
+                },
+            };
+        }
+
+        // WorldModel and AnimationPose are left out, models are asset handles and poses are resampled.
+        // InterpolationState is rebuilt from the transform.
+        auto registry(const flecs::world &ecs) -> std::vector<Component> {
+            return {
+                raw<WorldTransform>(ecs, "WorldTransform"),
+                serialized<MoveTo>(ecs, "MoveTo"),
+                raw<Bounce>(ecs, "Bounce"),
+                raw<Consumable>(ecs, "Consumable"),
+                serialized<Animation>(ecs, "Animation"),
+                raw<Particle>(ecs, "Particle"),
+                raw<Spin>(ecs, "Spin"),
+                raw<Collider>(ecs, "Collider"),
+                raw<Agent>(ecs, "Agent"),
+                raw<ShadowCaster>(ecs, "ShadowCaster"),
+                raw<Consumer>(ecs, "Consumer"),
+                raw<CameraFollow>(ecs, "CameraFollow"),
+                raw<Static>(ecs, "Static"),
+                raw<Streamed>(ecs, "Streamed"),
+            };
+        }
+
+        void begin_section(Writer &out, const SectionType type, size_t &start) {
+            out.value(Section { .type = type, .reserved = 0, .size = 0 });
+            start = out.bytes.size();
+        }
+
+        void end_section(Writer &out, const size_t start) {
+            const uint64_t size { out.bytes.size() - start };
+            std::memcpy(out.bytes.data() + start - sizeof(Section) + offsetof(Section, size), &size, sizeof(size));
+            out.align();
+        }
+
+        auto find_section(const std::vector<uint8_t> &snapshot, const SectionType type) -> std::optional<Reader> {
+            Reader in { snapshot.data(), snapshot.size() };
+            const auto header { in.value<Header>() };
+            if (!in.ok || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+                return std::nullopt;
+            }
+
+            for (uint32_t i { 0 }; i < header.section_count; ++i) {
+                const auto section { in.value<Section>() };
+                const auto *payload { in.view(section.size) };
+                if (!in.ok) {
+                    return std::nullopt;
+                }
+
+                if (section.type == type) {
+                    return Reader { payload, section.size };
+                }
+                in.align();
+            }
+
+            return std::nullopt;
+        }
+
+        void write_entities(const flecs::world &ecs, Writer &out, uint32_t &table_count, uint32_t &entity_count) {
+            const auto components { registry(ecs) };
+            const auto header_at { out.bytes.size() };
+            out.value(EntitiesData {});
+
+            ecs.query_builder<>().with<WorldTransform>().build().run([&](flecs::iter &it) {
+                while (it.next()) {
+                    const auto *iter { it.c_ptr() };
+                    const auto count { static_cast<size_t>(it.count()) };
+
+                    std::vector<const Component*> present;
+                    for (const auto &component : components) {
+                        if (ecs_table_has_id(ecs, iter->table, component.id)) {
+                            present.push_back(&component);
+                        }
+                    }
+
+                    const auto prefab { it.entity(0).target(flecs::IsA) };
+                    out.value(TableData { .count = static_cast<uint32_t>(count), .component_count = static_cast<uint32_t>(present.size()) });
+                    out.string(prefab ? prefab.name().c_str() : "");
+
+                    for (const auto *component : present) {
+                        out.string(component->name);
+                    }
+
+                    for (size_t i { 0 }; i < count; ++i) {
+                        const auto *name { ecs_get_name(ecs, it.entity(i)) };
+                        out.string(name ? name : "");
+                    }
+
+                    for (const auto *component : present) {
+                        if (component->size == 0) {
+                            continue;
+                        }
+
+                        const auto *column { ecs_table_get_id(ecs, iter->table, component->id, iter->offset) };
+                        if (component->write) {
+                            component->write(out, column, count);
+                        } else {
+                            out.align();
+                            out.write(column, component->size * count);
+                        }
+                    }
+
+                    ++table_count;
+                    entity_count += static_cast<uint32_t>(count);
+                }
+            });
+
+            const EntitiesData header { .table_count = table_count, .entity_count = entity_count };
+            std::memcpy(out.bytes.data() + header_at, &header, sizeof(header));
+        }
+
+        // Unnamed entities are inserted a table at a time, named ones are created or updated one by one
+        void restore_table(const flecs::world &ecs, const flecs::entity prefab, const std::vector<const Component*> &present,
+                           const std::vector<Column> &columns, const std::vector<std::string> &names,
+                           const std::vector<InterpolationState> &states) {
+            const auto count { names.size() };
+
+            if (names.empty() || names[0].empty()) {
+                ecs_bulk_desc_t desc {};
+                desc.count = static_cast<int32_t>(count);
+
+                std::vector<void*> data;
+                size_t term { 0 };
+
+                if (prefab) {
+                    desc.ids[term++] = ecs_pair(EcsIsA, prefab.id());
+                    data.push_back(nullptr);
+                }
+
+                for (size_t c { 0 }; c < present.size(); ++c) {
+                    desc.ids[term++] = present[c]->id;
+                    data.push_back(const_cast<void*>(columns[c].data));
+                }
+
+                desc.ids[term] = ecs.id<InterpolationState>().raw_id();
+                data.push_back(const_cast<InterpolationState*>(states.data()));
+                desc.data = data.data();
+
+                ecs_bulk_init(ecs, &desc);
+                return;
+            }
+
+            for (size_t i { 0 }; i < count; ++i) {
+                auto entity { ecs.entity(names[i].c_str()) };
+                if (prefab) {
+                    entity.is_a(prefab);
+                }
+
+                for (size_t c { 0 }; c < present.size(); ++c) {
+                    const auto &component { *present[c] };
+                    if (component.size == 0) {
+                        ecs_add_id(ecs, entity, component.id);
+                    } else {
+                        ecs_set_id(ecs, entity, component.id, component.size, static_cast<const uint8_t*>(columns[c].data) + i * component.size);
+                    }
+                }
+
+                entity.set<InterpolationState>(states[i]);
+            }
+        }
+    }
+
+    auto capture(const flecs::world &ecs) -> std::vector<uint8_t> {
+        const auto start { Clock::now() };
+
+        Writer out;
+        out.value(Header { .magic = { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, .version = VERSION, .section_count = 3, .reserved = 0 });
+        out.align();
+
+        size_t section {};
+        begin_section(out, SectionType::Elevation, section);
+        out.value(ElevationData {
+            .side = terrain::elevation.size(),
+            .offset = terrain::elevation.offset,
+            .scale = terrain::elevation.scale,
+            .reserved = 0,
+        });
+        out.write(terrain::elevation.values(), terrain::elevation.count() * sizeof(uint16_t));
+        end_section(out, section);
+
+        begin_section(out, SectionType::Walkable, section);
+        out.value(WalkableData { .size = GRID_SIZE, .reserved = 0 });
+        std::vector<uint8_t> bits((terrain::walkable.size() + 7) / 8, 0);
+        for (size_t i { 0 }; i < terrain::walkable.size(); ++i) {
+            bits[i / 8] |= static_cast<uint8_t>(terrain::walkable[i]) << (i % 8);
+        }
+        out.write(bits.data(), bits.size());
+        end_section(out, section);
+
+        uint32_t table_count { 0 };
+        uint32_t entity_count { 0 };
+        begin_section(out, SectionType::Entities, section);
+        write_entities(ecs, out, table_count, entity_count);
+        end_section(out, section);
+
+        TraceLog(LOG_INFO, "SNAPSHOT: captured %u entities in %u tables, %.1f KB in %.2f ms", entity_count, table_count,
+            static_cast<double>(out.bytes.size()) / 1024.0, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        return std::move(out.bytes);
+    }
+
+    auto save(const flecs::world &ecs, const std::string &path) -> bool {
+        auto bytes { capture(ecs) };
+        return SaveFileData(path.c_str(), bytes.data(), static_cast<int>(bytes.size()));
+    }
+
+    auto load(const std::string &path) -> std::vector<uint8_t> {
+        if (!FileExists(path.c_str())) {
+            return {};
+        }
+
+        int size { 0 };
+        auto *data { LoadFileData(path.c_str(), &size) };
+        if (data == nullptr) {
+            return {};
+        }
+
+        std::vector<uint8_t> bytes(data, data + size);
+        UnloadFileData(data);
+
+        Reader in { bytes.data(), bytes.size() };
+        const auto header { in.value<Header>() };
+        if (!in.ok || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+            TraceLog(LOG_WARNING, "SNAPSHOT: %s is not a version %u snapshot", path.c_str(), VERSION);
+            return {};
+        }
+
+        return bytes;
+    }
+
+    auto restore_terrain(const std::vector<uint8_t> &snapshot) -> bool {
+        const auto start { Clock::now() };
+        auto elevation { find_section(snapshot, SectionType::Elevation) };
+        auto walkable { find_section(snapshot, SectionType::Walkable) };
+        if (!elevation || !walkable) {
+            return false;
+        }
+
+        const auto elevation_data { elevation->value<ElevationData>() };
+        const auto *heights { elevation->view(terrain::elevation.count() * sizeof(uint16_t)) };
+        const auto walkable_data { walkable->value<WalkableData>() };
+        const auto *bits { walkable->view((terrain::walkable.size() + 7) / 8) };
+
+        if (elevation_data.side != terrain::elevation.size() || walkable_data.size != GRID_SIZE || heights == nullptr || bits == nullptr) {
+            TraceLog(LOG_WARNING, "SNAPSHOT: terrain size doesn't match this build");
+            return false;
+        }
+
+        terrain::elevation.offset = elevation_data.offset;
+        terrain::elevation.scale = elevation_data.scale;
+        std::memcpy(terrain::elevation.values(), heights, terrain::elevation.count() * sizeof(uint16_t));
+        terrain::update_height_planes(0, 0, HEIGHT_CELLS, HEIGHT_CELLS);
+
+        for (size_t i { 0 }; i < terrain::walkable.size(); ++i) {
+            terrain::walkable[i] = (bits[i / 8] >> (i % 8)) & 1;
+        }
+        terrain::rebuild_clearance();
+        terrain::invalidate_collision_grid();
+
+        TraceLog(LOG_INFO, "SNAPSHOT: restored terrain in %.2f ms", std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        return true;
+    }
+
+    auto restore_entities(const flecs::world &ecs, const std::vector<uint8_t> &snapshot) -> bool {
+        const auto start { Clock::now() };
+        auto in { find_section(snapshot, SectionType::Entities) };
+        if (!in) {
+            return false;
+        }
+
+        struct Table {
+            flecs::entity prefab;
+            std::vector<const Component*> present;
+            std::vector<Column> columns;
+            std::vector<std::string> names;
+        };
+
+        // Everything is read and checked before the current entities are touched, so a corrupt
+        // snapshot leaves the world as it was
+        const auto components { registry(ecs) };
+        const auto header { in->value<EntitiesData>() };
+        std::vector<Table> tables;
+
+        // A table takes at least its header and the prefab name length
+        if (!in->fits(header.table_count, sizeof(TableData) + sizeof(uint32_t))) {
+            TraceLog(LOG_WARNING, "SNAPSHOT: %u entity tables don't fit in the section", header.table_count);
+            return false;
+        }
+
+        for (uint32_t t { 0 }; t < header.table_count; ++t) {
+            const auto data { in->value<TableData>() };
+            const auto prefab_name { in->string() };
+
+            // Names take at least their length, and a component is listed at most once
+            if (!in->fits(data.count, sizeof(uint32_t)) || data.component_count > components.size()) {
+                TraceLog(LOG_WARNING, "SNAPSHOT: entity table %u is truncated", t);
+                return false;
+            }
+
+            Table table {};
+            for (uint32_t c { 0 }; c < data.component_count; ++c) {
+                const auto name { in->string() };
+                const auto found { std::find_if(components.begin(), components.end(), [&](const Component &component) {
+                    return name == component.name;
+                })};
+
+                if (found == components.end() || std::find(table.present.begin(), table.present.end(), &*found) != table.present.end()) {
+                    TraceLog(LOG_WARNING, "SNAPSHOT: unknown or repeated component %s", name.c_str());
+                    return false;
+                }
+                table.present.push_back(&*found);
+            }
+
+            table.names.resize(data.count);
+            for (auto &name : table.names) {
+                name = in->string();
+            }
+
+            for (const auto *component : table.present) {
+                if (component->size == 0) {
+                    table.columns.push_back({});
+                } else if (component->read) {
+                    table.columns.push_back(component->read(*in, data.count));
+                } else {
+                    in->align();
+                    table.columns.push_back({ .owner = nullptr, .data = in->view(component->size * data.count) });
+                }
+            }
+
+            if (!in->ok || table.present.empty() || table.present[0]->id != ecs.id<WorldTransform>().raw_id()) {
+                TraceLog(LOG_WARNING, "SNAPSHOT: entity table %u is truncated", t);
+                return false;
+            }
+
+            table.prefab = prefab_name.empty() ? flecs::entity {} : ecs.lookup(prefab_name.c_str());
+            if (!prefab_name.empty() && !table.prefab) {
+                TraceLog(LOG_WARNING, "SNAPSHOT: prefab %s doesn't exist, skipping %u entities", prefab_name.c_str(), data.count);
+                continue;
+            }
+
+            tables.push_back(std::move(table));
+        }
+
+        std::vector<flecs::entity> replaced;
+        ecs.query_builder<>().with<WorldTransform>().build().each([&](const flecs::entity entity) {
+            if (ecs_get_name(ecs, entity) == nullptr) {
+                replaced.push_back(entity);
+            }
+        });
+
+        for (const auto entity : replaced) {
+            entity.destruct();
+        }
+
+        for (const auto &table : tables) {
+            const auto *transforms { static_cast<const WorldTransform*>(table.columns[0].data) };
+            std::vector<InterpolationState> states;
+            states.reserve(table.names.size());
+            for (size_t i { 0 }; i < table.names.size(); ++i) {
+                states.push_back(interpolation_systems::snapped(transforms[i]));
+            }
+
+            restore_table(ecs, table.prefab, table.present, table.columns, table.names, states);
+        }
+
+        TraceLog(LOG_INFO, "SNAPSHOT: restored %u entities in %u tables in %.2f ms", header.entity_count, header.table_count,
+            std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        return true;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <flecs.h>
+#include <string>
+#include <vector>
+
+// Binary session snapshot. Sections are 16 byte aligned, entity data is written one archetype
+// at a time with trivially copyable components stored as whole columns, which a restore hands
+// to the ECS straight from the loaded buffer.
+namespace snapshot {
+    constexpr char MAGIC[4] { 'B', 'X', 'S', 'N' };
+    constexpr uint32_t VERSION { 1 };
+    constexpr uint64_t ALIGNMENT { 16 };
+
+    enum class SectionType : uint32_t {
+        Elevation = 0,
+        Walkable = 1,
+        Entities = 2,
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t section_count;
+        uint32_t reserved;
+    };
+
+    // Payload follows the section header and is padded to ALIGNMENT
+    struct Section {
+        SectionType type;
+        uint32_t reserved;
+        uint64_t size;
+    };
+
+    // Followed by side * side quantized heights in the heightfield's tiled order
+    struct ElevationData {
+        int32_t side;
+        float offset;
+        float scale;
+        int32_t reserved;
+    };
+
+    // Followed by the grid packed 8 tiles per byte
+    struct WalkableData {
+        int32_t size;
+        int32_t reserved;
+    };
+
+    // Followed by table_count tables, each a TableData, the prefab name, the component names,
+    // the entity names and then one column per component
+    struct EntitiesData {
+        uint32_t table_count;
+        uint32_t entity_count;
+    };
+
+    struct TableData {
+        uint32_t count;
+        uint32_t component_count;
+    };
+
+    auto capture(const flecs::world &ecs) -> std::vector<uint8_t>;
+    auto save(const flecs::world &ecs, const std::string &path) -> bool;
+
+    // Empty when the file is missing or isn't a snapshot of this version
+    auto load(const std::string &path) -> std::vector<uint8_t>;
+
+    // Terrain has to be restored before the ground meshes are generated from it
+    auto restore_terrain(const std::vector<uint8_t> &snapshot) -> bool;
+
+    // Replaces every unnamed transformed entity, named ones are looked up and updated in place.
+    // Prefabs are matched by name and must exist.
+    auto restore_entities(const flecs::world &ecs, const std::vector<uint8_t> &snapshot) -> bool;
+}
@@ -0,0 +1,230 @@
+#include "spawner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+#include "world/systems/interpolation.h"
+#include "world/terrain/terrain.h"
+
+namespace spawner {
+    namespace {
+        constexpr int CANDIDATES { 16 };
+        constexpr int SEED_ATTEMPTS { 32 };
+        constexpr int TILE_CELLS { 32 };
+
+        using Clock = std::chrono::steady_clock;
+
+        // Background grid with at most one point per cell, cells are min_distance / sqrt(2) wide
+        struct Grid {
+            float origin;
+            float cell_size;
+            int size;
+            std::vector<Vector2> points;
+
+            auto cell(const float coord) const -> int {
+                return static_cast<int>(std::floor((coord - origin) / cell_size));
+            }
+
+            auto empty(const int x, const int z) const -> bool {
+                return std::isnan(points[z * size + x].x);
+            }
+
+            auto conflicts(const float x, const float z, const float min_distance) const -> bool {
+                const auto cx { cell(x) };
+                const auto cz { cell(z) };
+
+                for (auto nz { std::max(cz - 2, 0) }; nz <= std::min(cz + 2, size - 1); ++nz) {
+                    for (auto nx { std::max(cx - 2, 0) }; nx <= std::min(cx + 2, size - 1); ++nx) {
+                        if (empty(nx, nz)) {
+                            continue;
+                        }
+
+                        const auto &point { points[nz * size + nx] };
+                        const auto dx { point.x - x };
+                        const auto dz { point.y - z };
+                        if (dx * dx + dz * dz < min_distance * min_distance) {
+                            return true;
+                        }
+                    }
+                }
+
+                return false;
+            }
+        };
+
+        // Runs Bridson's algorithm inside one tile, growing from random seeds until none take
+        void sample_tile(Grid &grid, const PlacementRules &rules, const int tile_x, const int tile_z, const uint32_t seed, std::vector<Vector3> &out) {
+            const auto min_slope_y { std::cos(rules.max_slope * DEG2RAD) };
+            const auto cx0 { tile_x * TILE_CELLS };
+            const auto cz0 { tile_z * TILE_CELLS };
+            const auto cx1 { std::min(cx0 + TILE_CELLS, grid.size) };
+            const auto cz1 { std::min(cz0 + TILE_CELLS, grid.size) };
+            const auto x0 { grid.origin + static_cast<float>(cx0) * grid.cell_size };
+            const auto z0 { grid.origin + static_cast<float>(cz0) * grid.cell_size };
+            const auto x1 { grid.origin + static_cast<float>(cx1) * grid.cell_size };
+            const auto z1 { grid.origin + static_cast<float>(cz1) * grid.cell_size };
+
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution unit(0.0f, 1.0f);
+
+            float xs[SEED_ATTEMPTS];
+            float zs[SEED_ATTEMPTS];
+            float heights[SEED_ATTEMPTS];
+            Vector3 normals[SEED_ATTEMPTS];
+            std::vector<Vector2> active;
+
+            // Masks are evaluated for a whole batch of candidates, accepted points land in the grid immediately
+            const auto accept { [&](const int count) {
+                terrain::get_heights_normals(xs, zs, heights, normals, count);
+                auto accepted { false };
+
+                for (auto i { 0 }; i < count; ++i) {
+                    // Bounds are tested on cells so a point never lands in a cell owned by another tile
+                    const auto cx { grid.cell(xs[i]) };
+                    const auto cz { grid.cell(zs[i]) };
+
+                    if (cx < cx0 || cx >= cx1 || cz < cz0 || cz >= cz1 ||
+                        heights[i] < rules.min_height || heights[i] > rules.max_height || normals[i].y < min_slope_y ||
+                        grid.conflicts(xs[i], zs[i], rules.min_distance)) {
+                        continue;
+                    }
+
+                    grid.points[cz * grid.size + cx] = { xs[i], zs[i] };
+                    active.push_back({ xs[i], zs[i] });
+                    out.push_back({ xs[i], heights[i], zs[i] });
+                    accepted = true;
+                }
+
+                return accepted;
+            }};
+
+            while (true) {
+                for (auto i { 0 }; i < SEED_ATTEMPTS; ++i) {
+                    xs[i] = x0 + unit(rng) * (x1 - x0);
+                    zs[i] = z0 + unit(rng) * (z1 - z0);
+                }
+
+                if (!accept(SEED_ATTEMPTS)) {
+                    return;
+                }
+
+                while (!active.empty()) {
+                    const auto index { static_cast<size_t>(unit(rng) * static_cast<float>(active.size())) % active.size() };
+                    const auto center { active[index] };
+
+                    for (auto i { 0 }; i < CANDIDATES; ++i) {
+                        const auto angle { unit(rng) * 2.0f * PI };
+                        const auto radius { rules.min_distance * (1.0f + unit(rng)) };
+                        xs[i] = center.x + std::cos(angle) * radius;
+                        zs[i] = center.y + std::sin(angle) * radius;
+                    }
+
+                    if (!accept(CANDIDATES)) {
+                        active[index] = active.back();
+                        active.pop_back();
+                    }
+                }
+            }
+        }
+    }
+
+    auto poisson_disk(const PlacementRules &rules, const uint32_t seed, const size_t max_count) -> std::vector<Vector3> {
+        const auto start { Clock::now() };
+        const auto extent { static_cast<float>(HEIGHT_CELLS) / static_cast<float>(DETAIL) };
+
+        Grid grid {
+            .origin = -WORLD_CENTER,
+            .cell_size = rules.min_distance / std::sqrt(2.0f),
+            .size = 0,
+            .points = {},
+        };
+        grid.size = static_cast<int>(std::ceil(extent / grid.cell_size));
+        grid.points.assign(static_cast<size_t>(grid.size) * grid.size, { std::numeric_limits<float>::quiet_NaN(), 0.0f });
+
+        const auto tiles { (grid.size + TILE_CELLS - 1) / TILE_CELLS };
+        std::vector<std::vector<Vector3>> tile_points(static_cast<size_t>(tiles) * tiles);
+        const auto thread_count { std::max(1u, std::thread::hardware_concurrency()) };
+
+        // Tiles of one phase are never adjacent, and a conflict check only reaches the adjacent tiles
+        for (auto phase { 0 }; phase < 4; ++phase) {
+            std::vector<int> phase_tiles;
+            for (auto tz { phase / 2 }; tz < tiles; tz += 2) {
+                for (auto tx { phase % 2 }; tx < tiles; tx += 2) {
+                    phase_tiles.push_back(tz * tiles + tx);
+                }
+            }
+
+            std::atomic<size_t> next { 0 };
+            const auto worker { [&] {
+                for (auto i { next++ }; i < phase_tiles.size(); i = next++) {
+                    const auto tile { phase_tiles[i] };
+                    sample_tile(grid, rules, tile % tiles, tile / tiles, seed ^ (static_cast<uint32_t>(tile) * 0x9E3779B9u), tile_points[tile]);
+                }
+            }};
+
+            std::vector<std::thread> threads;
+            for (auto i { 1u }; i < std::min<unsigned>(thread_count, static_cast<unsigned>(phase_tiles.size())); ++i) {
+                threads.emplace_back(worker);
+            }
+            worker();
+
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+
+        std::vector<Vector3> points;
+        for (const auto &tile : tile_points) {
+            points.insert(points.end(), tile.begin(), tile.end());
+        }
+
+        std::shuffle(points.begin(), points.end(), std::mt19937(seed));
+        if (points.size() > max_count) {
+            points.resize(max_count);
+        }
+
+        TraceLog(LOG_INFO, "SPAWNER: %zu points at %.2f spacing in %.2f ms (%u threads)", points.size(), rules.min_distance,
+            std::chrono::duration<double, std::milli>(Clock::now() - start).count(), thread_count);
+
+        return points;
+    }
+
+    BulkSpawn::BulkSpawn(const flecs::world &ecs, const flecs::entity prefab, const std::vector<WorldTransform> &transforms)
+        : ecs(ecs), prefab(prefab), count(transforms.size()) {
+        states.reserve(count);
+        for (const auto &transform : transforms) {
+            states.push_back(interpolation_systems::snapped(transform));
+        }
+
+        with(transforms);
+        with(states);
+    }
+
+    void BulkSpawn::spawn() {
+        if (count == 0) {
+            return;
+        }
+
+        const auto start { Clock::now() };
+
+        ecs_bulk_desc_t desc {};
+        desc.count = static_cast<int32_t>(count);
+        desc.ids[0] = ecs_pair(EcsIsA, prefab.id());
+
+        std::vector<void*> desc_data { nullptr };
+        for (size_t i { 0 }; i < ids.size(); ++i) {
+            desc.ids[i + 1] = ids[i];
+            desc_data.push_back(data[i]);
+        }
+        desc.data = desc_data.data();
+
+        ecs_bulk_init(ecs, &desc);
+
+        TraceLog(LOG_INFO, "SPAWNER: %zu x %s in %.2f ms", count, prefab.name().c_str(),
+            std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+}
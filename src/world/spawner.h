@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <flecs.h>
+#include <raylib.h>
+#include <vector>
+#include "world/components/interpolation.h"
+#include "world/components/render.h"
+
+namespace spawner {
+    // Where objects may be placed, points closer than min_distance are rejected
+    struct PlacementRules {
+        float min_distance { 1.0f };
+        float min_height { 0.0f };
+        float max_height { 1e6f };
+        float max_slope { 90.0f }; // Degrees from horizontal
+    };
+
+    // Poisson disk samples over the terrain passing the height and slope masks, in random order.
+    // Tiles are filled in four phases so tiles sampled in parallel never share a neighbourhood.
+    auto poisson_disk(const PlacementRules &rules, uint32_t seed, size_t max_count = SIZE_MAX) -> std::vector<Vector3>;
+
+    // Creates instances of a prefab in a single table operation, per instance components are
+    // copied from the arrays passed to with(), which must outlive spawn()
+    class BulkSpawn {
+        public:
+            BulkSpawn(const flecs::world &ecs, flecs::entity prefab, const std::vector<WorldTransform> &transforms);
+
+            template <typename T>
+            auto with(const std::vector<T> &values) -> BulkSpawn& {
+                ids.push_back(ecs.id<T>().raw_id());
+                data.push_back(const_cast<T*>(values.data()));
+                return *this;
+            }
+
+            template <typename T>
+            auto with() -> BulkSpawn& {
+                ids.push_back(ecs.id<T>().raw_id());
+                data.push_back(nullptr);
+                return *this;
+            }
+
+            void spawn();
+
+        private:
+            flecs::world ecs;
+            flecs::entity prefab;
+            size_t count;
+            std::vector<InterpolationState> states;
+            std::vector<ecs_id_t> ids;
+            std::vector<void*> data;
+    };
+}
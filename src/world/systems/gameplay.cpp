@@ -1,85 +1,198 @@
 #include <flecs.h>
 #include <raylib.h>
 #include <raymath.h>
+#include "world/avoidance.h"
 #include "world/components/gameplay.h"
+#include "world/components/lod.h"
 #include "world/components/render.h"
 #include "world/components/particle.h"
 #include "world/world.h"
+#include "world/systems/streaming.h"
+#include "world/transforms.h"
 #include "world/terrain/terrain.h"
 
+#include <algorithm>
+#include <vector>
+
 constexpr auto max_turn { 7.5f };
+constexpr auto min_speed { 1e-4f };
 
 namespace gameplay_systems {
+    namespace {
+        // Reused between ticks so a steady crowd doesn't allocate
+        avoidance::Solver solver;
+        avoidance::Agents agents;
+        std::vector<Vector2> velocities;
+        std::vector<Steering*> avoiding;
+
+        // Avoidance knows nothing of the path grid, an agent pushed towards tiles it does not fit
+        // on slides along the free axis or stops. Agents already off the grid may move freely.
+        auto clamp_to_grid(const Vector2 position, const Vector2 velocity, const float radius) -> Vector2 {
+            const auto fits { [radius](const Vector2 p) { return terrain::can_stand({ p.x, 0.0f, p.y }, radius); } };
+
+            if (fits(Vector2Add(position, velocity)) || !fits(position)) {
+                return velocity;
+            }
+            if (fits({ position.x + velocity.x, position.y })) {
+                return { velocity.x, 0.0f };
+            }
+            if (fits({ position.x, position.y + velocity.y })) {
+                return { 0.0f, velocity.y };
+            }
+            return {};
+        }
+    }
+
     void register_systems(const World &world) {
         // Sets the MoveTo component to where the player clicks
         const auto move_target_system { [](flecs::iter &iter) {
-            const auto should_move { IsMouseButtonDown(MOUSE_LEFT_BUTTON) };
-            const auto *cam { should_move ? iter.world().get_mut<WorldCamera>() : nullptr };
+            const auto *pointer { iter.world().get<PointerInput>() };
+            const auto should_move { pointer != nullptr && pointer->down };
+            const auto *cam { should_move ? iter.world().get<WorldCamera>() : nullptr };
 
             while (iter.next()) {
                 if (!should_move || !cam) continue;
 
                 auto move_to { iter.field<MoveTo>(0) };
-                const auto ray { GetMouseRay(GetMousePosition(), cam->camera) };
 
-                if (const auto hit { terrain::ray_ground_intersect(ray.position, ray.direction) }) {
+                // Agents path around gaps narrower than they are
+                const auto has_agent { iter.is_set(1) };
+
+                if (const auto hit { terrain::ray_ground_intersect(pointer->ray.position, pointer->ray.direction) }) {
                     for (const auto i : iter) {
                         move_to[i].path.clear();
                         move_to[i].waypoint = 0;
-                        terrain::find_path(cam->camera.target, *hit, move_to[i].path);
+                        terrain::find_path(cam->camera.target, *hit, move_to[i].path, has_agent ? iter.field<const Agent>(1)[i].radius : 0.0f);
                     }
                 }
             }
         }};
 
-        // Moves an animated entity with a transform towards MoveTo
-        const auto move_to_system { [](const MoveTo &move_to, WorldTransform &transform, Animation &animation) {
+        // Asks to move an animated entity with a transform towards MoveTo, the steering step moves it
+        const auto move_to_system { [](const MoveTo &move_to, const WorldTransform &transform, Steering &steering, Animation &animation) {
+            steering.preferred = { 0.0f, 0.0f };
+            steering.max_speed = move_to.speed;
+
             if (move_to.path.empty() || move_to.waypoint >= move_to.path.size()) {
-                animation.name = "Idle";
+                play(animation, "Idle");
                 return;
             }
 
             auto target { move_to.path[move_to.waypoint] };
-            auto direction { Vector3Subtract(target, transform.pos) };
+            auto direction { Vector2 { target.x - transform.pos.x, target.z - transform.pos.z } };
 
-            if (Vector2Length({direction.x, direction.z}) < 0.5f) {
+            if (Vector2Length(direction) < 0.5f) {
                 const_cast<MoveTo&>(move_to).waypoint++;
                 if (move_to.waypoint >= move_to.path.size()) {
-                    animation.name = "Idle";
+                    play(animation, "Idle");
                     return;
                 }
                 target = move_to.path[move_to.waypoint];
-                direction = Vector3Subtract(target, transform.pos);
+                direction = { target.x - transform.pos.x, target.z - transform.pos.z };
             }
 
-            const Vector3 forward { Vector3Normalize(direction) };
-            transform.pos = Vector3Add(transform.pos, Vector3Scale(forward, move_to.speed));
+            steering.preferred = Vector2Scale(Vector2Normalize(direction), move_to.speed);
+            play(animation, "Run");
+        }};
+
+        // Adjusts the preferred velocities of agents so they don't run into each other, anything
+        // without an Agent simply takes its preferred velocity
+        const auto avoid_system { [](flecs::iter &iter) {
+            avoiding.clear();
+            agents.clear();
+
+            while (iter.next()) {
+                auto steering { iter.field<Steering>(0) };
+
+                if (!iter.is_set(2)) {
+                    for (const auto i : iter) {
+                        steering[i].velocity = steering[i].preferred;
+                    }
+                    continue;
+                }
+
+                const auto transform { iter.field<const WorldTransform>(1) };
+                const auto agent { iter.field<const Agent>(2) };
+
+                for (const auto i : iter) {
+                    avoiding.push_back(&steering[i]);
+                    agents.push({ transform[i].pos.x, transform[i].pos.z }, steering[i].velocity, steering[i].preferred,
+                        agent[i].radius, steering[i].max_speed);
+                }
+            }
+
+            solver.solve(agents, {}, velocities);
+            for (size_t i { 0 }; i < avoiding.size(); ++i) {
+                avoiding[i]->velocity = clamp_to_grid(agents.positions[i], velocities[i], agents.radii[i]);
+            }
+        }};
+
+        // Moves an entity by its steering velocity and turns it towards where it is going
+        const auto steer_system { [](const Steering &steering, WorldTransform &transform) {
+            if (Vector2Length(steering.velocity) < min_speed) {
+                return;
+            }
+
+            transform.pos.x += steering.velocity.x;
+            transform.pos.z += steering.velocity.y;
 
             // Smooth turning
-            const auto target_angle { atan2f(forward.x, forward.z) * (180.0f / PI) };
-            auto angle_diff { target_angle - transform.rot.y };
+            const auto target_angle { atan2f(steering.velocity.x, steering.velocity.y) * (180.0f / PI) };
+            const auto current_angle { transforms::yaw(transform.rot) };
+            auto angle_diff { target_angle - current_angle };
             while (angle_diff > 180.0f) angle_diff -= 360.0f;
             while (angle_diff < -180.0f) angle_diff += 360.0f;
 
             if (fabsf(angle_diff) <= max_turn) {
-                transform.rot.y = target_angle;
+                transform.rot = transforms::from_yaw(target_angle);
             } else {
-                transform.rot.y += (angle_diff > 0) ? max_turn : -max_turn;
+                transform.rot = transforms::from_yaw(current_angle + ((angle_diff > 0) ? max_turn : -max_turn));
             }
 
-            animation.name = "Run";
             transform.pos.y = terrain::get_height(transform.pos.x, transform.pos.z);
         }};
 
         // Make an entity spin
-        const auto spin_system { [](const Spin &spin, WorldTransform &transform) {
-            transform.rot.y += spin.speed;
+        const auto spin_system { [](const Spin &spin, const SimLod &lod, WorldTransform &transform) {
+            if (!lod.due) {
+                return;
+            }
+            transform.rot = QuaternionNormalize(QuaternionMultiply(transforms::from_yaw(spin.speed * lod.steps), transform.rot));
         }};
 
-        // Makes an entity bounce
-        const auto bounce_system { [](Bounce &bounce, WorldTransform &transform) {
-            transform.pos.y = terrain::get_height(transform.pos.x, transform.pos.z) + bounce.center_y + sinf(bounce.elapsed) * bounce.height;
-            bounce.elapsed += bounce.speed;
+        // Makes an entity bounce, ground heights are sampled in batches of the entities due this tick
+        const auto bounce_system { [](flecs::iter &iter) {
+            float xs[HEIGHT_BATCH];
+            float zs[HEIGHT_BATCH];
+            float heights[HEIGHT_BATCH];
+            size_t due[HEIGHT_BATCH];
+
+            while (iter.next()) {
+                auto bounce { iter.field<Bounce>(0) };
+                const auto lod { iter.field<const SimLod>(1) };
+                auto transform { iter.field<WorldTransform>(2) };
+
+                for (size_t start { 0 }; start < iter.count();) {
+                    size_t count { 0 };
+                    for (; start < iter.count() && count < HEIGHT_BATCH; ++start) {
+                        if (lod[start].due) {
+                            due[count] = start;
+                            xs[count] = transform[start].pos.x;
+                            zs[count] = transform[start].pos.z;
+                            ++count;
+                        }
+                    }
+
+                    terrain::get_heights(xs, zs, heights, count);
+
+                    for (size_t i { 0 }; i < count; ++i) {
+                        auto &b { bounce[due[i]] };
+                        b.elapsed += b.speed * (lod[due[i]].steps - 1);
+                        transform[due[i]].pos.y = heights[i] + b.center_y + sinf(b.elapsed) * b.height;
+                        b.elapsed += b.speed;
+                    }
+                }
+            }
         }};
 
         const auto eat_system { [&ecs = world.ecs](const Consumer &consumer, const WorldTransform &transform, Animation &animation) {
@@ -95,11 +208,10 @@ namespace gameplay_systems {
                         .set<WorldTransform>(consumable_transform)
                         .set<Explosion>({
                             .particles { consumable.particles },
-                            .colors { consumable.colors },
+                            .palette { consumable.palette },
                         });
 
-                    animation.run_once = "Eat";
-                    animation.frame_time = 0.0f;
+                    play_once(animation, "Eat");
                 }
             });
         }};
@@ -114,25 +226,35 @@ namespace gameplay_systems {
             }
 
             if (has_changed) {
-                terrain::update_collision_entities(world.ecs);
+                terrain::update_collision_entities(world.ecs, streaming_systems::dormant_colliders());
             }
         }};
 
-        world.ecs.system<MoveTo>("move_target")
+        world.ecs.system<MoveTo, const Agent*>("move_target")
             .kind(world.fixed_phase)
             .run(move_target_system);
 
-        world.ecs.system<MoveTo, WorldTransform, Animation>("move_to")
+        world.ecs.component<MoveTo>().add(flecs::With, world.ecs.component<Steering>());
+
+        world.ecs.system<MoveTo, WorldTransform, Steering, Animation>("move_to")
             .kind(world.fixed_phase)
             .each(move_to_system);
 
-        world.ecs.system<Spin, WorldTransform>("spin")
+        world.ecs.system<Steering, WorldTransform, const Agent*>("avoid")
+            .kind(world.fixed_phase)
+            .run(avoid_system);
+
+        world.ecs.system<Steering, WorldTransform>("steer")
+            .kind(world.fixed_phase)
+            .each(steer_system);
+
+        world.ecs.system<Spin, SimLod, WorldTransform>("spin")
             .kind(world.fixed_phase)
             .each(spin_system);
 
-        world.ecs.system<Bounce, WorldTransform>("bounce")
+        world.ecs.system<Bounce, SimLod, WorldTransform>("bounce")
             .kind(world.fixed_phase)
-            .each(bounce_system);
+            .run(bounce_system);
 
         world.ecs.system<Consumer, WorldTransform, Animation>("eat")
             .kind(world.fixed_phase)
@@ -1,15 +1,43 @@
-#include "world/components/interpolation.h"
+#include "interpolation.h"
 
 #include "raymath.h"
 #include "world/world.h"
 #include "world/components/render.h"
 
 namespace interpolation_systems {
+    // True when the transform didn't change during the last fixed step
+    bool at_rest(const InterpolationState &state, const WorldTransform &transform) {
+        return state.prev_pos.x == transform.pos.x && state.prev_pos.y == transform.pos.y && state.prev_pos.z == transform.pos.z &&
+            state.prev_rot.x == transform.rot.x && state.prev_rot.y == transform.rot.y &&
+            state.prev_rot.z == transform.rot.z && state.prev_rot.w == transform.rot.w &&
+            state.prev_scale == transform.scale;
+    }
+
+    auto snapped(const WorldTransform &transform) -> InterpolationState {
+        return {
+            .prev_pos = transform.pos,
+            .render_pos = transform.pos,
+            .prev_rot = transform.rot,
+            .render_rot = transform.rot,
+            .render_scale = transform.scale,
+            .prev_scale = transform.scale,
+            .render_index = -1,
+            .settled = true,
+        };
+    }
 
     void register_systems(const World &world) {
+        // Every transformed entity gets an interpolation state, sized once instead of ensured every tick
+        world.ecs.component<WorldTransform>().add(flecs::With, world.ecs.component<InterpolationState>());
+        world.ecs.set<RenderTransforms>({});
+
+        // Spawning or teleporting snaps the render state to the new transform
+        const auto init_render_state { [](const WorldTransform &transform, InterpolationState &state) {
+            state = snapped(transform);
+        }};
+
         // Stores previous transform values for interpolation
-        const auto store_previous { [](const flecs::entity entity, const WorldTransform &transform) {
-            auto& state { entity.ensure<InterpolationState>() };
+        const auto store_previous { [](const WorldTransform &transform, InterpolationState &state) {
             state.prev_pos = transform.pos;
             state.prev_rot = transform.rot;
             state.prev_scale = transform.scale;
@@ -17,22 +45,54 @@ namespace interpolation_systems {
 
         // Sets the interpolated value between game loop steps for rendering
         const auto set_render_state { [](const flecs::iter &iter, size_t, const WorldTransform &transform, InterpolationState &state) {
+            // Entities that didn't move this tick keep the state computed when they came to rest
+            if (state.settled && at_rest(state, transform)) {
+                return;
+            }
+
             const float alpha { iter.delta_time() };
 
             state.render_pos = Vector3Lerp(state.prev_pos, transform.pos, alpha);
             state.render_scale = Lerp(state.prev_scale, transform.scale, alpha);
-            state.render_rot = QuaternionSlerp(
-                QuaternionFromEuler( state.prev_rot.x * DEG2RAD, state.prev_rot.y * DEG2RAD, state.prev_rot.z* DEG2RAD),
-                QuaternionFromEuler(transform.rot.x * DEG2RAD, transform.rot.y * DEG2RAD, transform.rot.z* DEG2RAD),
-                alpha);
+            state.render_rot = QuaternionSlerp(state.prev_rot, transform.rot, alpha);
+            state.settled = at_rest(state, transform);
         }};
 
-        world.ecs.system<WorldTransform>("store_previous")
+        // Gathers the render state of every entity and builds all world matrices in one pass
+        const auto pack_render_transforms { [](flecs::iter &iter) {
+            auto *render { iter.world().get_mut<RenderTransforms>() };
+            render->batch.clear();
+
+            while (iter.next()) {
+                auto state { iter.field<InterpolationState>(0) };
+
+                for (const auto i : iter) {
+                    state[i].render_index = static_cast<int>(render->batch.size());
+                    render->batch.push(state[i].render_pos, state[i].render_rot, state[i].render_scale);
+                }
+            }
+
+            render->matrices.resize(render->batch.size());
+            transforms::build_matrices(render->batch, render->matrices.data());
+        }};
+
+        world.ecs.observer<const WorldTransform, InterpolationState>("init_render_state")
+            .event(flecs::OnSet)
+            .term_at(1).filter()
+            .each(init_render_state);
+
+        world.ecs.system<const WorldTransform, InterpolationState>("store_previous")
             .kind(world.pre_fixed_phase)
+            .without<Static>()
             .each(store_previous);
 
-        world.ecs.system<WorldTransform, InterpolationState>("set_render_state")
+        world.ecs.system<const WorldTransform, InterpolationState>("set_render_state")
             .kind(world.pre_render_phase)
+            .without<Static>()
             .each(set_render_state);
+
+        world.ecs.system<InterpolationState>("pack_render_transforms")
+            .kind(world.pre_render_phase)
+            .run(pack_render_transforms);
     }
-}
\ No newline at end of file
+}
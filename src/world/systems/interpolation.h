@@ -1,6 +1,11 @@
 #pragma once
 #include "world/world.h"
+#include "world/components/interpolation.h"
+#include "world/components/render.h"
 
 namespace interpolation_systems {
+    // Render state of an entity resting at the transform, used when spawning or teleporting
+    auto snapped(const WorldTransform &transform) -> InterpolationState;
+
     void register_systems(const World &world);
 }
\ No newline at end of file
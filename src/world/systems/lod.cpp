@@ -0,0 +1,86 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <raymath.h>
+#include "world/culling.h"
+#include "world/components/gameplay.h"
+#include "world/components/particle.h"
+#include "world/components/render.h"
+
+namespace lod_systems {
+    namespace {
+        auto interval_for(const SimLodConfig &config, const culling::Frustum &frustum, const Vector3 &target, const Vector3 &pos) -> uint8_t {
+            if (!culling::is_sphere_visible(frustum, pos, 1.0f)) {
+                return config.hidden_interval;
+            }
+
+            const auto distance { Vector2Distance({ pos.x, pos.z }, { target.x, target.z }) };
+            if (distance <= config.near) {
+                return 1;
+            }
+            return distance <= config.far ? config.mid_interval : config.far_interval;
+        }
+    }
+
+    void register_systems(const World &world) {
+        world.ecs.set<SimLodConfig>({});
+        world.ecs.set<SimLodStats>({});
+
+        // Everything these fixed systems update can fall back to a reduced rate
+        world.ecs.component<Spin>().add(flecs::With, world.ecs.component<SimLod>());
+        world.ecs.component<Bounce>().add(flecs::With, world.ecs.component<SimLod>());
+        world.ecs.component<Animation>().add(flecs::With, world.ecs.component<SimLod>());
+        world.ecs.component<Particle>().add(flecs::With, world.ecs.component<SimLod>());
+
+        // Counts down every entity to its next update. Intervals are only picked again on due ticks,
+        // and a new interval starts at an offset taken from the entity id, so entities at the same
+        // rate are spread round-robin over the ticks instead of all updating on the same one.
+        const auto schedule { [](flecs::iter &iter) {
+            const auto *cam { iter.world().get<WorldCamera>() };
+            const auto *config { iter.world().get<SimLodConfig>() };
+            auto *stats { iter.world().get_mut<SimLodStats>() };
+            const auto frustum { cam != nullptr ? culling::camera_frustum(cam->camera, config->view_aspect) : culling::Frustum {} };
+
+            *stats = {};
+
+            while (iter.next()) {
+                // Without a camera there is nothing to be far from, entities stay due every tick
+                if (cam == nullptr) continue;
+
+                auto lod { iter.field<SimLod>(0) };
+                const auto transform { iter.field<const WorldTransform>(1) };
+                const auto follow { iter.is_set(2) };
+
+                for (const auto i : iter) {
+                    auto &l { lod[i] };
+                    ++l.pending;
+                    l.due = --l.countdown == 0;
+
+                    if (l.due) {
+                        l.steps = l.pending;
+                        l.pending = 0;
+
+                        const auto interval { follow ? uint8_t { 1 } : interval_for(*config, frustum, cam->camera.target, transform[i].pos) };
+                        if (interval != l.interval) {
+                            l.interval = interval;
+                            l.countdown = static_cast<uint8_t>(1 + iter.entity(i).id() % interval);
+                        } else {
+                            l.countdown = interval;
+                        }
+
+                        ++stats->due;
+                    }
+
+                    stats->full_rate += l.interval == 1;
+                }
+
+                stats->entities += static_cast<int>(iter.count());
+            }
+        }};
+
+        world.ecs.system<SimLod, WorldTransform>("schedule_sim_lod")
+            .with<CameraFollow>().optional()
+            .kind(world.pre_fixed_phase)
+            .run(schedule);
+    }
+}
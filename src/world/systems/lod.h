@@ -0,0 +1,7 @@
+#pragma once
+#include "world/world.h"
+#include "world/components/lod.h"
+
+namespace lod_systems {
+    void register_systems(const World &world);
+}
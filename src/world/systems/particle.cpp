@@ -1,10 +1,13 @@
+#include "world/components/lod.h"
 #include "world/components/particle.h"
 #include "world/components/render.h"
 #include "particle.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "world/world.h"
+#include "world/quality.h"
 
 #include <iostream>
 
@@ -13,22 +16,31 @@
 
 namespace particle_systems {
     void register_systems(const World &world) {
-        const auto particle_system { [&ecs = world.ecs](const flecs::entity entity, Particle &particle, WorldTransform &transform) {
-            particle.lifetime -= FIXED_DT;
+        const auto particle_system { [&ecs = world.ecs](const flecs::entity entity, Particle &particle, const SimLod &lod, WorldTransform &transform) {
+            if (!lod.due) {
+                return;
+            }
+
+            const auto dt { FIXED_DT * lod.steps };
+            particle.lifetime -= dt;
 
             if (particle.lifetime < 0.0) {
                 ecs.defer([&]() {
                     entity.destruct();
                 });
             } else {
-                particle.velocity.y -= 9.8f * FIXED_DT;
-                transform.pos = Vector3Add(transform.pos, particle.velocity * FIXED_DT);
-                transform.rot = Vector3Add(transform.rot, particle.rot_velocity * FIXED_DT);
+                particle.velocity.y -= 9.8f * dt;
+                transform.pos = Vector3Add(transform.pos, particle.velocity * dt);
+                const auto spin { Vector3Scale(particle.rot_velocity, dt * DEG2RAD) };
+                transform.rot = QuaternionNormalize(QuaternionMultiply(QuaternionFromEuler(spin.x, spin.y, spin.z), transform.rot));
             }
         }};
 
         const auto explosion_system { [&ecs = world.ecs](const flecs::entity entity, const Explosion &explosion, const WorldTransform &transform) {
-            for (int i { 0 }; i < explosion.particles; ++i) {
+            const auto *palette { assets::get(explosion.palette) };
+
+            const auto particles { std::min(explosion.particles, quality::current().particle_budget) };
+            for (int i { 0 }; i < particles; ++i) {
 
                 const auto theta { util::GetRandomFloat(0.0f, 360.0f) * DEG2RAD };
                 const auto phi { util::GetRandomFloat(0.0f, 180.0f) * DEG2RAD };
@@ -41,7 +53,9 @@ namespace particle_systems {
                     .set<Particle>({
                         .lifetime { util::GetRandomFloat(0.5f, 1.0f) },
                         .variation { util::GetRandomFloat(-5.0f, 5.0f) },
-                        .color { explosion.colors[util::GetRandomInt(0, static_cast<int>(explosion.colors.size()) - 1)] },
+                        .color { palette != nullptr && !palette->empty()
+                            ? (*palette)[util::GetRandomInt(0, static_cast<int>(palette->size()) - 1)]
+                            : WHITE },
                         .velocity { (Vector3){
                             std::cosf(theta) * sinf(phi) * speed,
                             std::cosf(phi) * speed + 3.0f,
@@ -60,7 +74,7 @@ namespace particle_systems {
             });
         }};
 
-        world.ecs.system<Particle, WorldTransform>("particle_system")
+        world.ecs.system<Particle, SimLod, WorldTransform>("particle_system")
             .kind(world.fixed_phase)
             .each(particle_system);
 
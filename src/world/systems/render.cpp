@@ -5,11 +5,22 @@
 #include "world/components/render.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <map>
 
-#include "rlgl.h"
+#include "assets/assets.h"
+#include "memory/memory.h"
 #include "world/world.h"
+#include "world/culling.h"
+#include "world/graphics.h"
+#include "world/quality.h"
+#include "world/render_queue.h"
+#include "world/uniforms.h"
+#include "world/systems/render.h"
 #include "world/components/interpolation.h"
+#include "world/components/lod.h"
 #include "world/components/particle.h"
 #include "world/terrain/terrain.h"
 
@@ -18,13 +29,386 @@ constexpr float animation_speed { 240.0f };
 constexpr Vector3 light_dir { -0.5f, -1.0f, -0.5f };
 constexpr Vector3 light_color { 0.4f, 0.4f, 0.4f };
 
+// Animation sampling LOD, distant models are re-skinned every n:th frame
+struct AnimationLod {
+    float distance;
+    int interval;
+};
+
+constexpr AnimationLod animation_lods[] {
+    { 12.0f, 1 },
+    { 24.0f, 2 },
+    { 48.0f, 4 },
+};
+constexpr int animation_far_interval { 8 };
+constexpr int animation_offscreen_interval { 16 };
+bool animation_lod { true };
+
+// Entity whose pose is currently skinned into each shared set of meshes
+std::map<const Mesh*, flecs::entity_t> skinned_by;
+
 struct Shadow {
     Vector3 position;
     float radius;
     float intensity;
 };
 
+constexpr int MAX_SHADOWS { 64 };
+
+// Shadow uniforms of the ground shader, gathered before the ground is queued
+struct GroundShadows {
+    int count { 0 };
+    Vector3 positions[MAX_SHADOWS] {};
+    float radii[MAX_SHADOWS] {};
+    float intensities[MAX_SHADOWS] {};
+};
+
+// What a submit needs next to the queue, only the kinds that were queued have to be set
+struct FrameTargets {
+    const ModelShader *model_shader { nullptr };
+    const GroundShader *ground_shader { nullptr };
+    const WaterShader *water_shader { nullptr };
+    const WorldGround *ground { nullptr };
+    const WorldWater *water { nullptr };
+    float water_time {};
+    Vector3 view_pos {};
+    GroundShadows shadows {};
+};
+
+// Frame built up by the render systems and replayed by submit_render
+render_queue::Queue frame_queue;
+FrameTargets frame_targets;
+TerrainDraw terrain_draw;
+render_queue::Stats queue_stats;
+
 namespace render_systems {
+    // Number of frames between pose samples for a model at the given position
+    int animation_interval(const Camera &camera, const Vector3 &position) {
+        if (!animation_lod) {
+            return 1;
+        }
+
+        const auto scale { quality::current().animation_interval };
+        const auto forward { Vector3Normalize(Vector3Subtract(camera.target, camera.position)) };
+        const auto to_model { Vector3Subtract(position, camera.position) };
+
+        if (Vector3DotProduct(forward, to_model) < 0.0f) {
+            return animation_offscreen_interval * scale;
+        }
+
+        const auto screen { GetWorldToScreen(position, camera) };
+        constexpr auto margin { 64.0f };
+        if (screen.x < -margin || screen.y < -margin ||
+            screen.x > static_cast<float>(GetScreenWidth()) + margin ||
+            screen.y > static_cast<float>(GetScreenHeight()) + margin) {
+            return animation_offscreen_interval * scale;
+        }
+
+        const auto distance { Vector3Distance(camera.target, position) };
+        for (const auto& lod : animation_lods) {
+            if (distance <= lod.distance) {
+                return lod.interval * scale;
+            }
+        }
+
+        return animation_far_interval * scale;
+    }
+
+    // Blends the two keyframes around the interpolated clip time, distant models are sampled less often
+    void sample_pose(const Camera &camera, const Vector3 &position, const ModelAnimation &animation, const int clip,
+                     const float prev_frame_time, const float frame_time, const bool run_once, const float alpha, AnimationPose &pose) {
+        if (++pose.frames_since_sample < animation_interval(camera, position) && pose.sampled) {
+            return;
+        }
+
+        pose.frames_since_sample = 0;
+        pose.sampled = true;
+        pose.dirty = true;
+        pose.clip = clip;
+
+        const auto duration { static_cast<float>(animation.frameCount) / animation_speed };
+        auto time { Lerp(prev_frame_time, frame_time, alpha) };
+        if (time < 0.0f) {
+            time += duration;
+        }
+
+        const auto frame { time * animation_speed };
+        const auto frame0 { std::min(static_cast<int>(frame), animation.frameCount - 1) };
+        const auto frame1 { run_once
+            ? std::min(frame0 + 1, animation.frameCount - 1)
+            : (frame0 + 1) % animation.frameCount };
+        const auto blend { frame - std::floor(frame) };
+
+        pose.bones.resize(animation.boneCount);
+        for (int i { 0 }; i < animation.boneCount; ++i) {
+            const auto& a { animation.framePoses[frame0][i] };
+            const auto& b { animation.framePoses[frame1][i] };
+
+            pose.bones[i] = {
+                .translation { Vector3Lerp(a.translation, b.translation, blend) },
+                .rotation { QuaternionSlerp(a.rotation, b.rotation, blend) },
+                .scale { Vector3Lerp(a.scale, b.scale, blend) },
+            };
+        }
+    }
+
+    // Draws one instance of a shared model, the model shader has to be bound
+    void draw_model(const ModelShader &shader, const WorldModel &world_model, const transforms::Affine &matrix,
+                    AnimationPose *pose, const flecs::entity_t entity) {
+        const auto *model { assets::get(world_model.model) };
+        if (model == nullptr) {
+            return;
+        }
+
+        // Skin the shared meshes when the pose changed or another instance skinned them last
+        if (pose != nullptr && pose->sampled && (pose->dirty || skinned_by[model->meshes] != entity)) {
+            const auto *animations { assets::get(world_model.animations) };
+            auto *frame_pose { pose->bones.data() };
+            const ModelAnimation blended {
+                .boneCount = static_cast<int>(pose->bones.size()),
+                .frameCount = 1,
+                .bones = animations->animations[pose->clip].bones,
+                .framePoses = &frame_pose,
+            };
+
+            graphics::backend().skin(*model, blended);
+            skinned_by[model->meshes] = entity;
+            pose->dirty = false;
+        }
+
+        const auto shader_bool { static_cast<int>(world_model.textured) };
+        uniforms::set(shader.shader, shader.loc_use_texture, &shader_bool, SHADER_UNIFORM_INT);
+
+        // Models are shared, so their materials only need the shader once
+        for (int i { 0 }; i < model->materialCount; i++) {
+            if (model->materials[i].shader.id != shader.shader.id) {
+                model->materials[i].shader = shader.shader;
+            }
+        }
+
+        graphics::backend().draw_model(*model, transforms::to_matrix(matrix));
+    }
+
+    // Shrink the cube with its lifetime before applying the packed world matrix
+    void draw_particle(const float lifetime, const Color color, const transforms::Affine &matrix) {
+        const auto particle_size { 0.1f * lifetime };
+        const auto transform { MatrixMultiply(
+            MatrixScale(particle_size, particle_size, particle_size),
+            transforms::to_matrix(matrix)) };
+
+        graphics::backend().draw_cube(transform, color);
+    }
+
+    // Shadows of the casters nearest to the camera target, positions are interpolated render positions
+    void gather_shadows(const Camera &camera, const memory::ArenaVector<Vector3> &caster_positions,
+                        const memory::ArenaVector<float> &caster_radii, GroundShadows &out) {
+        auto &arena { memory::frame_arena() };
+        memory::ArenaVector<Shadow> shadows(arena);
+        shadows.reserve(caster_positions.size());
+
+        // Ground heights below all casters in one batch
+        memory::ArenaVector<float> xs(caster_positions.size(), arena);
+        memory::ArenaVector<float> zs(caster_positions.size(), arena);
+        memory::ArenaVector<float> ground_heights(caster_positions.size(), arena);
+
+        for (size_t i { 0 }; i < caster_positions.size(); ++i) {
+            xs[i] = caster_positions[i].x;
+            zs[i] = caster_positions[i].z;
+        }
+
+        terrain::get_heights(xs.data(), zs.data(), ground_heights.data(), caster_positions.size());
+
+        for (size_t i { 0 }; i < caster_positions.size(); ++i) {
+            if (const auto hit = terrain::ray_ground_intersect(caster_positions[i], light_dir); hit.has_value()) {
+                // Shadow scale factor based on actual height difference
+                float height_diff = caster_positions[i].y - ground_heights[i];
+                height_diff = std::max(height_diff, 0.001f); // prevent division by zero or negative radii
+
+                shadows.push_back({
+                    .position { *hit },
+                    .radius { caster_radii[i] * (1.0f + height_diff) }, // more height → larger blur radius
+                    .intensity { 1.0f / (1.5f + height_diff * 2.0f) } // more height → softer, lighter shadow
+                });
+            }
+        }
+
+        // Prioritize shadows closer to the camera target
+        std::sort(shadows.begin(), shadows.end(), [&camera](const Shadow &a, const Shadow &b) {
+            return Vector3Distance(camera.target, a.position) < Vector3Distance(camera.target, b.position);
+        });
+
+        const auto budget { std::clamp(quality::current().shadow_budget, 0, MAX_SHADOWS) };
+        out.count = static_cast<int>(std::min(shadows.size(), static_cast<size_t>(budget)));
+        for (int i = 0; i < out.count; ++i) {
+            out.positions[i] = shadows[i].position;
+            out.radii[i] = shadows[i].radius * shadows[i].radius * 1.44f;
+            out.intensities[i] = shadows[i].intensity;
+        }
+    }
+
+    // Visible ground chunks at a level of detail based on their distance to the camera
+    void queue_ground(render_queue::Queue &queue, const GroundShader &shader, const WorldGround &ground, TerrainDraw &draw, const Camera &camera) {
+        const auto frustum { culling::camera_frustum(camera, graphics::backend().aspect()) };
+        const auto texture { ground.model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture.id };
+        draw.chunks_drawn = 0;
+        draw.vertices_drawn = 0;
+
+        for (size_t i { 0 }; i < ground.chunks.size(); ++i) {
+            const auto &chunk { ground.chunks[i] };
+            if (!culling::is_box_visible(frustum, chunk.bounds)) {
+                continue;
+            }
+
+            const auto level { std::min(terrain::ground_lod(chunk.bounds, camera.position) + quality::current().ground_lod_bias, GROUND_LOD_LEVELS - 1) };
+            const auto center { Vector3Scale(Vector3Add(chunk.bounds.min, chunk.bounds.max), 0.5f) };
+            queue.push_ground(shader.shader.id, texture, static_cast<int>(i), level, center);
+
+            draw.chunks_drawn++;
+            draw.vertices_drawn += ground.model.meshes[chunk.meshes[level]].vertexCount;
+        }
+    }
+
+    // Visible water patches, the clock advances even when nothing is in view
+    void queue_water(render_queue::Queue &queue, const WaterShader &shader, const WorldWater &water, TerrainDraw &draw, const Camera &camera, const float dt) {
+        draw.water_time += dt * 0.1f;
+        draw.water_time = fmod(draw.water_time, PI * 2.0f * 100.0f);
+
+        const auto frustum { culling::camera_frustum(camera, graphics::backend().aspect()) };
+        const auto texture { water.model.materials[0].maps[MATERIAL_MAP_NORMAL].texture.id };
+        const auto range { quality::current().water_range };
+        draw.patches_drawn = 0;
+        draw.triangles_drawn = 0;
+
+        for (int i { 0 }; i < water.model.meshCount; ++i) {
+            if (!culling::is_box_visible(frustum, water.patches[i])) {
+                continue;
+            }
+
+            const auto center { Vector3Scale(Vector3Add(water.patches[i].min, water.patches[i].max), 0.5f) };
+            if (Vector2Distance({ center.x, center.z }, { camera.target.x, camera.target.z }) > range) {
+                continue;
+            }
+
+            queue.push_water(shader.shader.id, texture, i, center);
+            draw.patches_drawn++;
+            draw.triangles_drawn += water.model.meshes[i].triangleCount;
+        }
+    }
+
+    // Models are lifted or lowered onto the ground as drawn, which is coarser than get_height further out
+    void queue_model(render_queue::Queue &queue, const ModelShader &shader, const WorldModel &world_model, const Camera &camera,
+                     const transforms::Affine &matrix, AnimationPose *pose, const flecs::entity_t entity) {
+        const auto *model { assets::get(world_model.model) };
+        if (model == nullptr) {
+            return;
+        }
+
+        auto drawn { matrix };
+        drawn.m[7] += terrain::drawn_height_offset(matrix.m[3], matrix.m[11], camera.position, quality::current().ground_lod_bias);
+
+        const auto texture { model->materialCount > 0 ? model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture.id : 0 };
+        queue.push_model(shader.shader.id, texture, world_model, drawn, pose, entity);
+    }
+
+    // Replays the queue in key order. Shaders are bound and set up once per run of commands that
+    // share them, blending is switched on for the transparent pass only.
+    void submit(render_queue::Queue &queue, const FrameTargets &targets) {
+        queue.sort();
+        queue_stats = queue.stats();
+
+        const Shader *active { nullptr };
+        const auto use { [&active](const Shader &shader) {
+            if (active != nullptr && active->id == shader.id) {
+                return false;
+            }
+
+            if (active != nullptr) {
+                graphics::backend().end_shader();
+            }
+            graphics::backend().begin_shader(shader);
+            active = &shader;
+            return true;
+        }};
+
+        auto blending { false };
+        for (const auto &command : queue.commands()) {
+            if (const auto transparent { render_queue::key_pass(command.key) == render_queue::Pass::Transparent }; transparent != blending) {
+                if (transparent) {
+                    graphics::backend().begin_blend(BLEND_ALPHA);
+                } else {
+                    graphics::backend().end_blend();
+                }
+                blending = transparent;
+            }
+
+            switch (command.kind) {
+                case render_queue::Kind::GroundChunk: {
+                    const auto &shader { *targets.ground_shader };
+                    if (use(shader.shader)) {
+                        const auto &shadows { targets.shadows };
+                        uniforms::bind_frame(shader.shader, shader.frame);
+                        uniforms::set(shader.shader, shader.loc_shadow_count, &shadows.count, SHADER_UNIFORM_INT);
+                        uniforms::set_array(shader.shader, shader.loc_shadow_positions, shadows.positions, SHADER_UNIFORM_VEC3, shadows.count);
+                        uniforms::set_array(shader.shader, shader.loc_shadow_radii, shadows.radii, SHADER_UNIFORM_FLOAT, shadows.count);
+                        uniforms::set_array(shader.shader, shader.loc_shadow_itensities, shadows.intensities, SHADER_UNIFORM_FLOAT, shadows.count);
+                        uniforms::set(shader.shader, shader.loc_morph_center, &targets.view_pos, SHADER_UNIFORM_VEC3);
+                    }
+
+                    const auto &draw { queue.mesh(command) };
+                    const auto &ground { *targets.ground };
+                    uniforms::set(shader.shader, shader.loc_morph_range, &GROUND_LOD_MORPH[draw.level], SHADER_UNIFORM_VEC2);
+                    graphics::backend().draw_mesh(ground.model.meshes[ground.chunks[draw.mesh].meshes[draw.level]], ground.model.materials[0], ground.model.transform);
+                    break;
+                }
+                case render_queue::Kind::Model: {
+                    const auto &shader { *targets.model_shader };
+                    if (use(shader.shader)) {
+                        uniforms::bind_frame(shader.shader, shader.frame);
+                    }
+
+                    const auto &draw { queue.model(command) };
+                    draw_model(shader, draw.model, draw.matrix, draw.pose, draw.entity);
+                    break;
+                }
+                case render_queue::Kind::Particle: {
+                    if (use(targets.model_shader->shader)) {
+                        uniforms::bind_frame(targets.model_shader->shader, targets.model_shader->frame);
+                    }
+
+                    const auto &draw { queue.particle(command) };
+                    draw_particle(draw.lifetime, draw.color, draw.matrix);
+                    break;
+                }
+                case render_queue::Kind::WaterPatch: {
+                    const auto &shader { *targets.water_shader };
+                    if (use(shader.shader)) {
+                        uniforms::bind_frame(shader.shader, shader.frame);
+                        uniforms::set(shader.shader, shader.loc_time, &targets.water_time, SHADER_UNIFORM_FLOAT);
+                    }
+
+                    const auto &water { *targets.water };
+                    graphics::backend().draw_mesh(water.model.meshes[queue.mesh(command).mesh], water.model.materials[0], water.model.transform);
+                    break;
+                }
+            }
+        }
+
+        if (active != nullptr) {
+            graphics::backend().end_shader();
+        }
+        if (blending) {
+            graphics::backend().end_blend();
+        }
+    }
+
+    auto last_queue_stats() -> render_queue::Stats {
+        return queue_stats;
+    }
+
+    void set_animation_lod(const bool enabled) {
+        animation_lod = enabled;
+    }
+
     void register_systems(const World &world) {
         // Follow an object with the camera
         const auto camera_follow { [&ecs = world.ecs](flecs::entity, const InterpolationState& state) {
@@ -34,113 +418,123 @@ namespace render_systems {
         }};
 
         // Update camera position based on camera target and distance
-        const auto update_camera { [&ecs = world.ecs](const flecs::entity entity) {
+        const auto update_camera { [&ecs = world.ecs](flecs::entity) {
             auto *cam { ecs.get_mut<WorldCamera>() };
-            const auto *shader { entity.world().get<ModelShader>() };
-
-            SetShaderValue(shader->shader, shader->loc_view_pos, &cam->camera.position, SHADER_UNIFORM_VEC3);
             cam->camera.position = Vector3Add(
                 cam->camera.target,
                 {cam->distance, cam->distance * 1.5f, cam->distance}
             );
         }};
 
-        // Initiate rendering in raylib
+        // Initiate rendering in raylib and start a new queue, render systems only add commands to it
         const auto begin_render { [&ecs = world.ecs](flecs::iter) {
             const auto *cam { ecs.get<WorldCamera>() };
-            BeginMode3D(cam->camera);
+            graphics::backend().begin_3d(cam->camera);
+            frame_queue.begin(cam->camera.position);
+            frame_targets.view_pos = cam->camera.position;
         }};
 
-        // Setup lighting properties in shader
-        const auto setup_lighting { [](flecs::entity, const ModelShader &shader) {
-            SetShaderValue(shader.shader, shader.loc_light_dir, &light_dir, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader.shader, shader.loc_light_color, &light_color, SHADER_UNIFORM_VEC3);
+        // Lighting and camera shared by all shaders, each render system binds it to its own shader
+        const auto setup_lighting { [&ecs = world.ecs](flecs::iter) {
+            const auto *cam { ecs.get<WorldCamera>() };
+            uniforms::begin_frame({ .light_dir = light_dir, .light_color = light_color, .view_pos = cam->camera.position });
         }};
 
-        // Animate models
-        const auto animate_model { [](const flecs::iter& iter, size_t, WorldModel &model, Animation &anim) {
-            const auto& animation = model.animations[anim.run_once.value_or(anim.name)];
-            anim.frame_time += iter.delta_time();
+        // Advance animation clocks, skinning happens on the render side in animate_model
+        const auto advance_animation { [](const flecs::iter& iter, size_t, const WorldModel &model, const SimLod &lod, Animation &anim) {
+            // Clip names are only looked up when they change, not every tick
+            const auto *animations { assets::get(model.animations) };
+            if (animations != nullptr && anim.clip == ANIMATION_UNRESOLVED) {
+                anim.clip = assets::find_animation(*animations, anim.run_once.value_or(anim.name));
+            }
+
+            // Skipped ticks hold the pose, the next due tick catches up on all of them
+            if (!lod.due) {
+                anim.prev_frame_time = anim.frame_time;
+                return;
+            }
 
-            const auto current_frame = static_cast<int>(anim.frame_time * animation_speed);
+            if (animations == nullptr || anim.clip < 0 || animations->animations[anim.clip].frameCount == 0) {
+                return;
+            }
 
-            if (current_frame >= animation.frameCount) {
+            const auto& animation { animations->animations[anim.clip] };
+
+            const auto duration { static_cast<float>(animation.frameCount) / animation_speed };
+            anim.prev_frame_time = anim.frame_time;
+            anim.frame_time += iter.delta_time() * lod.steps;
+
+            if (anim.frame_time >= duration) {
                 if (anim.run_once.has_value()) {
                     anim.run_once.reset();
                     anim.frame_time = 0.0f;
+                    anim.prev_frame_time = 0.0f;
+                    anim.clip = ANIMATION_UNRESOLVED;
                     return;
                 }
 
-                anim.frame_time = std::fmod(anim.frame_time, static_cast<float>(animation.frameCount) / animation_speed);
+                // Keep prev_frame_time on the same timeline so the render side can blend across the loop
+                anim.frame_time = std::fmod(anim.frame_time, duration);
+                anim.prev_frame_time -= duration;
             }
+        }};
 
-            UpdateModelAnimation(model.model, animation, current_frame);
+        // Sample animated models at render rate, blending between keyframes. Skinning happens in
+        // render_model since instances of a model share its meshes.
+        const auto animate_model { [&ecs = world.ecs](const flecs::iter& iter, size_t, const WorldModel &model, const Animation &anim, const InterpolationState &state, AnimationPose &pose) {
+            const auto *animations { assets::get(model.animations) };
+            if (animations == nullptr || anim.clip < 0 || anim.clip >= animations->count || animations->animations[anim.clip].frameCount == 0) {
+                return;
+            }
+
+            const auto clip { anim.clip };
+            const auto *cam { ecs.get<WorldCamera>() };
+            sample_pose(cam->camera, state.render_pos, animations->animations[clip], clip,
+                anim.prev_frame_time, anim.frame_time, anim.run_once.has_value(), iter.delta_time(), pose);
         }};
 
-        // Render models
+        // Queue models
         const auto render_model { [](const flecs::iter& iter) {
             const auto* shader = iter.world().get<ModelShader>();
-            const auto *cam { iter.world().get<WorldCamera>() };
-            BeginShaderMode(shader->shader);
-
-            const auto query { iter.world().query<WorldModel, InterpolationState>() };
-
-            SetShaderValue(shader->shader, shader->loc_light_dir, &light_dir, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_light_color, &light_color, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_view_pos, &cam->camera.position, SHADER_UNIFORM_VEC3);
+            if (shader == nullptr) {
+                return;
+            }
 
-            query.each([shader](WorldModel &model, const InterpolationState &state) {
-                const auto shader_bool { static_cast<int>(model.textured) };
-                SetShaderValue(shader->shader, shader->loc_use_texture, &shader_bool, SHADER_UNIFORM_INT);
+            const auto *render { iter.world().get<RenderTransforms>() };
+            const auto *cam { iter.world().get<WorldCamera>() };
+            frame_targets.model_shader = shader;
 
-                for (int i { 0 }; i < model.model.materialCount; i++) {
-                    model.model.materials[i].shader = shader->shader;
+            const auto query { iter.world().query<const WorldModel, const InterpolationState, AnimationPose*>() };
+            query.each([shader, render, cam](const flecs::entity entity, const WorldModel &world_model, const InterpolationState &state, AnimationPose *pose) {
+                if (state.render_index < 0 || state.render_index >= static_cast<int>(render->matrices.size())) {
+                    return;
                 }
 
-                const auto mat_scale { MatrixScale(state.render_scale, state.render_scale, state.render_scale) };
-                const auto mat_rotation { QuaternionToMatrix(state.render_rot) };
-                const auto mat_translation { MatrixTranslate(state.render_pos.x, state.render_pos.y, state.render_pos.z) };
-                const auto mat_transform { MatrixMultiply(mat_scale, MatrixMultiply(mat_rotation, mat_translation)) };
-
-                model.model.transform = mat_transform;
-
-                DrawModel(model.model, {}, 1.0f, WHITE);
+                queue_model(frame_queue, *shader, world_model, cam->camera, render->matrices[state.render_index], pose, entity.id());
             });
-
-            EndShaderMode();
         }};
 
-        // Render particles
+        // Queue particles
         const auto render_particle = [](const flecs::iter& iter) {
             const auto* shader = iter.world().get<ModelShader>();
-            BeginShaderMode(shader->shader);
+            if (shader == nullptr) {
+                return;
+            }
+
+            const auto *render { iter.world().get<RenderTransforms>() };
+            frame_targets.model_shader = shader;
 
             const auto query { iter.world().query<Particle, InterpolationState>() };
-            query.each([](const Particle& particle, const InterpolationState& state) {
-                const auto particle_size { 0.1f * particle.lifetime };
-                // Convert euler to rotation matrix (more efficient for complex rotations)
-                const auto rotation_matrix { MatrixRotateXYZ({
-                    state.render_rot.x, // Convert to radians if needed
-                    state.render_rot.y,
-                    state.render_rot.z,
-                })};
-
-                const auto translation { MatrixTranslate(state.render_pos.x, state.render_pos.y, state.render_pos.z) };
-                const Matrix scale { MatrixScale(particle_size * state.render_scale, particle_size * state.render_scale, particle_size * state.render_scale) };
-
-                // Combine: Scale -> Rotate -> Translate
-                const auto transform { MatrixMultiply(MatrixMultiply(scale, rotation_matrix), translation) };
-
-                rlPushMatrix();
-                rlMultMatrixf(MatrixToFloat(transform));
-                DrawCube({0, 0, 0}, 1.0f, 1.0f, 1.0f, particle.color);
-                rlPopMatrix();
-            });
+            query.each([shader, render](const Particle& particle, const InterpolationState& state) {
+                if (state.render_index < 0 || state.render_index >= static_cast<int>(render->matrices.size())) {
+                    return;
+                }
 
-            EndShaderMode();
+                frame_queue.push_particle(shader->shader.id, render->matrices[state.render_index], particle.color, particle.lifetime);
+            });
         };
 
-        // Render ground plane and shadows
+        // Queue ground plane and shadows
         const auto render_ground = [](const flecs::iter &iter) {
             const auto* shader = iter.world().get<GroundShader>();
             const auto* ground = iter.world().get<WorldGround>();
@@ -149,84 +543,49 @@ namespace render_systems {
             }
 
             const auto *cam { iter.world().get<WorldCamera>() };
-            std::vector<Shadow> shadows;
+            memory::ArenaVector<Vector3> caster_positions(memory::frame_arena());
+            memory::ArenaVector<float> caster_radii(memory::frame_arena());
 
             const auto query { iter.world().query<ShadowCaster, InterpolationState>() };
-            query.each([&shadows](const ShadowCaster& caster, const InterpolationState& state) {
-                if (const auto hit = terrain::ray_ground_intersect(state.render_pos, light_dir); hit.has_value()) {
-                    // Shadow scale factor based on actual height difference
-                    float height_diff = state.render_pos.y - terrain::get_height(state.render_pos.x, state.render_pos.z);
-                    height_diff = std::max(height_diff, 0.001f); // prevent division by zero or negative radii
-
-                    shadows.push_back({
-                        .position { *hit },
-                        .radius { caster.radius * (1.0f + height_diff) }, // more height → larger blur radius
-                        .intensity { 1.0f / (1.5f + height_diff * 2.0f) } // more height → softer, lighter shadow
-                    });
-                }
+            query.each([&caster_positions, &caster_radii](const ShadowCaster& caster, const InterpolationState& state) {
+                caster_positions.push_back(state.render_pos);
+                caster_radii.push_back(caster.radius);
             });
 
-            // Prioritize shadows closer to the camera target
-            std::sort(shadows.begin(), shadows.end(), [&cam](const Shadow &a, const Shadow &b) {
-                return Vector3Distance(cam->camera.target, a.position) < Vector3Distance(cam->camera.target, b.position);
-            });
-
-            const auto shadow_count = static_cast<int>(std::min(shadows.size(), static_cast<size_t>(64)));
-            std::vector<Vector3> positions(shadow_count);
-            std::vector<float> radii(shadow_count);
-            std::vector<float> intensities(shadow_count);
-
-            for (int i = 0; i < shadow_count; ++i) {
-                positions[i] = shadows[i].position;
-                radii[i] = shadows[i].radius * shadows[i].radius * 1.44f;
-                intensities[i] = shadows[i].intensity;
-            }
-
-            BeginShaderMode(shader->shader);
-            SetShaderValue(shader->shader, shader->loc_light_dir, &light_dir, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_light_color, &light_color, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_view_pos, &cam->camera.position, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_shadow_count, &shadow_count, SHADER_UNIFORM_INT);
-            SetShaderValueV(shader->shader, shader->loc_shadow_positions, positions.data(), SHADER_UNIFORM_VEC3, shadow_count);
-            SetShaderValueV(shader->shader, shader->loc_shadow_radii,radii.data(), SHADER_UNIFORM_FLOAT, shadow_count);
-            SetShaderValueV(shader->shader, shader->loc_shadow_itensities, intensities.data(), SHADER_UNIFORM_FLOAT, shadow_count);
-
-            DrawModel(ground->model, Vector3Zero(), 1.0f, WHITE);
-            EndShaderMode();
+            frame_targets.ground_shader = shader;
+            frame_targets.ground = ground;
+            gather_shadows(cam->camera, caster_positions, caster_radii, frame_targets.shadows);
+            queue_ground(frame_queue, *shader, *ground, terrain_draw, cam->camera);
         };
 
-        // Render water
+        // Queue water
         const auto render_water = [](const flecs::iter& iter) {
             const auto* shader = iter.world().get<WaterShader>();
-            auto* water = iter.world().get_mut<WorldWater>();
+            const auto* water = iter.world().get<WorldWater>();
             if (shader == nullptr || water == nullptr) {
                 return;
             }
 
+            frame_targets.water_shader = shader;
+            frame_targets.water = water;
             const auto *cam { iter.world().get<WorldCamera>() };
-
-            water->time += iter.delta_time() * 0.1f;
-            water->time = fmod(water->time, PI * 2.0f * 100.0f);
-
-            std::vector<Shadow> shadows;
-
-            BeginBlendMode(BLEND_ALPHA);
-            BeginShaderMode(shader->shader);
-            SetShaderValue(shader->shader, shader->loc_light_dir, &light_dir, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_light_color, &light_color, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_view_pos, &cam->camera.position, SHADER_UNIFORM_VEC3);
-            SetShaderValue(shader->shader, shader->loc_time, &water->time, SHADER_UNIFORM_FLOAT);
-
-            DrawModel(water->model, Vector3Zero(), 1.0f, WHITE);
-            EndShaderMode();
-            EndBlendMode();
+            queue_water(frame_queue, *shader, *water, terrain_draw, cam->camera, iter.delta_time());
+            frame_targets.water_time = terrain_draw.water_time;
         };
 
+        // Draw everything queued this frame
+        const auto submit_render { [](flecs::iter) {
+            submit(frame_queue, frame_targets);
+        }};
+
         // End raylib render
         const auto end_render { [](flecs::iter) {
-            EndMode3D();
+            graphics::backend().end_3d();
         }};
 
+        // Animated entities get a render side pose buffer
+        world.ecs.component<Animation>().add(flecs::With, world.ecs.component<AnimationPose>());
+
         world.ecs.system<InterpolationState>("camera_follow")
             .kind(world.render_phase)
             .with<CameraFollow>()
@@ -241,12 +600,16 @@ namespace render_systems {
             .kind(world.render_phase)
             .run(begin_render);
 
-        world.ecs.system<ModelShader>("setup_lighting")
+        world.ecs.system("setup_lighting")
             .kind(world.render_phase)
-            .each(setup_lighting);
+            .run(setup_lighting);
 
-        world.ecs.system<WorldModel, Animation>("animate_model")
+        world.ecs.system<const WorldModel, const SimLod, Animation>("advance_animation")
             .kind(world.fixed_phase)
+            .each(advance_animation);
+
+        world.ecs.system<const WorldModel, const Animation, const InterpolationState, AnimationPose>("animate_model")
+            .kind(world.render_phase)
             .each(animate_model);
 
         world.ecs.system("render_ground")
@@ -265,8 +628,101 @@ namespace render_systems {
             .kind(world.render_phase)
             .run(render_water);
 
+        world.ecs.system("submit_render")
+            .kind(world.render_phase)
+            .run(submit_render);
+
         world.ecs.system("end_render")
             .kind(world.render_phase)
             .run(end_render);
     }
+
+    void render_frame(FrameView &view, const SimFrame &frame, const float alpha, const float dt) {
+        // Interpolate between the transforms before and after the published tick, all matrices in one pass
+        view.batch.clear();
+        for (const auto &entity : frame.entities) {
+            const auto position { Vector3Lerp(entity.prev.pos, entity.current.pos, alpha) };
+            view.batch.push(position, QuaternionSlerp(entity.prev.rot, entity.current.rot, alpha),
+                Lerp(entity.prev.scale, entity.current.scale, alpha));
+
+            if (entity.follow) {
+                view.camera.target = position;
+                view.camera.target.y = fmax(view.camera.target.y, 0.0);
+            }
+        }
+
+        view.matrices.resize(view.batch.size());
+        transforms::build_matrices(view.batch, view.matrices.data());
+
+        view.camera.position = Vector3Add(view.camera.target, { view.distance, view.distance * 1.5f, view.distance });
+        uniforms::begin_frame({ .light_dir = light_dir, .light_color = light_color, .view_pos = view.camera.position });
+        graphics::backend().begin_3d(view.camera);
+        view.queue.begin(view.camera.position);
+
+        FrameTargets targets {
+            .model_shader = view.model_shader,
+            .ground_shader = view.ground_shader,
+            .water_shader = view.water_shader,
+            .ground = view.ground,
+            .water = view.water,
+            .view_pos = view.camera.position,
+        };
+
+        if (view.ground_shader != nullptr && view.ground != nullptr) {
+            memory::ArenaVector<Vector3> caster_positions(memory::frame_arena());
+            memory::ArenaVector<float> caster_radii(memory::frame_arena());
+            caster_positions.reserve(frame.entities.size());
+            caster_radii.reserve(frame.entities.size());
+
+            for (size_t i { 0 }; i < frame.entities.size(); ++i) {
+                if (frame.entities[i].shadow_radius > 0.0f) {
+                    caster_positions.push_back({ view.batch.px[i], view.batch.py[i], view.batch.pz[i] });
+                    caster_radii.push_back(frame.entities[i].shadow_radius);
+                }
+            }
+
+            gather_shadows(view.camera, caster_positions, caster_radii, targets.shadows);
+            queue_ground(view.queue, *view.ground_shader, *view.ground, view.terrain, view.camera);
+        }
+
+        if (const auto *shader { view.model_shader }) {
+            for (size_t i { 0 }; i < frame.entities.size(); ++i) {
+                const auto &entity { frame.entities[i] };
+                if (!entity.model.model.valid()) {
+                    continue;
+                }
+
+                // Poses stay on the render side, keyed by entity and dropped once the entity stops being published
+                AnimationPose *pose { nullptr };
+                const auto *animations { entity.clip >= 0 ? assets::get(entity.model.animations) : nullptr };
+                if (animations != nullptr && entity.clip < animations->count && animations->animations[entity.clip].frameCount > 0) {
+                    auto &frame_pose { view.poses[entity.id] };
+                    frame_pose.tick = frame.tick;
+                    sample_pose(view.camera, { view.batch.px[i], view.batch.py[i], view.batch.pz[i] }, animations->animations[entity.clip],
+                        entity.clip, entity.prev_frame_time, entity.frame_time, entity.run_once, alpha, frame_pose.pose);
+                    pose = &frame_pose.pose;
+                }
+
+                queue_model(view.queue, *shader, entity.model, view.camera, view.matrices[i], pose, entity.id);
+            }
+
+            for (size_t i { 0 }; i < frame.entities.size(); ++i) {
+                if (frame.entities[i].particle) {
+                    view.queue.push_particle(shader->shader.id, view.matrices[i], frame.entities[i].color, frame.entities[i].lifetime);
+                }
+            }
+        }
+
+        if (view.water_shader != nullptr && view.water != nullptr) {
+            queue_water(view.queue, *view.water_shader, *view.water, view.terrain, view.camera, dt);
+            targets.water_time = view.terrain.water_time;
+        }
+
+        submit(view.queue, targets);
+        graphics::backend().end_3d();
+
+        for (auto it { view.poses.begin() }; it != view.poses.end();) {
+            it = it->second.tick == frame.tick ? std::next(it) : view.poses.erase(it);
+        }
+    }
 }
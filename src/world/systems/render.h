@@ -1,6 +1,17 @@
 #pragma once
 #include "world/world.h"
+#include "world/simulation.h"
+#include "world/render_queue.h"
 
 namespace render_systems {
     void register_systems(const World &world);
+
+    // Draws a frame published by the simulation thread without touching the ECS
+    void render_frame(FrameView &view, const SimFrame &frame, float alpha, float dt);
+
+    // State changes of the last submitted render queue
+    auto last_queue_stats() -> render_queue::Stats;
+
+    // Samples every animated model each frame while off, the baseline for the sampling LOD
+    void set_animation_lod(bool enabled);
 }
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "streaming.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <map>
+#include <type_traits>
+#include <raylib.h>
+#include "world/components/gameplay.h"
+#include "world/components/interpolation.h"
+#include "world/components/render.h"
+#include "world/systems/interpolation.h"
+#include "world/terrain/terrain.h"
+
+namespace streaming_systems {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+        using ChunkKey = std::pair<int, int>;
+
+        constexpr auto CHUNK_WORLD_SIZE { static_cast<float>(GROUND_CHUNK_SIZE) / DETAIL };
+
+        // Component kept in the dormant form, tags have no size and only record presence
+        struct StreamedComponent {
+            ecs_id_t id;
+            size_t size;
+        };
+
+        // Instances of one prefab owning the same streamed components, stored column by column.
+        // Values equal to the prefab's are left out, they come back through the IsA relationship.
+        // The entities stay alive without components, so references to them survive a round trip.
+        struct DormantGroup {
+            ecs_entity_t prefab { 0 };
+            std::vector<ecs_entity_t> entities {};
+            std::vector<size_t> components {};
+            std::vector<std::vector<uint8_t>> columns {};
+            size_t count { 0 };
+        };
+
+        struct DormantChunk {
+            std::vector<DormantGroup> groups {};
+            std::vector<terrain::Blocker> blockers {};
+        };
+
+        struct RestoredGroup {
+            DormantGroup group;
+            std::vector<InterpolationState> states;
+        };
+
+        std::vector<StreamedComponent> streamed_components;
+        std::map<ChunkKey, DormantChunk> dormant;
+        std::map<ChunkKey, std::future<std::vector<RestoredGroup>>> restoring;
+
+        // Colliders of dormant and restoring chunks keep blocking paths until they are back in the ECS
+        std::map<ChunkKey, std::vector<terrain::Blocker>> restoring_blockers;
+        std::vector<terrain::Blocker> blockers;
+
+        void gather_blockers() {
+            blockers.clear();
+            for (const auto &[key, chunk] : dormant) {
+                blockers.insert(blockers.end(), chunk.blockers.begin(), chunk.blockers.end());
+            }
+            for (const auto &[key, chunk_blockers] : restoring_blockers) {
+                blockers.insert(blockers.end(), chunk_blockers.begin(), chunk_blockers.end());
+            }
+        }
+
+        template <typename T>
+        void stream_component(const flecs::world &ecs) {
+            static_assert(std::is_trivially_copyable_v<T>, "streamed components are stored as raw bytes");
+            streamed_components.push_back({ ecs.id<T>().raw_id(), std::is_empty_v<T> ? 0 : sizeof(T) });
+        }
+
+        auto chunk_of(const Vector3 &pos) -> ChunkKey {
+            return {
+                static_cast<int>(std::floor(terrain::world_to_terrain(pos.x) / GROUND_CHUNK_SIZE)),
+                static_cast<int>(std::floor(terrain::world_to_terrain(pos.z) / GROUND_CHUNK_SIZE)),
+            };
+        }
+
+        // Horizontal distance from a point to the closest edge of a chunk, zero inside it
+        auto distance_to_chunk(const ChunkKey &key, const Vector3 &target) -> float {
+            const auto x0 { terrain::terrain_to_world(static_cast<float>(key.first * GROUND_CHUNK_SIZE)) };
+            const auto z0 { terrain::terrain_to_world(static_cast<float>(key.second * GROUND_CHUNK_SIZE)) };
+            const auto dx { std::max({ x0 - target.x, 0.0f, target.x - (x0 + CHUNK_WORLD_SIZE) }) };
+            const auto dz { std::max({ z0 - target.z, 0.0f, target.z - (z0 + CHUNK_WORLD_SIZE) }) };
+            return std::sqrt(dx * dx + dz * dz);
+        }
+
+        auto chunk_bytes(const DormantChunk &chunk) -> size_t {
+            size_t bytes { 0 };
+            for (const auto &group : chunk.groups) {
+                bytes += group.entities.size() * sizeof(ecs_entity_t);
+                for (const auto &column : group.columns) {
+                    bytes += column.size();
+                }
+            }
+            return bytes;
+        }
+
+        // Copies the streamed components of the entities into the chunk and strips them, the ids are kept
+        void make_dormant(const flecs::world &ecs, DormantChunk &chunk, const std::vector<flecs::entity> &entities) {
+            std::map<std::pair<ecs_entity_t, uint32_t>, size_t> group_index;
+
+            for (const auto entity : entities) {
+                const auto prefab { entity.target(flecs::IsA).id() };
+                uint32_t mask { 1 }; // WorldTransform is always kept
+
+                for (size_t c { 1 }; c < streamed_components.size(); ++c) {
+                    const auto &component { streamed_components[c] };
+                    if (!ecs_owns_id(ecs, entity, component.id)) {
+                        continue;
+                    }
+
+                    if (component.size > 0 && prefab != 0) {
+                        const auto *base { ecs_get_id(ecs, prefab, component.id) };
+                        if (base && std::memcmp(base, ecs_get_id(ecs, entity, component.id), component.size) == 0) {
+                            continue;
+                        }
+                    }
+
+                    mask |= 1u << c;
+                }
+
+                if (const auto *collider { entity.get<Collider>() }) {
+                    chunk.blockers.push_back({ .pos = entity.get<WorldTransform>()->pos, .radius = collider->radius });
+                }
+
+                const auto [it, created] { group_index.try_emplace({ prefab, mask }, chunk.groups.size()) };
+                if (created) {
+                    auto &group { chunk.groups.emplace_back() };
+                    group.prefab = prefab;
+                    for (size_t c { 0 }; c < streamed_components.size(); ++c) {
+                        if (mask & (1u << c)) {
+                            group.components.push_back(c);
+                        }
+                    }
+                    group.columns.resize(group.components.size());
+                }
+
+                auto &group { chunk.groups[it->second] };
+                for (size_t i { 0 }; i < group.components.size(); ++i) {
+                    const auto &component { streamed_components[group.components[i]] };
+                    if (component.size == 0) {
+                        continue;
+                    }
+
+                    const auto *bytes { static_cast<const uint8_t*>(ecs_get_id(ecs, entity, component.id)) };
+                    group.columns[i].insert(group.columns[i].end(), bytes, bytes + component.size);
+                }
+                group.entities.push_back(entity.id());
+                ++group.count;
+            }
+
+            for (const auto entity : entities) {
+                entity.clear();
+            }
+        }
+
+        // Runs on a worker, rebuilds the render state so the main thread only has to insert the columns
+        auto rebuild(DormantChunk chunk) -> std::vector<RestoredGroup> {
+            std::vector<RestoredGroup> restored;
+            restored.reserve(chunk.groups.size());
+
+            for (auto &group : chunk.groups) {
+                const auto *transforms { reinterpret_cast<const WorldTransform*>(group.columns[0].data()) };
+
+                std::vector<InterpolationState> states;
+                states.reserve(group.count);
+                for (size_t i { 0 }; i < group.count; ++i) {
+                    states.push_back(interpolation_systems::snapped(transforms[i]));
+                }
+
+                restored.push_back({ .group = std::move(group), .states = std::move(states) });
+            }
+
+            return restored;
+        }
+
+        // Inserts a restored group in a single table operation, back into the entities it was taken from
+        void spawn_group(const flecs::world &ecs, RestoredGroup &restored) {
+            auto &group { restored.group };
+
+            ecs_bulk_desc_t desc {};
+            desc.entities = group.entities.data();
+            desc.count = static_cast<int32_t>(group.count);
+
+            std::vector<void*> data;
+            size_t term { 0 };
+
+            if (group.prefab != 0) {
+                desc.ids[term++] = ecs_pair(EcsIsA, group.prefab);
+                data.push_back(nullptr);
+            }
+
+            for (size_t i { 0 }; i < group.components.size(); ++i) {
+                desc.ids[term++] = streamed_components[group.components[i]].id;
+                data.push_back(group.columns[i].empty() ? nullptr : group.columns[i].data());
+            }
+
+            desc.ids[term] = ecs.id<InterpolationState>().raw_id();
+            data.push_back(restored.states.data());
+            desc.data = data.data();
+
+            ecs_bulk_init(ecs, &desc);
+        }
+    }
+
+    void wake_all(const flecs::world &ecs) {
+        for (auto &[key, restore] : restoring) {
+            for (auto &group : restore.get()) {
+                spawn_group(ecs, group);
+            }
+        }
+        restoring.clear();
+        restoring_blockers.clear();
+
+        for (auto &[key, chunk] : dormant) {
+            for (auto &group : rebuild(std::move(chunk))) {
+                spawn_group(ecs, group);
+            }
+        }
+        dormant.clear();
+        blockers.clear();
+    }
+
+    auto dormant_colliders() -> const std::vector<terrain::Blocker>& {
+        return blockers;
+    }
+
+    void register_systems(const World &world) {
+        streamed_components.clear();
+        dormant.clear();
+        restoring.clear();
+        restoring_blockers.clear();
+        blockers.clear();
+
+        // WorldTransform must stay first, restores rebuild the render state from it
+        stream_component<WorldTransform>(world.ecs);
+        stream_component<WorldModel>(world.ecs);
+        stream_component<ShadowCaster>(world.ecs);
+        stream_component<Collider>(world.ecs);
+        stream_component<Spin>(world.ecs);
+        stream_component<Bounce>(world.ecs);
+        stream_component<Consumable>(world.ecs);
+        stream_component<Static>(world.ecs);
+        stream_component<Streamed>(world.ecs);
+
+        world.ecs.set<StreamingConfig>({});
+        world.ecs.set<StreamingStats>({});
+
+        const auto streamed { world.ecs.query_builder<const WorldTransform>().with<Streamed>().build() };
+
+        // Moves chunks between the ECS and their dormant form around the camera target. Only active
+        // entities are visited, so the cost is bounded by the radius rather than the world size.
+        const auto update_streaming { [&ecs = world.ecs, streamed](flecs::iter) {
+            const auto *cam { ecs.get<WorldCamera>() };
+            const auto *config { ecs.get<StreamingConfig>() };
+            auto *stats { ecs.get_mut<StreamingStats>() };
+            const auto target { cam->camera.target };
+
+            auto blockers_changed { false };
+            stats->chunks_restored = 0;
+            stats->chunks_made_dormant = 0;
+
+            // Insert chunks whose columns were rebuilt in the background
+            auto start { Clock::now() };
+            for (auto it { restoring.begin() }; it != restoring.end();) {
+                if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    ++it;
+                    continue;
+                }
+
+                for (auto &group : it->second.get()) {
+                    spawn_group(ecs, group);
+                }
+
+                restoring_blockers.erase(it->first);
+                it = restoring.erase(it);
+                blockers_changed = true;
+                ++stats->chunks_restored;
+            }
+            stats->restore_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+            std::map<ChunkKey, std::vector<flecs::entity>> leaving;
+            auto active { 0 };
+
+            streamed.each([&](const flecs::entity entity, const WorldTransform &transform) {
+                const auto key { chunk_of(transform.pos) };
+                if (distance_to_chunk(key, target) > config->radius + config->hysteresis) {
+                    leaving[key].push_back(entity);
+                } else {
+                    ++active;
+                }
+            });
+
+            start = Clock::now();
+            for (const auto &[key, entities] : leaving) {
+                make_dormant(ecs, dormant[key], entities);
+                blockers_changed = true;
+                ++stats->chunks_made_dormant;
+            }
+            stats->dormant_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+            for (auto it { dormant.begin() }; it != dormant.end();) {
+                if (distance_to_chunk(it->first, target) > config->radius || restoring.count(it->first) > 0) {
+                    ++it;
+                    continue;
+                }
+
+                restoring_blockers[it->first] = std::move(it->second.blockers);
+                restoring.emplace(it->first, std::async(std::launch::async, rebuild, std::move(it->second)));
+                it = dormant.erase(it);
+            }
+
+            if (blockers_changed) {
+                gather_blockers();
+            }
+
+            stats->active_entities = active;
+            stats->dormant_entities = 0;
+            stats->dormant_bytes = 0;
+            for (const auto &[key, chunk] : dormant) {
+                for (const auto &group : chunk.groups) {
+                    stats->dormant_entities += static_cast<int>(group.count);
+                }
+                stats->dormant_bytes += chunk_bytes(chunk);
+            }
+            stats->dormant_chunks = static_cast<int>(dormant.size());
+            stats->restoring_chunks = static_cast<int>(restoring.size());
+        }};
+
+        // Runs outside of deferred mode, dormant chunks are inserted with bulk operations. Once per tick
+        // is plenty, and keeps it on the simulation thread in threaded mode.
+        world.ecs.system("update_streaming")
+            .kind(world.pre_fixed_phase)
+            .immediate()
+            .run(update_streaming);
+    }
+}
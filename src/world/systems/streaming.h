@@ -0,0 +1,14 @@
+#pragma once
+#include "world/world.h"
+#include "world/components/streaming.h"
+#include "world/terrain/terrain.h"
+
+namespace streaming_systems {
+    void register_systems(const World &world);
+
+    // Brings every dormant chunk back into the ECS right away, e.g. before taking a snapshot
+    void wake_all(const flecs::world &ecs);
+
+    // Colliders of the entities that are currently dormant, they still block the path grid
+    auto dormant_colliders() -> const std::vector<terrain::Blocker>&;
+}
@@ -0,0 +1,53 @@
+#include "terrain.h"
+#include <algorithm>
+#include <cmath>
+
+namespace terrain {
+    void deform(const World &world, const Vector3 center, const Brush &brush) {
+        const auto tx { world_to_terrain(center.x) };
+        const auto tz { world_to_terrain(center.z) };
+        const auto radius { brush.radius * DETAIL };
+
+        const auto x0 { std::max(static_cast<int>(std::ceil(tx - radius)), 0) };
+        const auto z0 { std::max(static_cast<int>(std::ceil(tz - radius)), 0) };
+        const auto x1 { std::min(static_cast<int>(std::floor(tx + radius)), DETAILED_SIZE - 1) };
+        const auto z1 { std::min(static_cast<int>(std::floor(tz + radius)), DETAILED_SIZE - 1) };
+        if (x0 > x1 || z0 > z1) {
+            return;
+        }
+
+        for (auto z { z0 }; z <= z1; ++z) {
+            for (auto x { x0 }; x <= x1; ++x) {
+                const auto dx { static_cast<float>(x) - tx };
+                const auto dz { static_cast<float>(z) - tz };
+                const auto d2 { (dx * dx + dz * dz) / (radius * radius) };
+                if (d2 >= 1.0f) {
+                    continue;
+                }
+
+                const auto weight { (1.0f - d2) * (1.0f - d2) };
+                auto height { elevation.get(x, z) };
+
+                switch (brush.mode) {
+                    case BrushMode::Raise: height += brush.strength * weight; break;
+                    case BrushMode::Lower: height -= brush.strength * weight; break;
+                    case BrushMode::Flatten: height += (brush.height - height) * std::min(brush.strength * weight, 1.0f); break;
+                }
+
+                elevation.set(x, z, height);
+            }
+        }
+
+        // Every cell touching an edited vertex
+        update_height_planes(x0 - 1, z0 - 1, x1 + 1, z1 + 1);
+        update_ground(world, x0, z0, x1, z1);
+        update_water(world, x0, z0, x1, z1);
+
+        // Path tiles sample the cells around them, so every tile within a cell of an edited vertex
+        const auto gx0 { static_cast<int>(std::floor(world_to_grid(terrain_to_world(static_cast<float>(x0 - 1))))) };
+        const auto gz0 { static_cast<int>(std::floor(world_to_grid(terrain_to_world(static_cast<float>(z0 - 1))))) };
+        const auto gx1 { static_cast<int>(std::ceil(world_to_grid(terrain_to_world(static_cast<float>(x1 + 1))))) + 1 };
+        const auto gz1 { static_cast<int>(std::ceil(world_to_grid(terrain_to_world(static_cast<float>(z1 + 1))))) + 1 };
+        update_ground_tiles(gx0, gz0, gx1, gz1);
+    }
+}
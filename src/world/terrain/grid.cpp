@@ -1,14 +1,27 @@
 #include "terrain.h"
 #include <raylib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
 #include <vector>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <micropather.h>
+#include "jump_points.h"
+#include "memory/memory.h"
 #include "world/components/gameplay.h"
 #include "world/components/render.h"
 
 
 namespace terrain {
-    std::vector walkable(GRID_SIZE * GRID_SIZE, true);
+    std::vector<bool> walkable(GRID_SIZE * GRID_SIZE, true);
+
+    // Distance in tiles from each tile to the nearest blocked one, capped at MAX_CLEARANCE
+    std::vector<float> clearance(GRID_SIZE * GRID_SIZE, static_cast<float>(MAX_CLEARANCE));
 
     inline bool is_in_bounds(const int x, const int y) {
         return x >= 0 && x < GRID_SIZE && y >= 0 && y < GRID_SIZE;
@@ -59,25 +72,131 @@ namespace terrain {
         }
     }
 
-    void update_collision_entities(const flecs::world& world) {
-        std::fill(walkable.begin(), walkable.end(), true);
-        
-        // First block terrain-based obstacles (water, etc.)
-        for (auto gz { 0 }; gz < GRID_SIZE; ++gz) {
-            for (auto gx { 0 }; gx < GRID_SIZE; ++gx) {
-                const auto world_x { grid_to_world(static_cast<float>(gx)) };
-                const auto world_z { grid_to_world(static_cast<float>(gz)) };
+    // JPS+ tables per agent size, built on the first search that needs one
+    static std::unique_ptr<JumpTable> jump_tables[MAX_CLEARANCE];
 
-                if (get_height(world_x, world_z) <= -0.4f) {
-                    block_tile(gx, gz);
+    static PathSolver solver { PathSolver::MicroPather };
+
+    // Written by find_path on the simulation thread, read by the stats overlay on the main thread
+    static std::mutex stats_mutex;
+    static PathStats stats {};
+
+    // Tiles an agent of radius tiles can stand on, zero gives the plain walkable grid
+    inline bool is_passable(const int x, const int y, const int radius) {
+        return is_in_bounds(x, y) && clearance[coords_to_index(x, y)] > static_cast<float>(radius);
+    }
+
+    // Agent radius in whole tiles, rounded up so a path never brushes closer than the radius
+    inline int radius_to_tiles(const float radius) {
+        return std::clamp(static_cast<int>(std::ceil(radius * GRID_DETAIL)), 0, MAX_CLEARANCE - 1);
+    }
+
+    float get_clearance(const int x, const int y) {
+        return is_in_bounds(x, y) ? clearance[coords_to_index(x, y)] / GRID_DETAIL : 0.0f;
+    }
+
+    bool can_stand(const Vector3& world_pos, const float radius) {
+        const auto [x, z] { world_to_grid_coords(world_pos) };
+        return is_passable(x, z, radius_to_tiles(radius));
+    }
+
+    namespace {
+        constexpr float FAR { std::numeric_limits<float>::infinity() };
+
+        // Squared distance transform of one line (Felzenszwalb and Huttenlocher). Only finite
+        // samples span parabolas, so lines without any blocked tile stay infinite.
+        void distance_transform(const float *f, float *d, const int n, int *v, float *z) {
+            auto k { -1 };
+            for (auto q { 0 }; q < n; ++q) {
+                if (f[q] == FAR) {
+                    continue;
+                }
+
+                if (k < 0) {
+                    k = 0;
+                    v[0] = q;
+                    z[0] = -FAR;
+                    z[1] = FAR;
+                    continue;
                 }
+
+                auto s { ((f[q] + static_cast<float>(q * q)) - (f[v[k]] + static_cast<float>(v[k] * v[k]))) / static_cast<float>(2 * q - 2 * v[k]) };
+                while (s <= z[k]) {
+                    --k;
+                    s = ((f[q] + static_cast<float>(q * q)) - (f[v[k]] + static_cast<float>(v[k] * v[k]))) / static_cast<float>(2 * q - 2 * v[k]);
+                }
+
+                ++k;
+                v[k] = q;
+                z[k] = s;
+                z[k + 1] = FAR;
+            }
+
+            if (k < 0) {
+                std::fill(d, d + n, FAR);
+                return;
+            }
+
+            k = 0;
+            for (auto q { 0 }; q < n; ++q) {
+                while (z[k + 1] < static_cast<float>(q)) {
+                    ++k;
+                }
+                const auto dq { static_cast<float>(q - v[k]) };
+                d[q] = dq * dq + f[v[k]];
             }
         }
+    }
 
-        // Then block entities with PathBlocker components
-        world.each([](const Collider& blocker, const WorldTransform& transform) {
-            block_object(transform.pos, blocker.radius);
-        });
+    void update_clearance(int x0, int z0, int x1, int z1) {
+        x0 = std::max(x0, 0);
+        z0 = std::max(z0, 0);
+        x1 = std::min(x1, GRID_SIZE);
+        z1 = std::min(z1, GRID_SIZE);
+        if (x0 >= x1 || z0 >= z1) {
+            return;
+        }
+
+        // Every blocked tile within MAX_CLEARANCE of the region lies inside the window, tiles
+        // further away can only raise a distance that gets capped anyway
+        const auto wx0 { std::max(x0 - MAX_CLEARANCE, 0) };
+        const auto wz0 { std::max(z0 - MAX_CLEARANCE, 0) };
+        const auto wx1 { std::min(x1 + MAX_CLEARANCE, GRID_SIZE) };
+        const auto wz1 { std::min(z1 + MAX_CLEARANCE, GRID_SIZE) };
+        const auto width { wx1 - wx0 };
+        const auto height { wz1 - wz0 };
+        const auto longest { std::max(width, height) };
+
+        auto &arena { memory::tick_arena() };
+        memory::ArenaVector<float> columns(static_cast<size_t>(width) * height, arena);
+        memory::ArenaVector<float> f(longest, arena);
+        memory::ArenaVector<float> d(longest, arena);
+        memory::ArenaVector<int> v(longest, arena);
+        memory::ArenaVector<float> z(longest + 1, arena);
+
+        for (auto x { 0 }; x < width; ++x) {
+            for (auto y { 0 }; y < height; ++y) {
+                f[y] = walkable[coords_to_index(wx0 + x, wz0 + y)] ? FAR : 0.0f;
+            }
+
+            distance_transform(f.data(), d.data(), height, v.data(), z.data());
+            for (auto y { 0 }; y < height; ++y) {
+                columns[static_cast<size_t>(y) * width + x] = d[y];
+            }
+        }
+
+        for (auto y { z0 - wz0 }; y < z1 - wz0; ++y) {
+            distance_transform(&columns[static_cast<size_t>(y) * width], d.data(), width, v.data(), z.data());
+            for (auto x { x0 - wx0 }; x < x1 - wx0; ++x) {
+                clearance[coords_to_index(wx0 + x, wz0 + y)] = std::min(std::sqrt(d[x]), static_cast<float>(MAX_CLEARANCE));
+            }
+        }
+
+        for (auto &table : jump_tables) {
+            if (table) {
+                table->invalidate(x0, z0, x1, z1);
+            }
+        }
     }
 
     bool is_position_walkable(const Vector3& world_pos) {
@@ -91,7 +210,14 @@ namespace terrain {
             {1, 1}, {1, -1}, {-1, 1}, {-1, -1} // Diagonal
         };
 
+        int radius;
+
     public:
+        // Nodes expanded, micropather asks for the neighbours of each one once until it is reset
+        int expanded { 0 };
+
+        explicit GridGraph(const int radius) : radius(radius) {}
+
         float LeastCostEstimate(void* state1, void* state2) override {
             auto [x1, y1] { index_to_coords(reinterpret_cast<uintptr_t>(state1)) };
             auto [x2, y2] { index_to_coords(reinterpret_cast<uintptr_t>(state2)) };
@@ -103,12 +229,13 @@ namespace terrain {
 
         void AdjacentCost(void* state, micropather::MPVector<micropather::StateCost>* adjacent) override {
             auto [x, y] { index_to_coords(reinterpret_cast<uintptr_t>(state)) };
+            ++expanded;
 
             for (const auto& [dx, dy] : directions) {
                 const auto nx { x + dx };
                 const auto ny { y + dy };
 
-                if (is_walkable(nx, ny)) {
+                if (is_passable(nx, ny, radius)) {
                     const auto next_state = reinterpret_cast<void*>(coords_to_index(nx, ny));
                     const auto cost = (dx != 0 && dy != 0) ? 1.414f : 1.0f;
                     adjacent->push_back({next_state, cost});
@@ -119,12 +246,251 @@ namespace terrain {
         void PrintStateInfo(void*) override {}
     };
 
-    // Static pathfinding objects
-    static GridGraph graph;
-    static micropather::MicroPather pather(&graph, 10000);
+    // One graph per agent size, micropather caches solutions per graph
+    struct Pather {
+        GridGraph graph;
+        micropather::MicroPather pather;
+
+        explicit Pather(const int radius) : graph(radius), pather(&graph, 10000) {}
+    };
+
+    static std::unique_ptr<Pather> pathers[MAX_CLEARANCE];
+
+    static Pather& pather_for(const int radius) {
+        auto &pather { pathers[radius] };
+        if (!pather) {
+            pather = std::make_unique<Pather>(radius);
+        }
+        return *pather;
+    }
+
+    static JumpTable& jump_table_for(const int radius) {
+        auto &table { jump_tables[radius] };
+        if (!table) {
+            table = std::make_unique<JumpTable>(radius);
+        }
+        return *table;
+    }
+
+    void set_path_solver(const PathSolver path_solver) {
+        solver = path_solver;
+    }
+
+    PathSolver get_path_solver() {
+        return solver;
+    }
+
+    PathStats last_path_stats() {
+        std::lock_guard lock { stats_mutex };
+        return stats;
+    }
+
+    // Cached solutions may run through tiles that just got blocked
+    static void reset_pathers() {
+        for (auto &pather : pathers) {
+            if (pather) {
+                pather->pather.Reset();
+            }
+        }
+    }
+
+    void reset_path_cache() {
+        reset_pathers();
+    }
+
+    void rebuild_clearance() {
+        update_clearance(0, 0, GRID_SIZE, GRID_SIZE);
+        reset_pathers();
+    }
+
+    // Walkable as far as the colliders go, terrain edits start from it so they don't need the ECS
+    static std::vector<bool> object_walkable(GRID_SIZE * GRID_SIZE, true);
+
+    auto grid_memory() -> size_t {
+        const auto bits { walkable.capacity() + object_walkable.capacity() };
+        return (bits + 7) / 8 + clearance.capacity() * sizeof(float);
+    }
+
+    // Blocks terrain-based obstacles (water, etc.) in [x0, x1) x [z0, z1), sampled a grid row at a time
+    static void block_ground(const int x0, const int z0, const int x1, const int z1) {
+        const auto width { static_cast<size_t>(x1 - x0) };
+        auto &arena { memory::tick_arena() };
+        memory::ArenaVector<float> xs(width, arena);
+        memory::ArenaVector<float> zs(width, arena);
+        memory::ArenaVector<float> heights(width, arena);
+
+        for (auto gx { x0 }; gx < x1; ++gx) {
+            xs[gx - x0] = grid_to_world(static_cast<float>(gx));
+        }
+
+        for (auto gz { z0 }; gz < z1; ++gz) {
+            std::fill(zs.begin(), zs.end(), grid_to_world(static_cast<float>(gz)));
+            get_heights(xs.data(), zs.data(), heights.data(), width);
+
+            for (auto gx { x0 }; gx < x1; ++gx) {
+                if (heights[gx - x0] <= -0.4f) {
+                    block_tile(gx, gz);
+                }
+            }
+        }
+    }
+
+    // Tiles a collider blocks, as block_object stamps them. Absent colliders have no entity.
+    struct Footprint {
+        flecs::entity_t entity;
+        int x, z, radius;
+
+        auto operator<(const Footprint &other) const -> bool {
+            return std::tie(entity, x, z, radius) < std::tie(other.entity, other.x, other.z, other.radius);
+        }
+    };
+
+    static auto footprint(const flecs::entity_t entity, const Vector3 &pos, const float radius) -> Footprint {
+        const auto [x, z] { world_to_grid_coords(pos) };
+        return { entity, x, z, static_cast<int>(std::ceil(radius * GRID_DETAIL)) };
+    }
+
+    // Footprints of the last update, sorted, the next one only touches the blocks where they differ
+    static std::vector<Footprint> previous_footprints;
+    static bool grid_invalid { true };
+
+    void invalidate_collision_grid() {
+        grid_invalid = true;
+    }
+
+    void update_collision_entities(const flecs::world& world, const std::vector<Blocker>& absent) {
+        auto &arena { memory::tick_arena() };
+        memory::ArenaVector<Footprint> footprints(arena);
+
+        world.each([&footprints](const flecs::entity entity, const Collider& blocker, const WorldTransform& transform) {
+            footprints.push_back(footprint(entity.id(), transform.pos, blocker.radius));
+        });
+        for (const auto &blocker : absent) {
+            footprints.push_back(footprint(0, blocker.pos, blocker.radius));
+        }
+        std::sort(footprints.begin(), footprints.end());
+
+        // Colliders that were added, moved or removed mark the clearance blocks they cover
+        constexpr int blocks { (GRID_SIZE + CLEARANCE_BLOCK - 1) / CLEARANCE_BLOCK };
+        bool dirty[blocks * blocks] {};
+
+        if (grid_invalid) {
+            std::fill(std::begin(dirty), std::end(dirty), true);
+            grid_invalid = false;
+        } else {
+            memory::ArenaVector<Footprint> differing(arena);
+            std::set_symmetric_difference(footprints.begin(), footprints.end(),
+                previous_footprints.begin(), previous_footprints.end(), std::back_inserter(differing));
+
+            for (const auto &changed_footprint : differing) {
+                const auto bx0 { std::clamp(changed_footprint.x - changed_footprint.radius, 0, GRID_SIZE - 1) / CLEARANCE_BLOCK };
+                const auto bz0 { std::clamp(changed_footprint.z - changed_footprint.radius, 0, GRID_SIZE - 1) / CLEARANCE_BLOCK };
+                const auto bx1 { std::clamp(changed_footprint.x + changed_footprint.radius, 0, GRID_SIZE - 1) / CLEARANCE_BLOCK };
+                const auto bz1 { std::clamp(changed_footprint.z + changed_footprint.radius, 0, GRID_SIZE - 1) / CLEARANCE_BLOCK };
+                for (auto bz { bz0 }; bz <= bz1; ++bz) {
+                    for (auto bx { bx0 }; bx <= bx1; ++bx) {
+                        dirty[bz * blocks + bx] = true;
+                    }
+                }
+            }
+        }
+
+        previous_footprints.assign(footprints.begin(), footprints.end());
+
+        // Walkability is rebuilt inside each dirty block from the colliders overlapping it and the
+        // ground, clearance around it only when a tile actually flipped
+        memory::ArenaVector<uint8_t> before(CLEARANCE_BLOCK * CLEARANCE_BLOCK, arena);
+        auto changed { false };
+
+        for (auto block { 0 }; block < blocks * blocks; ++block) {
+            if (!dirty[block]) {
+                continue;
+            }
+
+            const auto x0 { (block % blocks) * CLEARANCE_BLOCK };
+            const auto z0 { (block / blocks) * CLEARANCE_BLOCK };
+            const auto x1 { std::min(x0 + CLEARANCE_BLOCK, GRID_SIZE) };
+            const auto z1 { std::min(z0 + CLEARANCE_BLOCK, GRID_SIZE) };
+
+            for (auto gz { z0 }; gz < z1; ++gz) {
+                for (auto gx { x0 }; gx < x1; ++gx) {
+                    const auto i { coords_to_index(gx, gz) };
+                    before[(gz - z0) * CLEARANCE_BLOCK + (gx - x0)] = walkable[i];
+                    walkable[i] = true;
+                }
+            }
+
+            for (const auto &collider : footprints) {
+                const auto r2 { collider.radius * collider.radius };
+                const auto tx0 { std::max(collider.x - collider.radius, x0) };
+                const auto tz0 { std::max(collider.z - collider.radius, z0) };
+                const auto tx1 { std::min(collider.x + collider.radius + 1, x1) };
+                const auto tz1 { std::min(collider.z + collider.radius + 1, z1) };
+
+                for (auto gz { tz0 }; gz < tz1; ++gz) {
+                    for (auto gx { tx0 }; gx < tx1; ++gx) {
+                        const auto dx { gx - collider.x };
+                        const auto dz { gz - collider.z };
+                        if (dx * dx + dz * dz <= r2) {
+                            walkable[coords_to_index(gx, gz)] = false;
+                        }
+                    }
+                }
+            }
+
+            for (auto gz { z0 }; gz < z1; ++gz) {
+                for (auto gx { x0 }; gx < x1; ++gx) {
+                    const auto i { coords_to_index(gx, gz) };
+                    object_walkable[i] = walkable[i];
+                }
+            }
+
+            block_ground(x0, z0, x1, z1);
 
-    // Helper function to find nearest walkable point to target
-    std::pair<int, int> find_nearest_walkable(const int target_x, const int target_z, const int max_radius = 50) {
+            auto flipped { false };
+            for (auto gz { z0 }; gz < z1 && !flipped; ++gz) {
+                for (auto gx { x0 }; gx < x1; ++gx) {
+                    if (walkable[coords_to_index(gx, gz)] != static_cast<bool>(before[(gz - z0) * CLEARANCE_BLOCK + (gx - x0)])) {
+                        flipped = true;
+                        break;
+                    }
+                }
+            }
+
+            if (flipped) {
+                update_clearance(x0 - MAX_CLEARANCE, z0 - MAX_CLEARANCE, x1 + MAX_CLEARANCE, z1 + MAX_CLEARANCE);
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            reset_pathers();
+        }
+    }
+
+    void update_ground_tiles(int x0, int z0, int x1, int z1) {
+        x0 = std::max(x0, 0);
+        z0 = std::max(z0, 0);
+        x1 = std::min(x1, GRID_SIZE);
+        z1 = std::min(z1, GRID_SIZE);
+        if (x0 >= x1 || z0 >= z1) {
+            return;
+        }
+
+        for (auto gz { z0 }; gz < z1; ++gz) {
+            for (auto gx { x0 }; gx < x1; ++gx) {
+                const auto i { coords_to_index(gx, gz) };
+                walkable[i] = object_walkable[i];
+            }
+        }
+
+        block_ground(x0, z0, x1, z1);
+        update_clearance(x0 - MAX_CLEARANCE, z0 - MAX_CLEARANCE, x1 + MAX_CLEARANCE, z1 + MAX_CLEARANCE);
+        reset_pathers();
+    }
+
+    // Helper function to find nearest point to target an agent of the given size in tiles fits on
+    std::pair<int, int> find_nearest_walkable(const int target_x, const int target_z, const int tiles, const int max_radius = 50) {
         for (auto radius { 1 }; radius <= max_radius; ++radius) {
             for (auto dz { -radius }; dz <= radius; ++dz) {
                 for (auto dx { -radius }; dx <= radius; ++dx) {
@@ -132,7 +498,7 @@ namespace terrain {
                         const auto x { target_x + dx };
                         const auto z { target_z + dz };
 
-                        if (is_walkable(x, z)) {
+                        if (is_passable(x, z, tiles)) {
                             return {x, z};
                         }
                     }
@@ -143,7 +509,8 @@ namespace terrain {
         return {-1, -1}; // Nothing better found
     }
 
-    bool has_line_of_sight(const Vector3& from, const Vector3& to) {
+    bool has_line_of_sight(const Vector3& from, const Vector3& to, const float radius) {
+        const auto tiles { radius_to_tiles(radius) };
         const auto [from_x, from_z] { world_to_grid_coords(from) };
         const auto [to_x, to_z] { world_to_grid_coords(to) };
 
@@ -152,42 +519,41 @@ namespace terrain {
         int err = dx - dy, x = from_x, y = from_z;
 
         while (x != to_x || y != to_z) {
-            if (!is_walkable(x, y)) return false;
+            if (!is_passable(x, y, tiles)) return false;
 
             int e2 = 2 * err;
             if (e2 > -dy) { err -= dy; x += sx; }
             if (e2 < dx) { err += dx; y += sy; }
         }
 
-        return is_walkable(to_x, to_z);
+        return is_passable(to_x, to_z, tiles);
     }
 
-    void smooth_path(std::vector<Vector3>& path) {
+    // Compacts in place, the write index never passes the point being read
+    void smooth_path(memory::PoolVector<Vector3>& path, const float radius) {
         if (path.size() < 3) return;
 
-        std::vector<Vector3> smoothed;
-        smoothed.push_back(path[0]);
-
+        size_t written = 1;
         size_t current = 0;
         while (current < path.size() - 1) {
             size_t farthest = current + 1;
 
             for (size_t i = current + 2; i < path.size(); ++i) {
-                if (has_line_of_sight(path[current], path[i])) {
+                if (has_line_of_sight(path[current], path[i], radius)) {
                     farthest = i;
                 }
             }
 
-            smoothed.push_back(path[farthest]);
+            path[written++] = path[farthest];
             current = farthest;
         }
 
-        path = std::move(smoothed);
+        path.resize(written);
     }
 
-    void find_path(const Vector3 start, const Vector3 end, std::vector<Vector3>& path) {
-        const auto start_x { static_cast<int>(std::round(world_to_grid(start.x))) };
-        const auto start_z { static_cast<int>(std::round(world_to_grid(start.z))) };
+    void find_path(const Vector3 start, const Vector3 end, memory::PoolVector<Vector3>& path, const float radius) {
+        auto start_x { static_cast<int>(std::round(world_to_grid(start.x))) };
+        auto start_z { static_cast<int>(std::round(world_to_grid(start.z))) };
         auto end_x { static_cast<int>(std::round(world_to_grid(end.x))) };
         auto end_z { static_cast<int>(std::round(world_to_grid(end.z))) };
 
@@ -195,41 +561,87 @@ namespace terrain {
             return;
         }
 
-        if (!is_walkable(end_x, end_z)) {
-            auto [new_x, new_z] = find_nearest_walkable(end_x, end_z);
+        const auto tiles { radius_to_tiles(radius) };
+
+        // An agent wedged in somewhere narrower than itself first steps out to the nearest tile it fits on
+        if (!is_passable(start_x, start_z, tiles)) {
+            auto [new_x, new_z] = find_nearest_walkable(start_x, start_z, tiles);
+            if (new_x == -1) return;
+
+            start_x = new_x;
+            start_z = new_z;
+        }
+
+        if (!is_passable(end_x, end_z, tiles)) {
+            auto [new_x, new_z] = find_nearest_walkable(end_x, end_z, tiles);
             if (new_x == -1) return;
 
             end_x = new_x;
             end_z = new_z;
         }
 
-        const auto start_state { reinterpret_cast<void*>(coords_to_index(start_x, start_z)) };
-        const auto end_state { reinterpret_cast<void*>(coords_to_index(end_x, end_z)) };
+        const auto start_index { coords_to_index(start_x, start_z) };
+        const auto end_index { coords_to_index(end_x, end_z) };
+        if (start_index == end_index) {
+            return;
+        }
+
+        // Solve path, the solution keeps its capacity between calls
+        static micropather::MPVector<void*> solution;
+        static std::vector<int> jump_points;
+
+        const auto solve { [&](const int size) {
+            const auto solve_start { std::chrono::steady_clock::now() };
+            PathStats solve_stats { .solver = solver };
+            auto solved { false };
 
-        // Solve path
-        micropather::MPVector<void*> solution;
-        float total_cost;
+            if (solver == PathSolver::JumpPoint) {
+                auto &table { jump_table_for(size) };
+                solved = table.search(start_index, end_index, jump_points);
+                solve_stats.expanded = table.expanded();
 
-        const auto result { pather.Solve(start_state, end_state, &solution, &total_cost) };
-        if (result != micropather::MicroPather::SOLVED) {
+                solution.clear();
+                for (const auto tile : jump_points) {
+                    solution.push_back(reinterpret_cast<void*>(static_cast<uintptr_t>(tile)));
+                }
+            } else {
+                auto &pather { pather_for(size) };
+                float total_cost;
+                pather.graph.expanded = 0;
+                solved = pather.pather.Solve(reinterpret_cast<void*>(start_index), reinterpret_cast<void*>(end_index), &solution, &total_cost) == micropather::MicroPather::SOLVED;
+                solve_stats.expanded = pather.graph.expanded;
+            }
+
+            solve_stats.solve_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - solve_start).count();
+
+            std::lock_guard lock { stats_mutex };
+            stats = solve_stats;
+            return solved;
+        } };
+
+        // No fallback to a narrower grid, the agent would squeeze through gaps it does not fit in
+        if (!solve(tiles)) {
             return;
         }
 
-        path.reserve(solution.size());
+        auto &arena { memory::tick_arena() };
+        memory::ArenaVector<float> xs(solution.size(), arena);
+        memory::ArenaVector<float> zs(solution.size(), arena);
+        memory::ArenaVector<float> heights(solution.size(), arena);
 
         for (size_t i { 0 }; i < solution.size(); ++i) {
             auto [x, z] = index_to_coords(reinterpret_cast<uintptr_t>(solution[i]));
+            xs[i] = grid_to_world(static_cast<float>(x));
+            zs[i] = grid_to_world(static_cast<float>(z));
+        }
 
-            Vector3 world_pos = {
-                grid_to_world(static_cast<float>(x)),
-                0.0f,
-                grid_to_world(static_cast<float>(z))
-            };
+        get_heights(xs.data(), zs.data(), heights.data(), solution.size());
 
-            world_pos.y = get_height(world_pos.x, world_pos.z);
-            path.push_back(world_pos);
+        path.reserve(solution.size());
+        for (size_t i { 0 }; i < solution.size(); ++i) {
+            path.push_back({ xs[i], heights[i], zs[i] });
         }
 
-        smooth_path(path);
+        smooth_path(path, radius);
     }
 }
\ No newline at end of file
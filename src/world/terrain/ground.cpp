@@ -2,8 +2,10 @@
 #include "terrain.h"
 
 #include "game.h"
-#include "util.h"
+#include "assets/assets.h"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <raylib.h>
 #include <raymath.h>
@@ -13,8 +15,16 @@
 constexpr float SCALE { 5.0f };
 constexpr float FREQUENCY { 0.1f };
 
+constexpr int GROUND_CHUNKS_PER_ROW { (DETAILED_SIZE - 1 + GROUND_CHUNK_SIZE - 1) / GROUND_CHUNK_SIZE };
+
+// Vertex buffers UploadMesh fills, by attribute location
+constexpr int GROUND_BUFFER_POSITIONS { 0 };
+constexpr int GROUND_BUFFER_NORMALS { 2 };
+constexpr int GROUND_BUFFER_MORPHS { 5 };
+
 namespace terrain {
-    std::vector<float> elevation(DETAILED_SIZE * DETAILED_SIZE);
+    Heightfield elevation(DETAILED_SIZE);
+    std::vector<float> height_planes(HEIGHT_CELLS * HEIGHT_CELLS * 6);
 
 
     inline auto world_to_terrain_index(const float world_x, const float world_z) -> int {
@@ -35,11 +45,11 @@ namespace terrain {
     }
 
     // Calculate the normal for a vertex in the terrain
-    Vector3 calculate_normal(const std::vector<float>& heights, const int x, const int z) {
-        const auto hL { (x > 0) ? heights[z * DETAILED_SIZE + (x - 1)] : heights[z * DETAILED_SIZE + x] };
-        const auto hR { (x < DETAILED_SIZE - 1) ? heights[z * DETAILED_SIZE + (x + 1)] : heights[z * DETAILED_SIZE + x] };
-        const auto hD { (z > 0) ? heights[(z - 1) * DETAILED_SIZE + x] : heights[z * DETAILED_SIZE + x] };
-        const auto hU { (z < DETAILED_SIZE - 1) ? heights[(z + 1) * DETAILED_SIZE + x] : heights[z * DETAILED_SIZE + x] };
+    Vector3 calculate_normal(const Heightfield& heights, const int x, const int z) {
+        const auto hL { heights.get(std::max(x - 1, 0), z) };
+        const auto hR { heights.get(std::min(x + 1, DETAILED_SIZE - 1), z) };
+        const auto hD { heights.get(x, std::max(z - 1, 0)) };
+        const auto hU { heights.get(x, std::min(z + 1, DETAILED_SIZE - 1)) };
 
         const auto dx { (hR - hL) * DETAIL };
         const auto dz { (hU - hD) * DETAIL };
@@ -51,65 +61,117 @@ namespace terrain {
     }
 
 
-    // Generate the terrain
-    void generate_ground(const World& world) {
-        FastNoiseLite noise;
-        noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-        noise.SetSeed(util::GetRandomInt(0, 10000));
-        noise.SetFrequency(FREQUENCY);
+    // Elevation with coordinates clamped to the terrain, chunks past the last row repeat it
+    auto sample_height(const int x, const int z) -> float {
+        const auto cx { std::clamp(x, 0, DETAILED_SIZE - 1) };
+        const auto cz { std::clamp(z, 0, DETAILED_SIZE - 1) };
+        return elevation.get(cx, cz);
+    }
 
-        for (auto z { 0 }; z < DETAILED_SIZE; ++z) {
-            for (auto x { 0 }; x < DETAILED_SIZE; ++x) {
-                const auto index { z * DETAILED_SIZE + x };
-                const auto noiseValue { noise.GetNoise(static_cast<float>(x) / DETAIL, static_cast<float>(z) / DETAIL) };
-                const auto distance { Vector2Distance(
-                    Vector2 { WORLD_CENTER, WORLD_CENTER },
-                    Vector2 { static_cast<float>(x) / static_cast<float>(DETAIL), static_cast<float>(z) / static_cast<float>(DETAIL) }
-                ) };
+    // Height of the next coarser level at a vertex of the given level. Cells are split along
+    // the top-right/bottom-left diagonal on every level, so a fully morphed vertex lands
+    // exactly on the coarse surface.
+    auto coarse_height(const int x, const int z, const int level) -> float {
+        const auto step { 1 << level };
+        const auto odd_x { (x / step) % 2 != 0 };
+        const auto odd_z { (z / step) % 2 != 0 };
+
+        if (odd_x && odd_z) {
+            return (sample_height(x + step, z - step) + sample_height(x - step, z + step)) * 0.5f;
+        }
+        if (odd_x) {
+            return (sample_height(x - step, z) + sample_height(x + step, z)) * 0.5f;
+        }
+        if (odd_z) {
+            return (sample_height(x, z - step) + sample_height(x, z + step)) * 0.5f;
+        }
+
+        return sample_height(x, z);
+    }
+
+    // Position, morph target height and normal of one chunk vertex, the parts a terrain edit changes
+    void write_chunk_vertex(const int x, const int z, const int level, float *vertex, float *morph, float *normal) {
+        const auto cx { std::min(x, DETAILED_SIZE - 1) };
+        const auto cz { std::min(z, DETAILED_SIZE - 1) };
+
+        vertex[0] = terrain_to_world(static_cast<float>(cx));
+        vertex[1] = sample_height(x, z);
+        vertex[2] = terrain_to_world(static_cast<float>(cz));
+
+        // Morph target height, the vertex shader blends towards it by distance
+        morph[0] = level < GROUND_LOD_LEVELS - 1 ? coarse_height(x, z, level) : sample_height(x, z);
+        morph[1] = 0.0f;
+
+        const auto n { calculate_normal(elevation, cx, cz) };
+        normal[0] = n.x;
+        normal[1] = n.y;
+        normal[2] = n.z;
+    }
 
-                elevation[index] = (noiseValue + 1.0f) * 0.5f;
-                elevation[index] -= distance / (static_cast<float>(WORLD_SIZE) * 0.5f);
-                elevation[index] *= SCALE;
+    auto chunk_bounds(const int x0, const int z0) -> BoundingBox {
+        auto min_height { sample_height(x0, z0) };
+        auto max_height { min_height };
+
+        // Morph targets are averages of these samples, so they stay within the bounds too
+        for (auto z { z0 }; z <= z0 + GROUND_CHUNK_SIZE; ++z) {
+            for (auto x { x0 }; x <= x0 + GROUND_CHUNK_SIZE; ++x) {
+                min_height = std::min(min_height, sample_height(x, z));
+                max_height = std::max(max_height, sample_height(x, z));
             }
         }
 
-        constexpr auto vertex_count { DETAILED_SIZE * DETAILED_SIZE };
-        constexpr auto triangle_count { (DETAILED_SIZE - 1) * (DETAILED_SIZE - 1) * 2 };
+        return {
+            .min { terrain_to_world(static_cast<float>(x0)), min_height, terrain_to_world(static_cast<float>(z0)) },
+            .max { terrain_to_world(static_cast<float>(x0 + GROUND_CHUNK_SIZE)), max_height, terrain_to_world(static_cast<float>(z0 + GROUND_CHUNK_SIZE)) },
+        };
+    }
+
+    auto generate_chunk_mesh(const int x0, const int z0, const int level) -> Mesh {
+        const auto step { 1 << level };
+        const auto size { GROUND_CHUNK_SIZE / step + 1 };
+        const auto vertex_count { size * size };
+        const auto triangle_count { (size - 1) * (size - 1) * 2 };
+
+        std::vector<float> vertices(vertex_count * 3);
+        std::vector<float> texcoords(vertex_count * 2);
+        std::vector<float> texcoords2(vertex_count * 2);
+        std::vector<float> normals(vertex_count * 3);
+        // DrawMesh only takes the indexed path while the mesh has CPU indices, so they are owned
+        // by the mesh and freed with it by UnloadMesh
+        auto *indices { static_cast<unsigned short*>(MemAlloc(static_cast<unsigned int>(triangle_count * 3 * sizeof(unsigned short)))) };
 
         Mesh mesh {
             .vertexCount { vertex_count },
             .triangleCount { triangle_count },
-            .vertices { new float[vertex_count * 3] },
-            .texcoords { new float[vertex_count * 2] },
-            .normals { new float[vertex_count * 3] },
-            .indices { new unsigned short[triangle_count * 3] },
+            .vertices { vertices.data() },
+            .texcoords { texcoords.data() },
+            .texcoords2 { texcoords2.data() },
+            .normals { normals.data() },
+            .indices { indices },
         };
 
-        for (auto z { 0 }; z < DETAILED_SIZE; ++z) {
-            for (auto x { 0 }; x < DETAILED_SIZE; ++x) {
-                const auto index { z * DETAILED_SIZE + x };
-
-                mesh.vertices[index * 3] = terrain_to_world(static_cast<float>(x));
-                mesh.vertices[index * 3 + 1] = elevation[index];
-                mesh.vertices[index * 3 + 2] = terrain_to_world(static_cast<float>(z));
+        for (auto j { 0 }; j < size; ++j) {
+            for (auto i { 0 }; i < size; ++i) {
+                const auto index { j * size + i };
+                const auto x { x0 + i * step };
+                const auto z { z0 + j * step };
+                const auto cx { std::min(x, DETAILED_SIZE - 1) };
+                const auto cz { std::min(z, DETAILED_SIZE - 1) };
 
-                mesh.texcoords[index * 2] = static_cast<float>(x) / (DETAILED_SIZE - 1);
-                mesh.texcoords[index * 2 + 1] = static_cast<float>(z) / (DETAILED_SIZE - 1);
+                write_chunk_vertex(x, z, level, &mesh.vertices[index * 3], &mesh.texcoords2[index * 2], &mesh.normals[index * 3]);
 
-                const auto normal { calculate_normal(elevation, x, z) };
-                mesh.normals[index * 3] = normal.x;
-                mesh.normals[index * 3 + 1] = normal.y;
-                mesh.normals[index * 3 + 2] = normal.z;
+                mesh.texcoords[index * 2] = static_cast<float>(cx) / (DETAILED_SIZE - 1);
+                mesh.texcoords[index * 2 + 1] = static_cast<float>(cz) / (DETAILED_SIZE - 1);
             }
         }
 
         auto indexCount { 0 };
-        for (auto z { 0 }; z < DETAILED_SIZE - 1; ++z) {
-            for (auto x { 0 }; x < DETAILED_SIZE - 1; ++x) {
-                const auto top_left { z * DETAILED_SIZE + x };
-                const auto top_right { z * DETAILED_SIZE + (x + 1) };
-                const auto bottom_left { (z + 1) * DETAILED_SIZE + x };
-                const auto bottom_right { (z + 1) * DETAILED_SIZE + (x + 1) };
+        for (auto z { 0 }; z < size - 1; ++z) {
+            for (auto x { 0 }; x < size - 1; ++x) {
+                const auto top_left { z * size + x };
+                const auto top_right { z * size + (x + 1) };
+                const auto bottom_left { (z + 1) * size + x };
+                const auto bottom_right { (z + 1) * size + (x + 1) };
 
                 mesh.indices[indexCount++] = top_left;
                 mesh.indices[indexCount++] = bottom_left;
@@ -123,42 +185,219 @@ namespace terrain {
 
         UploadMesh(&mesh, false);
 
-        auto ground_model { LoadModelFromMesh(mesh) };
+        // Only the GPU copy of the vertices is drawn, the heightfield stays the CPU side source of truth
+        mesh.vertices = nullptr;
+        mesh.texcoords = nullptr;
+        mesh.texcoords2 = nullptr;
+        mesh.normals = nullptr;
+        return mesh;
+    }
 
-        const auto ground_shader { world.ecs.get<GroundShader>() };
-        auto ground_texture { LoadTexture(ASSET_PATH("textures/grass.jpg")) };
-        auto coast_texture { LoadTexture(ASSET_PATH("textures/sand.jpg")) };
+    // Level of detail for a chunk, picked by the horizontal distance from the camera to the chunk
+    auto ground_lod(const BoundingBox &bounds, const Vector3 &camera_pos) -> int {
+        const auto dx { std::max({ bounds.min.x - camera_pos.x, 0.0f, camera_pos.x - bounds.max.x }) };
+        const auto dz { std::max({ bounds.min.z - camera_pos.z, 0.0f, camera_pos.z - bounds.max.z }) };
+        const auto distance { std::sqrt(dx * dx + dz * dz) };
 
-        SetTextureWrap(coast_texture, TEXTURE_WRAP_MIRROR_REPEAT);
-        SetTextureWrap(ground_texture, TEXTURE_WRAP_MIRROR_REPEAT);
+        for (auto level { 0 }; level < GROUND_LOD_LEVELS - 1; ++level) {
+            if (distance <= GROUND_LOD_MORPH[level].y) {
+                return level;
+            }
+        }
 
-        GenTextureMipmaps(&ground_texture);
-        GenTextureMipmaps(&coast_texture);
-        SetTextureFilter(ground_texture, TEXTURE_FILTER_TRILINEAR);
-        SetTextureFilter(coast_texture, TEXTURE_FILTER_TRILINEAR);
+        return GROUND_LOD_LEVELS - 1;
+    }
 
-        ground_model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = ground_texture;
-        ground_model.materials[0].maps[MATERIAL_MAP_SPECULAR].texture = coast_texture;
+    // Generate the height field
+    void generate_elevation(const int seed) {
+        std::vector<float> heights(DETAILED_SIZE * DETAILED_SIZE);
+        FastNoiseLite noise;
+        noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+        noise.SetSeed(seed);
+        noise.SetFrequency(FREQUENCY);
+
+        for (auto z { 0 }; z < DETAILED_SIZE; ++z) {
+            for (auto x { 0 }; x < DETAILED_SIZE; ++x) {
+                const auto index { z * DETAILED_SIZE + x };
+                const auto noiseValue { noise.GetNoise(static_cast<float>(x) / DETAIL, static_cast<float>(z) / DETAIL) };
+                const auto distance { Vector2Distance(
+                    Vector2 { WORLD_CENTER, WORLD_CENTER },
+                    Vector2 { static_cast<float>(x) / static_cast<float>(DETAIL), static_cast<float>(z) / static_cast<float>(DETAIL) }
+                ) };
+
+                heights[index] = (noiseValue + 1.0f) * 0.5f;
+                heights[index] -= distance / (static_cast<float>(WORLD_SIZE) * 0.5f);
+                heights[index] *= SCALE;
+            }
+        }
+
+        elevation.quantize(heights, SCALE);
+        update_height_planes(0, 0, HEIGHT_CELLS, HEIGHT_CELLS);
+        invalidate_collision_grid();
+    }
+
+    auto ground_mesh_memory() -> MeshMemory {
+        MeshMemory memory {};
+        const auto chunks { static_cast<size_t>(GROUND_CHUNKS_PER_ROW * GROUND_CHUNKS_PER_ROW) };
+
+        for (auto level { 0 }; level < GROUND_LOD_LEVELS; ++level) {
+            const auto size { static_cast<size_t>(GROUND_CHUNK_SIZE / (1 << level) + 1) };
+            // Positions, normals, texcoords and morph targets, as generate_chunk_mesh fills them
+            memory.attributes += chunks * size * size * 10 * sizeof(float);
+            memory.indices += chunks * (size - 1) * (size - 1) * 6 * sizeof(unsigned short);
+        }
+
+        return memory;
+    }
+
+    // Generate the terrain
+    void generate_ground(const World& world) {
+        // One mesh per chunk and level of detail
+        std::vector<Mesh> meshes;
+        std::vector<GroundChunk> chunks;
+        int lod_vertices[GROUND_LOD_LEVELS] {};
+
+        for (auto z0 { 0 }; z0 < DETAILED_SIZE - 1; z0 += GROUND_CHUNK_SIZE) {
+            for (auto x0 { 0 }; x0 < DETAILED_SIZE - 1; x0 += GROUND_CHUNK_SIZE) {
+                GroundChunk chunk {};
+
+                for (auto level { 0 }; level < GROUND_LOD_LEVELS; ++level) {
+                    chunk.meshes[level] = static_cast<int>(meshes.size());
+                    meshes.push_back(generate_chunk_mesh(x0, z0, level));
+                    lod_vertices[level] += meshes.back().vertexCount;
+                }
+
+                chunk.bounds = chunk_bounds(x0, z0);
+                chunks.push_back(chunk);
+            }
+        }
+
+        Model ground_model {};
+        ground_model.transform = MatrixIdentity();
+        ground_model.meshCount = static_cast<int>(meshes.size());
+        ground_model.meshes = static_cast<Mesh*>(MemAlloc(meshes.size() * sizeof(Mesh)));
+        ground_model.materialCount = 1;
+        ground_model.materials = static_cast<Material*>(MemAlloc(sizeof(Material)));
+        ground_model.materials[0] = LoadMaterialDefault();
+        ground_model.meshMaterial = static_cast<int*>(MemAlloc(meshes.size() * sizeof(int)));
+        std::copy(meshes.begin(), meshes.end(), ground_model.meshes);
+
+        TraceLog(LOG_INFO, "GROUND: %d chunks, %d/%d/%d vertices per level (single mesh %d vertices)",
+            static_cast<int>(chunks.size()), lod_vertices[0], lod_vertices[1], lod_vertices[2], DETAILED_SIZE * DETAILED_SIZE);
+        TraceLog(LOG_INFO, "GROUND: heightfield %.1f KB (%.1f KB as floats), cell planes %.1f KB, CPU vertex arrays released after upload",
+            static_cast<double>(elevation.memory()) / 1024.0,
+            static_cast<double>(DETAILED_SIZE * DETAILED_SIZE * sizeof(float)) / 1024.0,
+            static_cast<double>(height_planes.size() * sizeof(float)) / 1024.0);
 
-        ground_model.materials[0].shader = ground_shader->shader;
         world.ecs.set<WorldGround>({
             .model { ground_model },
+            .chunks { chunks },
+        });
+
+        constexpr assets::TextureOptions texture_options {
+            .mipmaps = true,
+            .filter = TEXTURE_FILTER_TRILINEAR,
+            .wrap = TEXTURE_WRAP_MIRROR_REPEAT,
+        };
+
+        assets::on_ready(assets::load_texture(ASSET_PATH("textures/grass.jpg"), texture_options), [&ecs = world.ecs](const Texture2D &texture) {
+            ecs.get_mut<WorldGround>()->model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;
+        });
+
+        assets::on_ready(assets::load_texture(ASSET_PATH("textures/sand.jpg"), texture_options), [&ecs = world.ecs](const Texture2D &texture) {
+            ecs.get_mut<WorldGround>()->model.materials[0].maps[MATERIAL_MAP_SPECULAR].texture = texture;
         });
     }
 
-    // Calculate height using barycentric
-    float barycentric(const Vector3 v1, const Vector3 v2, const Vector3 v3, const float x, const float z) {
-        const auto denominator { (v2.z - v3.z) * (v1.x - v3.x) + (v3.x - v2.x) * (v1.z - v3.z) };
+    void update_ground(const World &world, const int x0, const int z0, const int x1, const int z1) {
+        auto *ground { world.ecs.get_mut<WorldGround>() };
+        if (ground == nullptr) {
+            return;
+        }
 
-        if (fabs(denominator) < 0.00001f) {
-            return (v1.y + v2.y + v3.y) / 3.0f;
+        // Normals read one vertex further and morph targets up to the coarsest morphing step
+        constexpr auto reach { 1 << (GROUND_LOD_LEVELS - 2) };
+        const auto ex0 { std::max(x0 - reach, 0) };
+        const auto ez0 { std::max(z0 - reach, 0) };
+        const auto ex1 { std::min(x1 + reach, DETAILED_SIZE - 1) };
+        const auto ez1 { std::min(z1 + reach, DETAILED_SIZE - 1) };
+
+        std::vector<float> vertices;
+        std::vector<float> morphs;
+        std::vector<float> normals;
+        auto uploaded { 0 };
+
+        for (auto cz0 { ez0 - ez0 % GROUND_CHUNK_SIZE }; cz0 <= ez1 && cz0 < DETAILED_SIZE - 1; cz0 += GROUND_CHUNK_SIZE) {
+            for (auto cx0 { ex0 - ex0 % GROUND_CHUNK_SIZE }; cx0 <= ex1 && cx0 < DETAILED_SIZE - 1; cx0 += GROUND_CHUNK_SIZE) {
+                auto &chunk { ground->chunks[(cz0 / GROUND_CHUNK_SIZE) * GROUND_CHUNKS_PER_ROW + cx0 / GROUND_CHUNK_SIZE] };
+                chunk.bounds = chunk_bounds(cx0, cz0);
+
+                for (auto level { 0 }; level < GROUND_LOD_LEVELS; ++level) {
+                    const auto step { 1 << level };
+                    const auto size { GROUND_CHUNK_SIZE / step + 1 };
+
+                    // Rows are contiguous in the vertex buffers, so the touched rows go up as one range.
+                    // Vertices past the last terrain row repeat it and change along with it.
+                    auto first { -1 };
+                    auto last { -1 };
+                    for (auto j { 0 }; j < size; ++j) {
+                        const auto z { std::min(cz0 + j * step, DETAILED_SIZE - 1) };
+                        if (z >= ez0 && z <= ez1) {
+                            first = first < 0 ? j : first;
+                            last = j;
+                        }
+                    }
+
+                    if (first < 0) {
+                        continue;
+                    }
+
+                    const auto count { (last - first + 1) * size };
+                    vertices.resize(count * 3);
+                    morphs.resize(count * 2);
+                    normals.resize(count * 3);
+
+                    for (auto j { first }; j <= last; ++j) {
+                        for (auto i { 0 }; i < size; ++i) {
+                            const auto index { (j - first) * size + i };
+                            write_chunk_vertex(cx0 + i * step, cz0 + j * step, level, &vertices[index * 3], &morphs[index * 2], &normals[index * 3]);
+                        }
+                    }
+
+                    const auto &mesh { ground->model.meshes[chunk.meshes[level]] };
+                    const auto offset { first * size };
+                    UpdateMeshBuffer(mesh, GROUND_BUFFER_POSITIONS, vertices.data(), static_cast<int>(count * 3 * sizeof(float)), static_cast<int>(offset * 3 * sizeof(float)));
+                    UpdateMeshBuffer(mesh, GROUND_BUFFER_NORMALS, normals.data(), static_cast<int>(count * 3 * sizeof(float)), static_cast<int>(offset * 3 * sizeof(float)));
+                    UpdateMeshBuffer(mesh, GROUND_BUFFER_MORPHS, morphs.data(), static_cast<int>(count * 2 * sizeof(float)), static_cast<int>(offset * 2 * sizeof(float)));
+                    uploaded += count;
+                }
+            }
         }
 
-        const auto w1 { ((v2.z - v3.z) * (x - v3.x) + (v3.x - v2.x) * (z - v3.z)) / denominator };
-        const auto w2 { ((v3.z - v1.z) * (x - v3.x) + (v1.x - v3.x) * (z - v3.z)) / denominator };
-        const auto w3 { 1.0f - w1 - w2 };
+        ground->vertices_updated = uploaded;
+    }
 
-        return w1 * v1.y + w2 * v2.y + w3 * v3.y;
+    // Precompute the plane of both triangles in each cell, h = a + b * fx + c * fz in cell space,
+    // from the dequantized corners so queries land exactly on the drawn mesh.
+    // Cells are split along the top-right/bottom-left diagonal, matching the ground mesh.
+    void update_height_planes(const int x0, const int z0, const int x1, const int z1) {
+        for (auto z { std::max(z0, 0) }; z < std::min(z1, HEIGHT_CELLS); ++z) {
+            for (auto x { std::max(x0, 0) }; x < std::min(x1, HEIGHT_CELLS); ++x) {
+                const auto h00 { elevation.get(x, z) };
+                const auto h10 { elevation.get(x + 1, z) };
+                const auto h01 { elevation.get(x, z + 1) };
+                const auto h11 { elevation.get(x + 1, z + 1) };
+                auto *plane { &height_planes[(z * HEIGHT_CELLS + x) * 6] };
+
+                plane[0] = h00;
+                plane[1] = h10 - h00;
+                plane[2] = h01 - h00;
+
+                plane[3] = h10 + h01 - h11;
+                plane[4] = h11 - h01;
+                plane[5] = h11 - h10;
+            }
+        }
     }
 
     // Get height at coordinate
@@ -167,40 +406,119 @@ namespace terrain {
         const auto grid_z { world_to_terrain(world_z) };
 
         // Check bounds
-        if (grid_x < 0 || grid_x >= DETAILED_SIZE - 1 || grid_z < 0 || grid_z >= DETAILED_SIZE - 1) {
+        if (grid_x < 0 || grid_x >= HEIGHT_CELLS || grid_z < 0 || grid_z >= HEIGHT_CELLS) {
             return 0.0f;
         }
 
-        // Get the grid cell containing this point
+        // Get the grid cell containing this point and the position within it
         const auto x0 { static_cast<int>(grid_x) };
         const auto z0 { static_cast<int>(grid_z) };
-        const auto x1 { x0 + 1 };
-        const auto z1 { z0 + 1 };
-
-        // Get fractional part (position within the grid cell)
         const auto fx { grid_x - static_cast<float>(x0) };
         const auto fz { grid_z - static_cast<float>(z0) };
 
-        const auto h00 { elevation[z0 * DETAILED_SIZE + x0] }; // Bottom-left
-        const auto h10 { elevation[z0 * DETAILED_SIZE + x1] }; // Bottom-right
-        const auto h01 { elevation[z1 * DETAILED_SIZE + x0] }; // Top-left
-        const auto h11 { elevation[z1 * DETAILED_SIZE + x1] }; // Top-right
+        const auto *plane { &height_planes[(z0 * HEIGHT_CELLS + x0) * 6 + (fx + fz <= 1.0f ? 0 : 3)] };
+        return plane[0] + plane[1] * fx + plane[2] * fz;
+    }
 
+    // Drawn ground minus get_height at a world position. The chunk may be drawn on a coarser level,
+    // with its vertices morphed by their distance to the camera like ground.vs does.
+    auto drawn_height_offset(const float world_x, const float world_z, const Vector3 &camera_pos, const int lod_bias) -> float {
+        const auto grid_x { world_to_terrain(world_x) };
+        const auto grid_z { world_to_terrain(world_z) };
+        if (grid_x < 0 || grid_x >= HEIGHT_CELLS || grid_z < 0 || grid_z >= HEIGHT_CELLS) {
+            return 0.0f;
+        }
+
+        const auto chunk_x { static_cast<int>(grid_x) / GROUND_CHUNK_SIZE * GROUND_CHUNK_SIZE };
+        const auto chunk_z { static_cast<int>(grid_z) / GROUND_CHUNK_SIZE * GROUND_CHUNK_SIZE };
+        const BoundingBox bounds {
+            .min { terrain_to_world(static_cast<float>(chunk_x)), 0.0f, terrain_to_world(static_cast<float>(chunk_z)) },
+            .max { terrain_to_world(static_cast<float>(chunk_x + GROUND_CHUNK_SIZE)), 0.0f, terrain_to_world(static_cast<float>(chunk_z + GROUND_CHUNK_SIZE)) },
+        };
+        const auto level { std::min(ground_lod(bounds, camera_pos) + lod_bias, GROUND_LOD_LEVELS - 1) };
+        const auto &range { GROUND_LOD_MORPH[level] };
+
+        // Full detail cells whose corners have not started to morph are exactly the queried surface
+        const auto cell_reach { (terrain_to_world(1.0f) - terrain_to_world(0.0f)) * 1.5f };
+        if (level == 0 && std::hypot(world_x - camera_pos.x, world_z - camera_pos.z) + cell_reach < range.x) {
+            return 0.0f;
+        }
+
+        const auto morphed { [&](const int x, const int z) {
+            const auto vx { terrain_to_world(static_cast<float>(std::min(x, DETAILED_SIZE - 1))) };
+            const auto vz { terrain_to_world(static_cast<float>(std::min(z, DETAILED_SIZE - 1))) };
+            const auto morph { std::clamp((std::hypot(vx - camera_pos.x, vz - camera_pos.z) - range.x) / (range.y - range.x), 0.0f, 1.0f) };
+            const auto target { level < GROUND_LOD_LEVELS - 1 ? coarse_height(x, z, level) : sample_height(x, z) };
+            return Lerp(sample_height(x, z), target, morph);
+        } };
+
+        // Same cell split as the chunk meshes, along the top-right/bottom-left diagonal
+        const auto step { 1 << level };
+        const auto x0 { static_cast<int>(grid_x) / step * step };
+        const auto z0 { static_cast<int>(grid_z) / step * step };
+        const auto fx { (grid_x - static_cast<float>(x0)) / static_cast<float>(step) };
+        const auto fz { (grid_z - static_cast<float>(z0)) / static_cast<float>(step) };
+        const auto h10 { morphed(x0 + step, z0) };
+        const auto h01 { morphed(x0, z0 + step) };
+
+        float drawn;
         if (fx + fz <= 1.0f) {
-            return barycentric(
-                Vector3{0.0f, h00, 0.0f},
-                Vector3{1.0f, h10, 0.0f},
-                Vector3{0.0f, h01, 1.0f},
-                fx, fz
-            );
-        }
-
-        return barycentric(
-            Vector3{1.0f, h10, 0.0f},
-            Vector3{1.0f, h11, 1.0f},
-            Vector3{0.0f, h01, 1.0f},
-            fx, fz
-        );
+            const auto h00 { morphed(x0, z0) };
+            drawn = h00 + (h10 - h00) * fx + (h01 - h00) * fz;
+        } else {
+            const auto h11 { morphed(x0 + step, z0 + step) };
+            drawn = h11 + (h01 - h11) * (1.0f - fx) + (h10 - h11) * (1.0f - fz);
+        }
+
+        return drawn - get_height(world_x, world_z);
+    }
+
+    // Branch free so the loop vectorizes, out of bounds lanes sample a clamped cell and are masked to 0
+    void get_heights(const float *xs, const float *zs, float *heights, const size_t count) {
+        constexpr auto max_cell { static_cast<float>(HEIGHT_CELLS) - 1.0f };
+        const auto *planes { height_planes.data() };
+
+        for (size_t i { 0 }; i < count; ++i) {
+            const auto grid_x { world_to_terrain(xs[i]) };
+            const auto grid_z { world_to_terrain(zs[i]) };
+            const auto inside { grid_x >= 0.0f && grid_x < HEIGHT_CELLS && grid_z >= 0.0f && grid_z < HEIGHT_CELLS };
+
+            const auto x0 { static_cast<int>(std::clamp(grid_x, 0.0f, max_cell)) };
+            const auto z0 { static_cast<int>(std::clamp(grid_z, 0.0f, max_cell)) };
+            const auto fx { grid_x - static_cast<float>(x0) };
+            const auto fz { grid_z - static_cast<float>(z0) };
+
+            const auto *plane { &planes[(z0 * HEIGHT_CELLS + x0) * 6 + (fx + fz <= 1.0f ? 0 : 3)] };
+            const auto height { plane[0] + plane[1] * fx + plane[2] * fz };
+            heights[i] = inside ? height : 0.0f;
+        }
+    }
+
+    void get_heights_normals(const float *xs, const float *zs, float *heights, Vector3 *normals, const size_t count) {
+        constexpr auto max_cell { static_cast<float>(HEIGHT_CELLS) - 1.0f };
+        const auto *planes { height_planes.data() };
+
+        for (size_t i { 0 }; i < count; ++i) {
+            const auto grid_x { world_to_terrain(xs[i]) };
+            const auto grid_z { world_to_terrain(zs[i]) };
+            const auto inside { grid_x >= 0.0f && grid_x < HEIGHT_CELLS && grid_z >= 0.0f && grid_z < HEIGHT_CELLS };
+
+            const auto x0 { static_cast<int>(std::clamp(grid_x, 0.0f, max_cell)) };
+            const auto z0 { static_cast<int>(std::clamp(grid_z, 0.0f, max_cell)) };
+            const auto fx { grid_x - static_cast<float>(x0) };
+            const auto fz { grid_z - static_cast<float>(z0) };
+
+            const auto *plane { &planes[(z0 * HEIGHT_CELLS + x0) * 6 + (fx + fz <= 1.0f ? 0 : 3)] };
+            const auto height { plane[0] + plane[1] * fx + plane[2] * fz };
+
+            // Slopes are per terrain cell, scale them to world units
+            const auto nx { inside ? -plane[1] * DETAIL : 0.0f };
+            const auto nz { inside ? -plane[2] * DETAIL : 0.0f };
+            const auto inv_length { 1.0f / std::sqrt(nx * nx + 1.0f + nz * nz) };
+
+            heights[i] = inside ? height : 0.0f;
+            normals[i] = { nx * inv_length, inv_length, nz * inv_length };
+        }
     }
 
     // Check for ground intersection and where
@@ -0,0 +1,26 @@
+#include "heightfield.h"
+#include <algorithm>
+#include <cmath>
+
+namespace terrain {
+    Heightfield::Heightfield(const int size)
+        : side(size), tiles((size + TILE - 1) / TILE), data(static_cast<size_t>(tiles * tiles * TILE * TILE), 0) {}
+
+    void Heightfield::quantize(const std::vector<float> &heights, const float headroom) {
+        const auto [min_height, max_height] { std::minmax_element(heights.begin(), heights.end()) };
+
+        offset = *min_height - headroom;
+        scale = std::max(*max_height - *min_height + headroom * 2.0f, 1e-3f) / 65535.0f;
+
+        for (auto z { 0 }; z < side; ++z) {
+            for (auto x { 0 }; x < side; ++x) {
+                set(x, z, heights[z * side + x]);
+            }
+        }
+    }
+
+    void Heightfield::set(const int x, const int z, const float height) {
+        const auto value { std::round((height - offset) / scale) };
+        data[index(x, z)] = static_cast<uint16_t>(std::clamp(value, 0.0f, 65535.0f));
+    }
+}
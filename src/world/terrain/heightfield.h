@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace terrain {
+    // Heights quantized to 16 bits with a scale/offset, stored in 8x8 tiles so the corners
+    // of a cell and its neighbours along a ray mostly share a cache line
+    class Heightfield {
+        public:
+            static constexpr int TILE_SHIFT { 3 };
+            static constexpr int TILE { 1 << TILE_SHIFT };
+
+            float offset { 0.0f };
+            float scale { 1.0f };
+
+            explicit Heightfield(int size);
+
+            // Picks the quantization range from the heights plus headroom for later edits and stores them
+            void quantize(const std::vector<float> &heights, float headroom);
+
+            inline auto index(const int x, const int z) const -> size_t {
+                const auto tile { static_cast<size_t>((z >> TILE_SHIFT) * tiles + (x >> TILE_SHIFT)) };
+                return (tile << (TILE_SHIFT * 2)) + static_cast<size_t>(((z & (TILE - 1)) << TILE_SHIFT) + (x & (TILE - 1)));
+            }
+
+            inline auto raw(const int x, const int z) const -> uint16_t {
+                return data[index(x, z)];
+            }
+
+            // Plane math can stay in quantized units, a linear combination dequantizes the same way
+            inline auto dequantize(const float value) const -> float {
+                return offset + scale * value;
+            }
+
+            inline auto get(const int x, const int z) const -> float {
+                return dequantize(static_cast<float>(raw(x, z)));
+            }
+
+            // Heights outside the quantization range are clamped
+            void set(int x, int z, float height);
+
+            // Quantized values in storage order, snapshots copy them as one block
+            auto values() -> uint16_t* { return data.data(); }
+            auto values() const -> const uint16_t* { return data.data(); }
+            auto count() const -> size_t { return data.size(); }
+
+            auto size() const -> int { return side; }
+            auto memory() const -> size_t { return sizeof(*this) + data.capacity() * sizeof(uint16_t); }
+
+        private:
+            int side;
+            int tiles;
+            std::vector<uint16_t> data;
+    };
+}
@@ -0,0 +1,294 @@
+#include "jump_points.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <queue>
+#include "terrain.h"
+
+namespace terrain {
+    namespace {
+        constexpr int DIRECTIONS { 8 };
+        constexpr uint8_t NO_DIRECTION { DIRECTIONS };
+        constexpr float DIAGONAL_COST { 1.414f };
+
+        // Cardinals first, every diagonal is made of the cardinals listed in COMPONENTS
+        constexpr int DX[DIRECTIONS] { 1, -1, 0, 0, 1, 1, -1, -1 };
+        constexpr int DZ[DIRECTIONS] { 0, 0, 1, -1, 1, -1, 1, -1 };
+        constexpr int COMPONENTS[DIRECTIONS][2] {
+            { 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 3 },
+            { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 },
+        };
+
+        // Directions worth following after arriving in a direction: straight on, the diagonals
+        // next to it and both sides for cardinals, straight on and its cardinals for diagonals
+        constexpr int FOLLOW[DIRECTIONS + 1][DIRECTIONS] {
+            { 0, 4, 5, 2, 3, -1, -1, -1 },
+            { 1, 6, 7, 2, 3, -1, -1, -1 },
+            { 2, 4, 6, 0, 1, -1, -1, -1 },
+            { 3, 5, 7, 0, 1, -1, -1, -1 },
+            { 4, 0, 2, -1, -1, -1, -1, -1 },
+            { 5, 0, 3, -1, -1, -1, -1, -1 },
+            { 6, 1, 2, -1, -1, -1, -1, -1 },
+            { 7, 1, 3, -1, -1, -1, -1, -1 },
+            { 0, 1, 2, 3, 4, 5, 6, 7 },
+        };
+
+        inline auto is_diagonal(const int dir) -> bool {
+            return dir >= 4;
+        }
+
+        inline auto octile(const int dx, const int dz) -> float {
+            const auto ax { std::abs(dx) };
+            const auto az { std::abs(dz) };
+            return static_cast<float>(std::max(ax, az) - std::min(ax, az)) + DIAGONAL_COST * static_cast<float>(std::min(ax, az));
+        }
+
+        inline auto slot(const int x, const int z, const int dir) -> size_t {
+            return static_cast<size_t>(z * GRID_SIZE + x) * DIRECTIONS + dir;
+        }
+    }
+
+    JumpTable::JumpTable(const int radius)
+        : radius(radius),
+          jumps(static_cast<size_t>(GRID_SIZE * GRID_SIZE) * DIRECTIONS, 0),
+          costs(GRID_SIZE * GRID_SIZE, 0.0f),
+          parents(GRID_SIZE * GRID_SIZE, -1),
+          arrived(GRID_SIZE * GRID_SIZE, NO_DIRECTION),
+          seen(GRID_SIZE * GRID_SIZE, 0),
+          closed(GRID_SIZE * GRID_SIZE, 0) {}
+
+    auto JumpTable::passable(const int x, const int z) const -> bool {
+        return x >= 0 && x < GRID_SIZE && z >= 0 && z < GRID_SIZE && clearance[z * GRID_SIZE + x] > static_cast<float>(radius);
+    }
+
+    auto JumpTable::can_move(const int x, const int z, const int dir) const -> bool {
+        if (!passable(x + DX[dir], z + DZ[dir])) {
+            return false;
+        }
+        return !is_diagonal(dir) || (passable(x + DX[dir], z) && passable(x, z + DZ[dir]));
+    }
+
+    // A tile entered moving straight is a jump point when a side opens up right next to a blocked
+    // tile beside the one it came from, the shortest way around that corner turns here
+    auto JumpTable::is_jump_point(const int x, const int z, const int dir) const -> bool {
+        const auto side_x { DZ[dir] };
+        const auto side_z { DX[dir] };
+
+        return (passable(x + side_x, z + side_z) && !passable(x - DX[dir] + side_x, z - DZ[dir] + side_z)) ||
+            (passable(x - side_x, z - side_z) && !passable(x - DX[dir] - side_x, z - DZ[dir] - side_z));
+    }
+
+    auto JumpTable::straight(const int x, const int z, const int dir) const -> int16_t {
+        if (!can_move(x, z, dir)) {
+            return 0;
+        }
+
+        const auto nx { x + DX[dir] };
+        const auto nz { z + DZ[dir] };
+        if (is_jump_point(nx, nz, dir)) {
+            return 1;
+        }
+
+        const auto next { jumps[slot(nx, nz, dir)] };
+        return static_cast<int16_t>(next > 0 ? next + 1 : next - 1);
+    }
+
+    // Diagonal runs stop on tiles with a straight jump along either of their cardinals
+    auto JumpTable::diagonal(const int x, const int z, const int dir) const -> int16_t {
+        if (!can_move(x, z, dir)) {
+            return 0;
+        }
+
+        const auto nx { x + DX[dir] };
+        const auto nz { z + DZ[dir] };
+        if (jumps[slot(nx, nz, COMPONENTS[dir][0])] > 0 || jumps[slot(nx, nz, COMPONENTS[dir][1])] > 0) {
+            return 1;
+        }
+
+        const auto next { jumps[slot(nx, nz, dir)] };
+        return static_cast<int16_t>(next > 0 ? next + 1 : next - 1);
+    }
+
+    // Each run reads the tile it steps onto, so rows and columns are swept against their direction
+    void JumpTable::build_row(const int z) {
+        for (auto x { GRID_SIZE - 1 }; x >= 0; --x) {
+            jumps[slot(x, z, 0)] = straight(x, z, 0);
+        }
+        for (auto x { 0 }; x < GRID_SIZE; ++x) {
+            jumps[slot(x, z, 1)] = straight(x, z, 1);
+        }
+    }
+
+    void JumpTable::build_column(const int x) {
+        for (auto z { GRID_SIZE - 1 }; z >= 0; --z) {
+            jumps[slot(x, z, 2)] = straight(x, z, 2);
+        }
+        for (auto z { 0 }; z < GRID_SIZE; ++z) {
+            jumps[slot(x, z, 3)] = straight(x, z, 3);
+        }
+    }
+
+    void JumpTable::build() {
+        for (auto i { 0 }; i < GRID_SIZE; ++i) {
+            build_row(i);
+            build_column(i);
+        }
+
+        for (auto dir { 4 }; dir < DIRECTIONS; ++dir) {
+            for (auto step { 0 }; step < GRID_SIZE; ++step) {
+                const auto z { DZ[dir] > 0 ? GRID_SIZE - 1 - step : step };
+                for (auto x { 0 }; x < GRID_SIZE; ++x) {
+                    jumps[slot(x, z, dir)] = diagonal(x, z, dir);
+                }
+            }
+        }
+
+        built = true;
+    }
+
+    // Straight runs change along the whole rows and columns through the rectangle. Diagonal runs
+    // are redone for every tile that reads one of those, and followed back along the diagonal
+    // for as long as the distances keep changing.
+    void JumpTable::update(const Rect &rect) {
+        const auto row0 { std::max(rect.z0 - 1, 0) };
+        const auto row1 { std::min(rect.z1 + 1, GRID_SIZE) };
+        const auto column0 { std::max(rect.x0 - 1, 0) };
+        const auto column1 { std::min(rect.x1 + 1, GRID_SIZE) };
+
+        for (auto z { row0 }; z < row1; ++z) {
+            build_row(z);
+        }
+        for (auto x { column0 }; x < column1; ++x) {
+            build_column(x);
+        }
+
+        const auto redo { [this](const int x, const int z, const int dir) {
+            auto cx { x };
+            auto cz { z };
+            while (cx >= 0 && cx < GRID_SIZE && cz >= 0 && cz < GRID_SIZE) {
+                const auto value { diagonal(cx, cz, dir) };
+                auto &stored { jumps[slot(cx, cz, dir)] };
+                if (value == stored) {
+                    return;
+                }
+
+                stored = value;
+                cx -= DX[dir];
+                cz -= DZ[dir];
+            }
+        } };
+
+        for (auto dir { 4 }; dir < DIRECTIONS; ++dir) {
+            for (auto step { 0 }; step < GRID_SIZE; ++step) {
+                const auto z { DZ[dir] > 0 ? GRID_SIZE - 1 - step : step };
+                if (z >= row0 - 1 && z < row1 + 1) {
+                    for (auto x { 0 }; x < GRID_SIZE; ++x) {
+                        redo(x, z, dir);
+                    }
+                    continue;
+                }
+
+                for (auto x { std::max(column0 - 1, 0) }; x < std::min(column1 + 1, GRID_SIZE); ++x) {
+                    redo(x, z, dir);
+                }
+            }
+        }
+    }
+
+    void JumpTable::invalidate(const int x0, const int z0, const int x1, const int z1) {
+        if (built) {
+            pending.push_back({ x0, z0, x1, z1 });
+        }
+    }
+
+    auto JumpTable::search(const int start, const int goal, std::vector<int> &path) -> bool {
+        if (!built) {
+            build();
+            pending.clear();
+        }
+
+        for (const auto &rect : pending) {
+            update(rect);
+        }
+        pending.clear();
+
+        path.clear();
+        last_expanded = 0;
+        ++generation;
+
+        const auto goal_x { goal % GRID_SIZE };
+        const auto goal_z { goal / GRID_SIZE };
+
+        using Entry = std::pair<float, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> open;
+
+        costs[start] = 0.0f;
+        parents[start] = -1;
+        arrived[start] = NO_DIRECTION;
+        seen[start] = generation;
+        open.push({ octile(goal_x - start % GRID_SIZE, goal_z - start / GRID_SIZE), start });
+
+        while (!open.empty()) {
+            const auto current { open.top().second };
+            open.pop();
+
+            if (closed[current] == generation) {
+                continue;
+            }
+            closed[current] = generation;
+            ++last_expanded;
+
+            if (current == goal) {
+                for (auto node { goal }; node >= 0; node = parents[node]) {
+                    path.push_back(node);
+                }
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+
+            const auto x { current % GRID_SIZE };
+            const auto z { current / GRID_SIZE };
+            const auto dx { goal_x - x };
+            const auto dz { goal_z - z };
+
+            for (const auto dir : FOLLOW[arrived[current]]) {
+                if (dir < 0) {
+                    break;
+                }
+
+                const auto distance { jumps[slot(x, z, dir)] };
+                const auto reach { std::abs(distance) };
+                auto steps { 0 };
+
+                if (!is_diagonal(dir) && (DX[dir] == 0 ? dx == 0 && dz * DZ[dir] > 0 : dz == 0 && dx * DX[dir] > 0) &&
+                    std::abs(dx + dz) <= reach) {
+                    // The goal lies straight ahead before the next jump point or wall
+                    steps = std::abs(dx + dz);
+                } else if (is_diagonal(dir) && dx * DX[dir] > 0 && dz * DZ[dir] > 0 &&
+                    (std::abs(dx) <= reach || std::abs(dz) <= reach)) {
+                    // Lines up with the goal on the way, a straight run finishes from there
+                    steps = std::min(std::abs(dx), std::abs(dz));
+                } else if (distance > 0) {
+                    steps = distance;
+                } else {
+                    continue;
+                }
+
+                const auto next { (z + DZ[dir] * steps) * GRID_SIZE + x + DX[dir] * steps };
+                const auto cost { costs[current] + static_cast<float>(steps) * (is_diagonal(dir) ? DIAGONAL_COST : 1.0f) };
+
+                if (closed[next] == generation || (seen[next] == generation && cost >= costs[next])) {
+                    continue;
+                }
+
+                costs[next] = cost;
+                parents[next] = current;
+                arrived[next] = static_cast<uint8_t>(dir);
+                seen[next] = generation;
+                open.push({ cost + octile(goal_x - next % GRID_SIZE, goal_z - next / GRID_SIZE), next });
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace terrain {
+    // JPS+ over the path grid for agents of one size in tiles. Every tile keeps, per direction,
+    // the distance to the next jump point (positive) or how far it can move before hitting a
+    // wall (negative, zero when the first step is blocked). Diagonal moves never cut corners.
+    class JumpTable {
+        public:
+            explicit JumpTable(int radius);
+
+            // Passability may have changed for tiles in [x0, x1) x [z0, z1), applied before the next search
+            void invalidate(int x0, int z0, int x1, int z1);
+
+            // Jump points from start to goal as tile indices, both included. False without a path.
+            auto search(int start, int goal, std::vector<int> &path) -> bool;
+
+            auto expanded() const -> int { return last_expanded; }
+
+        private:
+            struct Rect {
+                int x0, z0, x1, z1;
+            };
+
+            auto passable(int x, int z) const -> bool;
+            auto can_move(int x, int z, int dir) const -> bool;
+            auto is_jump_point(int x, int z, int dir) const -> bool;
+            auto straight(int x, int z, int dir) const -> int16_t;
+            auto diagonal(int x, int z, int dir) const -> int16_t;
+
+            void build();
+            void build_row(int z);
+            void build_column(int x);
+            void update(const Rect &rect);
+
+            int radius;
+            bool built { false };
+            std::vector<Rect> pending {};
+            std::vector<int16_t> jumps {};
+
+            // Search state, stamped with the search it belongs to so it never has to be cleared
+            std::vector<float> costs {};
+            std::vector<int> parents {};
+            std::vector<uint8_t> arrived {};
+            std::vector<uint32_t> seen {};
+            std::vector<uint32_t> closed {};
+            uint32_t generation { 0 };
+            int last_expanded { 0 };
+    };
+}
@@ -5,16 +5,41 @@
 #include "world/world.h"
 #include <vector>
 #include <micropather.h>
+#include "heightfield.h"
+#include "memory/memory.h"
 
 constexpr int DETAIL { 2 };
 constexpr int WORLD_SIZE = 64;
 
 constexpr int DETAILED_SIZE { WORLD_SIZE * DETAIL };
+constexpr int HEIGHT_CELLS { DETAILED_SIZE - 1 };
+constexpr size_t HEIGHT_BATCH { 64 };
 constexpr auto WORLD_CENTER { static_cast<float>(WORLD_SIZE) / 2.0f };
 
+// Ground chunks in terrain cells and per level (morph start, morph end) distances from the camera.
+// Consecutive levels are further apart than a chunk diagonal and a level never morphs before the
+// finer level has fully morphed along their shared edges, which keeps the seams crack free.
+// Models follow the drawn surface through drawn_height_offset, get_height stays full detail.
+constexpr int GROUND_CHUNK_SIZE { 16 };
+constexpr int GROUND_LOD_LEVELS { 3 };
+constexpr Vector2 GROUND_LOD_MORPH[GROUND_LOD_LEVELS] {
+    { 8.0f, 12.0f },
+    { 24.0f, 32.0f },
+    { 1e6f, 1e6f + 1.0f },
+};
+
+// Water is only generated where the terrain dips below the highest wave
+constexpr float WATER_MAX_LEVEL { 0.4f };
+constexpr float WATER_DEEP_LEVEL { -1.0f };
+constexpr int WATER_PATCH_SIZE { 16 };
+
 constexpr int GRID_DETAIL = 4;
 constexpr int GRID_SIZE = WORLD_SIZE * GRID_DETAIL;
 
+// Clearance is tracked up to this many path tiles, agents wider than that path as if they were this wide
+constexpr int MAX_CLEARANCE { 8 };
+constexpr int CLEARANCE_BLOCK { 32 };
+
 namespace terrain {
     inline auto world_to_terrain(const float world_coord) -> float {
         return (world_coord + WORLD_CENTER) * DETAIL;
@@ -24,12 +49,67 @@ namespace terrain {
         return (terrain_coord / DETAIL) - WORLD_CENTER;
     }
 
-    extern std::vector<float> elevation;
+    extern Heightfield elevation;
+
+    // Two triangle planes per terrain cell, see update_height_planes
+    extern std::vector<float> height_planes;
+
+    // Path grid of GRID_SIZE x GRID_SIZE tiles, rebuilt from the colliders when they change
+    extern std::vector<bool> walkable;
+
+    // Euclidean distance from every tile to the nearest blocked one, see update_clearance
+    extern std::vector<float> clearance;
 
+    void generate_elevation(int seed);
+    // Builds the ground meshes from the current elevation
     void generate_ground(const World &world);
     void generate_water(const World &world);
 
+    // CPU bytes of the terrain meshes, the indices they keep after upload and the vertex
+    // attribute arrays that are released. Counted from the current elevation, nothing is uploaded.
+    struct MeshMemory {
+        size_t indices {};
+        size_t attributes {};
+    };
+    auto ground_mesh_memory() -> MeshMemory;
+    auto water_mesh_memory() -> MeshMemory;
+    // Walkable tiles, their collider-only copy and the clearance field
+    auto grid_memory() -> size_t;
+
+    enum class BrushMode {
+        Raise,
+        Lower,
+        Flatten, // Towards Brush::height
+    };
+
+    // Falls off smoothly from the center to the radius, strength is the change in height at the
+    // center, or how far the height moves towards the target when flattening
+    struct Brush {
+        BrushMode mode { BrushMode::Raise };
+        float radius { 2.0f };
+        float strength { 0.1f };
+        float height { 0.0f };
+    };
+
+    // Edits the elevation under the brush and brings the ground meshes, water and path tiles up
+    // to date inside the edited rectangle only. On the main thread, between ticks.
+    void deform(const World &world, Vector3 center, const Brush &brush);
+
+    // Partial updates after the elevation changed at vertices [x0, x1] x [z0, z1]
+    void update_ground(const World &world, int x0, int z0, int x1, int z1);
+    void update_water(const World &world, int x0, int z0, int x1, int z1);
+    auto ground_lod(const BoundingBox &bounds, const Vector3 &camera_pos) -> int;
+
+    // Position, morph target height and normal of a ground vertex at terrain vertex (x, z)
+    void write_chunk_vertex(int x, int z, int level, float *vertex, float *morph, float *normal);
+
     float get_height(float world_x, float world_z);
+    // How far the ground on screen is above get_height, models are drawn moved by this much
+    auto drawn_height_offset(float world_x, float world_z, const Vector3 &camera_pos, int lod_bias) -> float;
+    void get_heights(const float *xs, const float *zs, float *heights, size_t count);
+    void get_heights_normals(const float *xs, const float *zs, float *heights, Vector3 *normals, size_t count);
+    // Refreshes the plane table the height queries read, for cells [x0, x1) x [z0, z1)
+    void update_height_planes(int x0, int z0, int x1, int z1);
 
     std::optional<Vector3> ray_ground_intersect(const Vector3& origin, const Vector3& direction);
     std::optional<Vector3> find_closest_shallow_point(const Vector3& target, const Vector3& source, float depth = 0.5f);
@@ -37,8 +117,57 @@ namespace terrain {
     bool is_walkable(int x, int y);
     void block_tile(int x, int y);
     void block_object(const Vector3& world_pos, float radius);
-    void update_collision_entities(const flecs::world& world);
-    void find_path(Vector3 start, Vector3 end, std::vector<Vector3>& path);
+
+    // Collider of an entity that is out of the ECS for now, such as one in a dormant chunk
+    struct Blocker {
+        Vector3 pos;
+        float radius;
+    };
+
+    // Brings the grid up to date with the live colliders and the given absent ones, only inside
+    // the blocks around colliders that were added, moved or removed since the last call
+    void update_collision_entities(const flecs::world& world, const std::vector<Blocker>& absent = {});
+
+    // Makes the next update_collision_entities rebuild the whole grid, for when the terrain or
+    // the grid was replaced wholesale
+    void invalidate_collision_grid();
+
+    // Samples the terrain again for path tiles in [x0, x1) x [z0, z1), colliders stay as they were
+    void update_ground_tiles(int x0, int z0, int x1, int z1);
+
+    // Recomputes clearance for tiles in [x0, x1) x [z0, z1) after walkable changed there,
+    // in time linear in the size of the region
+    void update_clearance(int x0, int z0, int x1, int z1);
+    void rebuild_clearance();
+
+    // Distance to the nearest blocked tile in world units, up to MAX_CLEARANCE tiles
+    float get_clearance(int x, int y);
+
+    // Whether an agent of the given radius fits on the path tile under a world position
+    bool can_stand(const Vector3& world_pos, float radius);
+
+    enum class PathSolver {
+        MicroPather, // A* over the tile graph, cutting corners diagonally
+        JumpPoint,   // JPS+ over precomputed jump distances, diagonals never cut corners
+    };
+
+    // The last find_path call, expanded counts the nodes either solver took off its open list
+    struct PathStats {
+        PathSolver solver { PathSolver::MicroPather };
+        int expanded {};
+        float solve_ms {};
+    };
+
+    void set_path_solver(PathSolver solver);
+    PathSolver get_path_solver();
+    PathStats last_path_stats();
+
+    // Drops the solutions micropather cached, so the next solves start cold
+    void reset_path_cache();
+
+    // Paths and sight lines keep agents of the given radius clear of blocked tiles
+    void find_path(Vector3 start, Vector3 end, memory::PoolVector<Vector3>& path, float radius = 0.0f);
+    bool has_line_of_sight(const Vector3& from, const Vector3& to, float radius = 0.0f);
     float world_to_grid(float world_coord);
     float grid_to_world(float grid_coord);
 
@@ -1,32 +1,295 @@
 #include "FastNoiseLite.h"
 #include "game.h"
+#include "assets/assets.h"
 #include <raylib.h>
 #include <raymath.h>
 #include "terrain.h"
 #include "world/components/render.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <vector>
 
 namespace terrain {
+    // Builds one water patch, only referenced vertices are emitted
+    class PatchBuilder {
+        public:
+            std::vector<float> vertices;
+            std::vector<float> texcoords;
+            std::vector<float> normals;
+            std::vector<unsigned short> indices;
+            std::vector<int> remap;
+            int x0, z0, width;
+            int wet_cells { 0 };
+
+            PatchBuilder(const int x0, const int z0, const int width, const int length)
+                : remap((width + 1) * (length + 1), -1), x0(x0), z0(z0), width(width) {}
+
+            auto vertex(const int x, const int z) -> unsigned short {
+                auto &index { remap[(z - z0) * (width + 1) + (x - x0)] };
+
+                if (index < 0) {
+                    index = static_cast<int>(vertices.size() / 3);
+                    vertices.insert(vertices.end(), {
+                        terrain_to_world(static_cast<float>(x)),
+                        elevation.get(x, z),
+                        terrain_to_world(static_cast<float>(z)),
+                    });
+                    texcoords.insert(texcoords.end(), {
+                        static_cast<float>(x) / (DETAILED_SIZE - 1),
+                        static_cast<float>(z) / (DETAILED_SIZE - 1),
+                    });
+                    normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+                }
+
+                return static_cast<unsigned short>(index);
+            }
+
+            void triangle(const int ax, const int az, const int bx, const int bz, const int cx, const int cz) {
+                indices.insert(indices.end(), { vertex(ax, az), vertex(bx, bz), vertex(cx, cz) });
+            }
+
+            // Uploads straight from the builder, the mesh only keeps a CPU copy of the indices
+            // since DrawMesh takes the indexed path only while they are set
+            auto build() -> Mesh {
+                const auto vertex_count { static_cast<int>(vertices.size() / 3) };
+                const auto index_bytes { static_cast<unsigned int>(indices.size() * sizeof(unsigned short)) };
+                auto *owned_indices { static_cast<unsigned short*>(MemAlloc(index_bytes)) };
+                std::copy(indices.begin(), indices.end(), owned_indices);
+
+                Mesh mesh {
+                    .vertexCount { vertex_count },
+                    .triangleCount { static_cast<int>(indices.size() / 3) },
+                    .vertices { vertices.data() },
+                    .texcoords { texcoords.data() },
+                    .normals { normals.data() },
+                    .indices { owned_indices },
+                };
+
+                UploadMesh(&mesh, false);
+
+                mesh.vertices = nullptr;
+                mesh.texcoords = nullptr;
+                mesh.normals = nullptr;
+                return mesh;
+            }
+    };
+
+    auto cell_min_max(const int x, const int z) -> std::pair<float, float> {
+        const auto h00 { elevation.get(x, z) };
+        const auto h10 { elevation.get(x + 1, z) };
+        const auto h01 { elevation.get(x, z + 1) };
+        const auto h11 { elevation.get(x + 1, z + 1) };
+
+        return { std::min({ h00, h10, h01, h11 }), std::max({ h00, h10, h01, h11 }) };
+    }
+
+    // Deep patches at half resolution, quads touching the patch border are fanned around
+    // their center so the edge keeps full resolution and matches any neighbouring patch
+    void build_coarse_patch(PatchBuilder &patch, const int x1, const int z1) {
+        for (auto z { patch.z0 }; z < z1; z += 2) {
+            for (auto x { patch.x0 }; x < x1; x += 2) {
+                const auto left { x == patch.x0 };
+                const auto right { x + 2 == x1 };
+                const auto top { z == patch.z0 };
+                const auto bottom { z + 2 == z1 };
+
+                if (!left && !right && !top && !bottom) {
+                    patch.triangle(x, z, x, z + 2, x + 2, z);
+                    patch.triangle(x + 2, z, x, z + 2, x + 2, z + 2);
+                    continue;
+                }
+
+                std::vector<std::pair<int, int>> perimeter { { x, z } };
+                if (left) perimeter.emplace_back(x, z + 1);
+                perimeter.emplace_back(x, z + 2);
+                if (bottom) perimeter.emplace_back(x + 1, z + 2);
+                perimeter.emplace_back(x + 2, z + 2);
+                if (right) perimeter.emplace_back(x + 2, z + 1);
+                perimeter.emplace_back(x + 2, z);
+                if (top) perimeter.emplace_back(x + 1, z);
+
+                for (size_t i { 0 }; i < perimeter.size(); ++i) {
+                    const auto [ax, az] { perimeter[i] };
+                    const auto [bx, bz] { perimeter[(i + 1) % perimeter.size()] };
+                    patch.triangle(x + 1, z + 1, ax, az, bx, bz);
+                }
+            }
+        }
+    }
+
+    constexpr auto WATER_CELLS { DETAILED_SIZE - 1 };
+
+    // Triangulates the patch starting at cell (x0, z0), the builder stays empty when the patch is dry
+    auto triangulate_water_patch(const int x0, const int z0) -> PatchBuilder {
+        const auto x1 { std::min(x0 + WATER_PATCH_SIZE, WATER_CELLS) };
+        const auto z1 { std::min(z0 + WATER_PATCH_SIZE, WATER_CELLS) };
+
+        auto deep { true };
+        std::vector<std::pair<int, int>> wet;
+
+        for (auto z { z0 }; z < z1; ++z) {
+            for (auto x { x0 }; x < x1; ++x) {
+                const auto [min_height, max_height] { cell_min_max(x, z) };
+                if (min_height < WATER_MAX_LEVEL) {
+                    wet.emplace_back(x, z);
+                }
+                deep = deep && max_height < WATER_DEEP_LEVEL;
+            }
+        }
+
+        PatchBuilder patch { x0, z0, x1 - x0, z1 - z0 };
+        patch.wet_cells = static_cast<int>(wet.size());
+        if (wet.empty()) {
+            return patch;
+        }
+
+        if (deep && (x1 - x0) % 2 == 0 && (z1 - z0) % 2 == 0) {
+            build_coarse_patch(patch, x1, z1);
+        } else {
+            for (const auto &[x, z] : wet) {
+                patch.triangle(x, z, x, z + 1, x + 1, z);
+                patch.triangle(x + 1, z, x, z + 1, x + 1, z + 1);
+            }
+        }
+
+        return patch;
+    }
+
+    // Uploads the patch starting at cell (x0, z0), returns the number of wet cells or zero
+    // without uploading anything when the patch is dry
+    auto build_water_patch(const int x0, const int z0, Mesh &mesh, BoundingBox &bounds) -> int {
+        auto patch { triangulate_water_patch(x0, z0) };
+        if (patch.wet_cells == 0) {
+            return 0;
+        }
+
+        const auto x1 { std::min(x0 + WATER_PATCH_SIZE, WATER_CELLS) };
+        const auto z1 { std::min(z0 + WATER_PATCH_SIZE, WATER_CELLS) };
+        mesh = patch.build();
+        bounds = {
+            .min { terrain_to_world(static_cast<float>(x0)), -WATER_MAX_LEVEL, terrain_to_world(static_cast<float>(z0)) },
+            .max { terrain_to_world(static_cast<float>(x1)), WATER_MAX_LEVEL, terrain_to_world(static_cast<float>(z1)) },
+        };
+        return patch.wet_cells;
+    }
+
+    auto water_mesh_memory() -> MeshMemory {
+        MeshMemory memory {};
+
+        for (auto z0 { 0 }; z0 < WATER_CELLS; z0 += WATER_PATCH_SIZE) {
+            for (auto x0 { 0 }; x0 < WATER_CELLS; x0 += WATER_PATCH_SIZE) {
+                const auto patch { triangulate_water_patch(x0, z0) };
+                memory.indices += patch.indices.size() * sizeof(unsigned short);
+                memory.attributes += (patch.vertices.size() + patch.texcoords.size() + patch.normals.size()) * sizeof(float);
+            }
+        }
+
+        return memory;
+    }
+
     void generate_water(const World &world) {
-        const auto water_texture = LoadTextureFromImage(LoadImage(ASSET_PATH("textures/water-normal.jpg")));
-        SetTextureFilter(water_texture, TEXTURE_FILTER_BILINEAR);
-        SetTextureWrap(water_texture, TEXTURE_WRAP_REPEAT);
+        constexpr auto cells { WATER_CELLS };
+
+        std::vector<Mesh> meshes;
+        std::vector<BoundingBox> bounds;
+        auto wet_cells { 0 };
+
+        for (auto z0 { 0 }; z0 < cells; z0 += WATER_PATCH_SIZE) {
+            for (auto x0 { 0 }; x0 < cells; x0 += WATER_PATCH_SIZE) {
+                Mesh mesh {};
+                BoundingBox box {};
+                if (const auto wet { build_water_patch(x0, z0, mesh, box) }; wet > 0) {
+                    wet_cells += wet;
+                    meshes.push_back(mesh);
+                    bounds.push_back(box);
+                }
+            }
+        }
+
+        Model water_model {};
+        water_model.transform = MatrixIdentity();
+        water_model.meshCount = static_cast<int>(meshes.size());
+        water_model.meshes = static_cast<Mesh*>(MemAlloc(meshes.size() * sizeof(Mesh)));
+        water_model.materialCount = 1;
+        water_model.materials = static_cast<Material*>(MemAlloc(sizeof(Material)));
+        water_model.materials[0] = LoadMaterialDefault();
+        water_model.meshMaterial = static_cast<int*>(MemAlloc(meshes.size() * sizeof(int)));
+        std::copy(meshes.begin(), meshes.end(), water_model.meshes);
+
+        auto vertex_count { 0 };
+        auto triangle_count { 0 };
+        for (const auto &mesh : meshes) {
+            vertex_count += mesh.vertexCount;
+            triangle_count += mesh.triangleCount;
+        }
 
-        const auto water_shader { world.ecs.get<WaterShader>() };
+        TraceLog(LOG_INFO, "WATER: %d patches, %d vertices, %d triangles (full plane %d vertices, %d triangles), %.1f%% of the area covered",
+            water_model.meshCount, vertex_count, triangle_count,
+            DETAILED_SIZE * DETAILED_SIZE, cells * cells * 2,
+            100.0f * static_cast<float>(wet_cells) / static_cast<float>(cells * cells));
 
-        const auto mesh = GenMeshPlane(WORLD_SIZE, WORLD_SIZE, DETAILED_SIZE - 1, DETAILED_SIZE - 1);
-        const auto vertex_count = mesh.vertexCount;
-        for (int i = 0; i < vertex_count; ++i) {
-            mesh.vertices[i * 3 + 1] = elevation[i];
+        world.ecs.set<WorldWater>({
+            .model { water_model },
+            .patches { bounds },
+        });
+
+        assets::on_ready(assets::load_texture(ASSET_PATH("textures/water-normal.jpg")), [&ecs = world.ecs](const Texture2D &texture) {
+            ecs.get_mut<WorldWater>()->model.materials[0].maps[MATERIAL_MAP_NORMAL].texture = texture;
+        });
+    }
+
+    void update_water(const World &world, const int x0, const int z0, const int x1, const int z1) {
+        auto *water { world.ecs.get_mut<WorldWater>() };
+        if (water == nullptr) {
+            return;
         }
 
-        UpdateMeshBuffer(mesh, 0, mesh.vertices, static_cast<int>(vertex_count * 3 * sizeof(float)), 0);
+        // Cells with a corner in the edited range
+        const auto cx0 { std::max(x0 - 1, 0) };
+        const auto cz0 { std::max(z0 - 1, 0) };
+        const auto cx1 { std::min(x1, WATER_CELLS - 1) };
+        const auto cz1 { std::min(z1, WATER_CELLS - 1) };
+        auto &model { water->model };
+
+        for (auto pz0 { cz0 - cz0 % WATER_PATCH_SIZE }; pz0 <= cz1; pz0 += WATER_PATCH_SIZE) {
+            for (auto px0 { cx0 - cx0 % WATER_PATCH_SIZE }; px0 <= cx1; px0 += WATER_PATCH_SIZE) {
+                // Only wet patches have a mesh, they are found by the corner of their bounds
+                auto index { -1 };
+                for (auto i { 0 }; i < model.meshCount; ++i) {
+                    if (static_cast<int>(std::lround(world_to_terrain(water->patches[i].min.x))) == px0 &&
+                        static_cast<int>(std::lround(world_to_terrain(water->patches[i].min.z))) == pz0) {
+                        index = i;
+                        break;
+                    }
+                }
 
-        const auto water_model { LoadModelFromMesh(mesh) };
+                if (index >= 0) {
+                    UnloadMesh(model.meshes[index]);
+                }
 
-        water_model.materials[0].shader = water_shader->shader;
-        water_model.materials[0].maps[MATERIAL_MAP_NORMAL].texture = water_texture;
-        world.ecs.set<WorldWater>({ .model { water_model } });
+                Mesh mesh {};
+                BoundingBox bounds {};
+                const auto wet { build_water_patch(px0, pz0, mesh, bounds) > 0 };
+
+                if (wet && index >= 0) {
+                    model.meshes[index] = mesh;
+                } else if (wet) {
+                    model.meshes = static_cast<Mesh*>(MemRealloc(model.meshes, (model.meshCount + 1) * sizeof(Mesh)));
+                    model.meshMaterial = static_cast<int*>(MemRealloc(model.meshMaterial, (model.meshCount + 1) * sizeof(int)));
+                    model.meshes[model.meshCount] = mesh;
+                    model.meshMaterial[model.meshCount] = 0;
+                    model.meshCount++;
+                    water->patches.push_back(bounds);
+                } else if (index >= 0) {
+                    // Dried up, the last patch takes its place
+                    model.meshCount--;
+                    model.meshes[index] = model.meshes[model.meshCount];
+                    water->patches[index] = water->patches.back();
+                    water->patches.pop_back();
+                }
+            }
+        }
     }
 
     std::optional<Vector3> find_closest_shallow_point(const Vector3& target, const Vector3& source, float depth) {
@@ -34,19 +297,33 @@ namespace terrain {
         const auto dir = Vector3Subtract(target, source);
         const auto dist = Vector3Length(dir);
         const auto step = Vector3Scale(Vector3Normalize(dir), step_size);
+        const auto steps = static_cast<size_t>(dist / step_size) + 1;
 
-        std::optional<Vector3> furthest_shallow_point;
+        // Sample the segment a batch at a time and walk it until the water gets too deep
+        std::array<float, HEIGHT_BATCH> xs;
+        std::array<float, HEIGHT_BATCH> zs;
+        std::array<float, HEIGHT_BATCH> heights;
 
-        for (float t = 0; t <= dist; t += step_size) {
-            const auto pos = Vector3Add(source, Vector3Scale(step, t / step_size));
+        std::optional<Vector3> furthest_shallow_point;
 
-            if (get_height(pos.x, pos.z) < -depth) {
-                break;
+        for (size_t start = 0; start < steps; start += HEIGHT_BATCH) {
+            const auto count = std::min(steps - start, HEIGHT_BATCH);
+            for (size_t i = 0; i < count; ++i) {
+                xs[i] = source.x + step.x * static_cast<float>(start + i);
+                zs[i] = source.z + step.z * static_cast<float>(start + i);
             }
 
-            furthest_shallow_point = Vector3{ pos.x, get_height(pos.x, pos.z), pos.z };
+            get_heights(xs.data(), zs.data(), heights.data(), count);
+
+            for (size_t i = 0; i < count; ++i) {
+                if (heights[i] < -depth) {
+                    return furthest_shallow_point;
+                }
+
+                furthest_shallow_point = Vector3{ xs[i], heights[i], zs[i] };
+            }
         }
 
         return furthest_shallow_point;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,80 @@
+#include "transforms.h"
+#include <cmath>
+#include <raymath.h>
+
+namespace transforms {
+    void Batch::clear() {
+        for (auto *lane : { &px, &py, &pz, &qx, &qy, &qz, &qw, &scale }) {
+            lane->clear();
+        }
+    }
+
+    void Batch::push(const Vector3 &position, const Quaternion &rotation, const float uniform_scale) {
+        px.push_back(position.x);
+        py.push_back(position.y);
+        pz.push_back(position.z);
+        qx.push_back(rotation.x);
+        qy.push_back(rotation.y);
+        qz.push_back(rotation.z);
+        qw.push_back(rotation.w);
+        scale.push_back(uniform_scale);
+    }
+
+    // Same result as MatrixMultiply(MatrixScale, MatrixMultiply(QuaternionToMatrix, MatrixTranslate)),
+    // with the scale folded into the rotation terms. Lanes are independent so the loop vectorizes.
+    void build_matrices(const Batch &batch, Affine *__restrict out) {
+        const auto *__restrict px { batch.px.data() };
+        const auto *__restrict py { batch.py.data() };
+        const auto *__restrict pz { batch.pz.data() };
+        const auto *__restrict qx { batch.qx.data() };
+        const auto *__restrict qy { batch.qy.data() };
+        const auto *__restrict qz { batch.qz.data() };
+        const auto *__restrict qw { batch.qw.data() };
+        const auto *__restrict scale { batch.scale.data() };
+
+        for (size_t i { 0 }; i < batch.size(); ++i) {
+            const auto x { qx[i] };
+            const auto y { qy[i] };
+            const auto z { qz[i] };
+            const auto w { qw[i] };
+            const auto s { scale[i] };
+            const auto s2 { s * 2.0f };
+            auto *m { out[i].m };
+
+            m[0] = s - s2 * (y * y + z * z);
+            m[1] = s2 * (x * y - z * w);
+            m[2] = s2 * (x * z + y * w);
+            m[3] = px[i];
+
+            m[4] = s2 * (x * y + z * w);
+            m[5] = s - s2 * (x * x + z * z);
+            m[6] = s2 * (y * z - x * w);
+            m[7] = py[i];
+
+            m[8] = s2 * (x * z - y * w);
+            m[9] = s2 * (y * z + x * w);
+            m[10] = s - s2 * (x * x + y * y);
+            m[11] = pz[i];
+        }
+    }
+
+    auto to_matrix(const Affine &affine) -> Matrix {
+        const auto *m { affine.m };
+        return {
+            m[0], m[1], m[2], m[3],
+            m[4], m[5], m[6], m[7],
+            m[8], m[9], m[10], m[11],
+            0.0f, 0.0f, 0.0f, 1.0f,
+        };
+    }
+
+    auto yaw(const Quaternion &rotation) -> float {
+        const auto forward_x { 2.0f * (rotation.x * rotation.z + rotation.w * rotation.y) };
+        const auto forward_z { 1.0f - 2.0f * (rotation.x * rotation.x + rotation.y * rotation.y) };
+        return std::atan2(forward_x, forward_z) * RAD2DEG;
+    }
+
+    auto from_yaw(const float degrees) -> Quaternion {
+        return QuaternionFromAxisAngle({ 0.0f, 1.0f, 0.0f }, degrees * DEG2RAD);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <raylib.h>
+#include <vector>
+
+namespace transforms {
+    // Upper 3x4 of a world matrix, in the field order of raylib's Matrix (m0, m4, m8, m12, m1, ...)
+    struct Affine {
+        float m[12];
+    };
+
+    // Interpolated transforms as a structure of arrays, one lane per entity
+    struct Batch {
+        std::vector<float> px, py, pz;
+        std::vector<float> qx, qy, qz, qw;
+        std::vector<float> scale;
+
+        auto size() const -> size_t { return px.size(); }
+        void clear();
+        void push(const Vector3 &position, const Quaternion &rotation, float uniform_scale);
+    };
+
+    // Scale, rotate, then translate every lane in one pass, out must hold batch.size() matrices
+    void build_matrices(const Batch &batch, Affine *out);
+    auto to_matrix(const Affine &affine) -> Matrix;
+
+    // Heading around the up axis in degrees, for entities that only turn on the ground
+    auto yaw(const Quaternion &rotation) -> float;
+    auto from_yaw(float degrees) -> Quaternion;
+}
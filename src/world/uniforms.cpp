@@ -0,0 +1,81 @@
+#include "uniforms.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+#include "graphics.h"
+
+namespace uniforms {
+    namespace {
+        struct Slot {
+            std::array<uint8_t, 16> bytes {};
+            size_t size { 0 };
+        };
+
+        // Last value uploaded per shader program and location, only touched from the render thread
+        std::unordered_map<uint64_t, Slot> uploaded;
+        FrameBlock frame {};
+        Stats current {};
+        Stats last {};
+    }
+
+    auto frame_locations(const Shader &shader) -> FrameLocations {
+        return {
+            .light_dir = GetShaderLocation(shader, "lightDir"),
+            .light_color = GetShaderLocation(shader, "lightColor"),
+            .view_pos = GetShaderLocation(shader, "viewPos"),
+        };
+    }
+
+    void begin_frame(const FrameBlock &block) {
+        last = current;
+        current = {};
+        frame = block;
+    }
+
+    void bind_frame(const Shader &shader, const FrameLocations &locations) {
+        set(shader, locations.light_dir, &frame.light_dir, SHADER_UNIFORM_VEC3);
+        set(shader, locations.light_color, &frame.light_color, SHADER_UNIFORM_VEC3);
+        set(shader, locations.view_pos, &frame.view_pos, SHADER_UNIFORM_VEC3);
+    }
+
+    void set(const Shader &shader, const int location, const void *value, const int type) {
+        if (location < 0) {
+            return;
+        }
+
+        current.requested++;
+
+        auto &slot { uploaded[static_cast<uint64_t>(shader.id) << 32 | static_cast<uint32_t>(location)] };
+        const auto size { graphics::uniform_size(type) };
+        if (slot.size == size && std::memcmp(slot.bytes.data(), value, size) == 0) {
+            return;
+        }
+
+        std::memcpy(slot.bytes.data(), value, size);
+        slot.size = size;
+        graphics::backend().set_uniform(shader, location, value, type, 1);
+        current.uploaded++;
+    }
+
+    void forget(const Shader &shader) {
+        for (auto it { uploaded.begin() }; it != uploaded.end();) {
+            it = it->first >> 32 == shader.id ? uploaded.erase(it) : std::next(it);
+        }
+    }
+
+    void set_array(const Shader &shader, const int location, const void *values, const int type, const int count) {
+        if (location < 0) {
+            return;
+        }
+
+        current.requested++;
+        current.uploaded++;
+        graphics::backend().set_uniform(shader, location, values, type, count);
+    }
+
+    auto frame_stats() -> Stats {
+        return last;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <raylib.h>
+
+namespace uniforms {
+    // Values every lit shader reads, set once per frame and uploaded to each shader only when they changed
+    struct FrameBlock {
+        Vector3 light_dir;
+        Vector3 light_color;
+        Vector3 view_pos;
+    };
+
+    struct FrameLocations {
+        int light_dir;
+        int light_color;
+        int view_pos;
+    };
+
+    struct Stats {
+        size_t requested {}; // Uploads asked for, what was sent before values were tracked
+        size_t uploaded {};  // Uploads that reached the driver
+    };
+
+    auto frame_locations(const Shader &shader) -> FrameLocations;
+
+    void begin_frame(const FrameBlock &block);
+    void bind_frame(const Shader &shader, const FrameLocations &locations);
+
+    // Skipped when the shader already holds the same value
+    void set(const Shader &shader, int location, const void *value, int type);
+
+    // Drops the values tracked for a shader, before it is unloaded since a later one may reuse its id
+    void forget(const Shader &shader);
+
+    // Arrays change with the scene and are always uploaded
+    void set_array(const Shader &shader, int location, const void *values, int type, int count);
+
+    // Totals of the last complete frame
+    auto frame_stats() -> Stats;
+}
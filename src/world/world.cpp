@@ -1,22 +1,28 @@
 #include <flecs.h>
 #include <raylib.h>
 #include "world/world.h"
+#include "world/simulation.h"
+#include "memory/memory.h"
+#include "world/quality.h"
+#include "world/components/gameplay.h"
+#include "world/components/render.h"
 
 #include "world/systems/particle.h"
 #include "world/systems/interpolation.h"
 #include "world/systems/render.h"
 #include "world/systems/gameplay.h"
+#include "world/systems/lod.h"
+#include "world/systems/streaming.h"
 
 #include <algorithm>
-
-constexpr auto MAX_FRAME_TIME { 2.0f };
+#include <chrono>
 
 auto World::create_world() -> World {
     const flecs::world ecs;
 
     const auto fixed_phase { ecs.entity("fixed_phase") };
     const auto render_phase { ecs.entity("render_phase") };
-    const auto pre_fixed_phase { ecs.entity("pre_render_phase") };
+    const auto pre_fixed_phase { ecs.entity("pre_fixed_phase") };
     const auto pre_render_phase { ecs.entity("pre_render_phase") };
 
     // Game loop pipeline with a fixed interval of 60 FPS
@@ -32,13 +38,13 @@ auto World::create_world() -> World {
     };
 
     // Render pipeline without fixed interval
-    const auto render_pipeline { ecs.pipeline()
+    const auto pre_render_pipeline { ecs.pipeline()
         .with(flecs::System)
-        .with(pre_fixed_phase)
+        .with(pre_render_phase)
         .build()
     };
 
-    const auto pre_render_pipeline { ecs.pipeline()
+    const auto render_pipeline { ecs.pipeline()
         .with(flecs::System)
         .with(render_phase)
         .build()
@@ -55,28 +61,66 @@ auto World::create_world() -> World {
         .pre_render_phase { pre_render_phase },
         .render_phase { render_phase },
         .accumulator { 0.0f },
+        .simulation {},
     }};
 
     interpolation_systems::register_systems(world);
+    lod_systems::register_systems(world);
     gameplay_systems::register_systems(world);
     render_systems::register_systems(world);
     particle_systems::register_systems(world);
+    streaming_systems::register_systems(world);
 
     return world;
 }
 
 auto World::update() -> void {
+    memory::begin_frame();
+
+    if (simulation) {
+        simulation->render();
+        return;
+    }
+
     const float dt = std::min(GetFrameTime(), MAX_FRAME_TIME);
     accumulator += dt;
 
+    if (const auto *cam { ecs.get<WorldCamera>() }) {
+        ecs.set<PointerInput>({
+            .down = IsMouseButtonDown(MOUSE_LEFT_BUTTON),
+            .ray = GetMouseRay(GetMousePosition(), cam->camera),
+        });
+    }
+
     // ReSharper disable once CppDFALoopConditionNotUpdated
     while (accumulator >= FIXED_DT) {
+        const auto tick_start { std::chrono::steady_clock::now() };
+        memory::begin_tick();
         ecs.run_pipeline(pre_fixed_pipeline, FIXED_DT);
         ecs.run_pipeline(fixed_pipeline, FIXED_DT);
+        quality::record_tick(std::chrono::duration<float>(std::chrono::steady_clock::now() - tick_start).count());
         accumulator -= FIXED_DT;
     }
 
     const float alpha { accumulator / FIXED_DT };
     ecs.run_pipeline(pre_render_pipeline, alpha);
     ecs.run_pipeline(render_pipeline, alpha);
-}
\ No newline at end of file
+}
+
+auto World::start_simulation_thread() -> void {
+    if (!simulation) {
+        simulation = std::make_shared<Simulation>(*this);
+    }
+}
+
+auto World::stop_simulation_thread() -> void {
+    simulation.reset();
+}
+
+auto World::exclusive(const std::function<void()> &fn) -> void {
+    if (simulation) {
+        simulation->exclusive(fn);
+    } else {
+        fn();
+    }
+}
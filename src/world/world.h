@@ -1,7 +1,12 @@
 #pragma once
 #include <flecs.h>
+#include <functional>
+#include <memory>
 
 constexpr float FIXED_DT { 1.0f / 60.0f };
+constexpr float MAX_FRAME_TIME { 2.0f };
+
+class Simulation;
 
 class World {
     public:
@@ -17,8 +22,16 @@ class World {
         flecs::entity render_phase;
 
         float accumulator;
+        std::shared_ptr<Simulation> simulation {};
 
         static auto create_world() -> World;
         void update();
-};
 
+        // Opt-in threaded mode, the fixed pipelines move to a simulation thread and rendering
+        // reads the frames it publishes instead of the ECS
+        void start_simulation_thread();
+        void stop_simulation_thread();
+
+        // Runs fn with exclusive access to the ECS, right away unless the simulation thread is running
+        void exclusive(const std::function<void()> &fn);
+};
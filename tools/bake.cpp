@@ -0,0 +1,208 @@
+// Bakes assets/models/*.glb and assets/textures/* into a single GPU ready pack
+// Usage: bixs_bake <assets directory> <output pack>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <raylib.h>
+#include "rlgl.h"
+#include "assets/pack.h"
+
+namespace pack = assets::pack;
+
+class PackWriter {
+    public:
+        std::vector<uint8_t> buffer;
+        std::vector<pack::Entry> entries;
+
+        PackWriter() {
+            buffer.resize(sizeof(pack::Header));
+        }
+
+        // Appends an aligned block and returns its absolute offset
+        auto append(const void *data, const size_t size) -> uint64_t {
+            if (data == nullptr || size == 0) {
+                return 0;
+            }
+
+            buffer.resize((buffer.size() + pack::ALIGNMENT - 1) / pack::ALIGNMENT * pack::ALIGNMENT);
+            const auto offset { static_cast<uint64_t>(buffer.size()) };
+            buffer.insert(buffer.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+            return offset;
+        }
+
+        template <typename T>
+        auto append(const T &value) -> uint64_t {
+            return append(&value, sizeof(T));
+        }
+
+        auto add_entry(const std::string &path, const pack::EntryType type, const uint64_t offset) -> int {
+            pack::Entry entry {};
+            std::strncpy(entry.path, path.c_str(), sizeof(entry.path) - 1);
+            entry.type = type;
+            entry.offset = offset;
+            entry.size = buffer.size() - offset;
+            entries.push_back(entry);
+            return static_cast<int>(entries.size()) - 1;
+        }
+
+        auto save(const std::string &path) -> bool {
+            const auto entries_offset { append(entries.data(), entries.size() * sizeof(pack::Entry)) };
+
+            pack::Header header {};
+            std::memcpy(header.magic, pack::MAGIC, sizeof(header.magic));
+            header.version = pack::VERSION;
+            header.entry_count = static_cast<uint32_t>(entries.size());
+            header.entries_offset = entries_offset;
+            std::memcpy(buffer.data(), &header, sizeof(header));
+
+            return SaveFileData(path.c_str(), buffer.data(), static_cast<int>(buffer.size()));
+        }
+};
+
+auto bake_image(PackWriter &writer, const std::string &path, Image image) -> int {
+    ImageMipmaps(&image);
+
+    const auto data_size { static_cast<uint64_t>(GetPixelDataSize(image.width, image.height, image.format)) };
+    auto mip_size { data_size };
+    for (int level { 1 }, width { image.width }, height { image.height }; level < image.mipmaps; ++level) {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        mip_size += static_cast<uint64_t>(GetPixelDataSize(width, height, image.format));
+    }
+
+    const auto pixels { writer.append(image.data, mip_size) };
+    const pack::TextureData texture {
+        .width = image.width,
+        .height = image.height,
+        .mipmaps = image.mipmaps,
+        .format = image.format,
+        .data_offset = pixels,
+        .data_size = mip_size,
+    };
+
+    const auto offset { writer.append(texture) };
+    UnloadImage(image);
+    return writer.add_entry(path, pack::EntryType::Texture, offset);
+}
+
+void bake_model(PackWriter &writer, const std::string &assets_dir, const std::string &path) {
+    const auto model { LoadModel((assets_dir + "/" + path).c_str()) };
+
+    // Embedded textures are read back from the GPU and stored as their own entries
+    std::vector<pack::MaterialData> materials(model.materialCount);
+    for (int i { 0 }; i < model.materialCount; ++i) {
+        const auto &map { model.materials[i].maps[MATERIAL_MAP_DIFFUSE] };
+        materials[i] = {
+            .color = { map.color.r, map.color.g, map.color.b, map.color.a },
+            .texture = -1,
+        };
+
+        if (map.texture.id > 0 && map.texture.id != rlGetTextureIdDefault()) {
+            materials[i].texture = bake_image(writer, path + "#" + std::to_string(i), LoadImageFromTexture(map.texture));
+        }
+    }
+
+    std::vector<pack::MeshData> meshes(model.meshCount);
+    for (int i { 0 }; i < model.meshCount; ++i) {
+        const auto &mesh { model.meshes[i] };
+        const auto vertex_count { static_cast<size_t>(mesh.vertexCount) };
+
+        meshes[i] = {
+            .vertex_count = mesh.vertexCount,
+            .triangle_count = mesh.triangleCount,
+            .vertices = writer.append(mesh.vertices, vertex_count * 3 * sizeof(float)),
+            .texcoords = writer.append(mesh.texcoords, vertex_count * 2 * sizeof(float)),
+            .normals = writer.append(mesh.normals, vertex_count * 3 * sizeof(float)),
+            .colors = writer.append(mesh.colors, vertex_count * 4),
+            .indices = writer.append(mesh.indices, static_cast<size_t>(mesh.triangleCount) * 3 * sizeof(unsigned short)),
+            .bone_ids = writer.append(mesh.boneIds, vertex_count * 4),
+            .bone_weights = writer.append(mesh.boneWeights, vertex_count * 4 * sizeof(float)),
+        };
+    }
+
+    const pack::ModelData data {
+        .mesh_count = model.meshCount,
+        .material_count = model.materialCount,
+        .bone_count = model.boneCount,
+        .reserved = 0,
+        .meshes_offset = writer.append(meshes.data(), meshes.size() * sizeof(pack::MeshData)),
+        .materials_offset = writer.append(materials.data(), materials.size() * sizeof(pack::MaterialData)),
+        .mesh_material_offset = writer.append(model.meshMaterial, model.meshCount * sizeof(int)),
+        .bones_offset = writer.append(model.bones, model.boneCount * sizeof(BoneInfo)),
+        .bind_pose_offset = writer.append(model.bindPose, model.boneCount * sizeof(Transform)),
+    };
+    writer.add_entry(path, pack::EntryType::Model, writer.append(data));
+    UnloadModel(model);
+
+    int animation_count { 0 };
+    auto *animations { LoadModelAnimations((assets_dir + "/" + path).c_str(), &animation_count) };
+    if (animation_count == 0) {
+        return;
+    }
+
+    // Animation clip table, poses are stored frame major in one block per clip
+    std::vector<pack::ClipData> clips(animation_count);
+    for (int i { 0 }; i < animation_count; ++i) {
+        const auto &animation { animations[i] };
+        std::vector<Transform> poses;
+        poses.reserve(static_cast<size_t>(animation.frameCount) * animation.boneCount);
+
+        for (int frame { 0 }; frame < animation.frameCount; ++frame) {
+            poses.insert(poses.end(), animation.framePoses[frame], animation.framePoses[frame] + animation.boneCount);
+        }
+
+        clips[i] = {
+            .name = {},
+            .bone_count = animation.boneCount,
+            .frame_count = animation.frameCount,
+            .bones_offset = writer.append(animation.bones, animation.boneCount * sizeof(BoneInfo)),
+            .poses_offset = writer.append(poses.data(), poses.size() * sizeof(Transform)),
+        };
+        std::memcpy(clips[i].name, animation.name, sizeof(clips[i].name));
+    }
+
+    const pack::AnimationsData data_animations {
+        .clip_count = animation_count,
+        .reserved = 0,
+        .clips_offset = writer.append(clips.data(), clips.size() * sizeof(pack::ClipData)),
+    };
+    writer.add_entry(path, pack::EntryType::Animations, writer.append(data_animations));
+    UnloadModelAnimations(animations, animation_count);
+}
+
+int main(const int argc, char **argv) {
+    if (argc != 3) {
+        std::printf("Usage: %s <assets directory> <output pack>\n", argv[0]);
+        return 1;
+    }
+
+    const std::string assets_dir { argv[1] };
+    const std::string output { argv[2] };
+
+    // raylib needs a GL context to load models, the window is never shown
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(1, 1, "bixs_bake");
+
+    PackWriter writer;
+
+    const auto textures { LoadDirectoryFilesEx((assets_dir + "/textures").c_str(), ".jpg;.png", false) };
+    for (unsigned int i { 0 }; i < textures.count; ++i) {
+        const auto path { std::string("textures/") + GetFileName(textures.paths[i]) };
+        bake_image(writer, path, LoadImage(textures.paths[i]));
+    }
+    UnloadDirectoryFiles(textures);
+
+    const auto models { LoadDirectoryFilesEx((assets_dir + "/models").c_str(), ".glb", false) };
+    for (unsigned int i { 0 }; i < models.count; ++i) {
+        bake_model(writer, assets_dir, std::string("models/") + GetFileName(models.paths[i]));
+    }
+    UnloadDirectoryFiles(models);
+
+    const auto saved { writer.save(output) };
+    std::printf("Baked %zu entries (%zu bytes) into %s\n", writer.entries.size(), writer.buffer.size(), output.c_str());
+
+    CloseWindow();
+    return saved ? 0 : 1;
+}